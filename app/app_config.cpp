@@ -46,9 +46,15 @@
 #define SDR_INPUT_DECIM     SDR_INPUT"/decimation"
 #define SDR_INPUT_BW        SDR_INPUT"/bandwidth"
 #define SDR_INPUT_CORR      SDR_INPUT"/frequency_correction"
+#define SDR_INPUT_OVERRUN   SDR_INPUT"/overrun_policy"
+#define SDR_INPUT_TIMEOUT   SDR_INPUT"/overrun_timeout"
+
+#define RX                  "receiver"
+#define RX_FILT_LATENCY     RX"/filter_latency"
 
 #define DEFAULT_FREQ 145500000
 #define DEFAULT_GAIN 50
+#define DEFAULT_OVERRUN_TIMEOUT 100
 
 AppConfig::AppConfig()
 {
@@ -62,6 +68,7 @@ int AppConfig::load(const QSettings &settings)
 {
     app_config.version = settings.value(APP_CFG_VER, CONFIG_VERSION).toUInt();
     readDeviceConf(settings);
+    readRxConf(settings);
 
     return APP_CONFIG_OK;
 }
@@ -70,6 +77,7 @@ void AppConfig::save(QSettings &settings)
 {
     settings.setValue(APP_CFG_VER, app_config.version);
     saveDeviceConf(settings);
+    saveRxConf(settings);
     settings.sync();
 }
 
@@ -85,6 +93,13 @@ void AppConfig::readDeviceConf(const QSettings &settings)
     input->decimation = settings.value(SDR_INPUT_DECIM, 1).toUInt();
     input->bandwidth = settings.value(SDR_INPUT_BW, 0).toUInt();
     input->freq_corr_ppb = settings.value(SDR_INPUT_CORR, 0).toInt();
+
+    // 0: drop newest, 1: drop oldest, 2: block (see sdr_device_overrun_t)
+    input->overrun_policy = settings.value(SDR_INPUT_OVERRUN, 0).toUInt();
+    if (input->overrun_policy > 2)
+        input->overrun_policy = 0;
+    input->overrun_timeout = settings.value(SDR_INPUT_TIMEOUT,
+                                            DEFAULT_OVERRUN_TIMEOUT).toUInt();
 }
 
 void AppConfig::saveDeviceConf(QSettings &settings)
@@ -130,5 +145,31 @@ void AppConfig::saveDeviceConf(QSettings &settings)
         settings.setValue(SDR_INPUT_CORR, input->freq_corr_ppb);
     else
         settings.remove(SDR_INPUT_CORR);
+
+    if (input->overrun_policy)
+        settings.setValue(SDR_INPUT_OVERRUN, input->overrun_policy);
+    else
+        settings.remove(SDR_INPUT_OVERRUN);
+
+    if (input->overrun_timeout != DEFAULT_OVERRUN_TIMEOUT)
+        settings.setValue(SDR_INPUT_TIMEOUT, input->overrun_timeout);
+    else
+        settings.remove(SDR_INPUT_TIMEOUT);
+}
+
+void AppConfig::readRxConf(const QSettings &settings)
+{
+    rx_config_t     *rx = &app_config.rx;
+
+    rx->filter_latency = settings.value(RX_FILT_LATENCY, 0).toInt();
 }
 
+void AppConfig::saveRxConf(QSettings &settings)
+{
+    rx_config_t     *rx = &app_config.rx;
+
+    if (rx->filter_latency > 0)
+        settings.setValue(RX_FILT_LATENCY, rx->filter_latency);
+    else
+        settings.remove(RX_FILT_LATENCY);
+}
@@ -16,6 +16,8 @@ typedef struct
     quint32     decimation;
     quint32     bandwidth;
     qint32      freq_corr_ppb;
+    quint32     overrun_policy;     // sdr_device_overrun_t
+    quint32     overrun_timeout;    // ms, only used by SDR_DEVICE_BLOCK
 } device_config_t;
 
 typedef struct
@@ -23,11 +25,17 @@ typedef struct
 
 } audio_config_t;
 
+typedef struct
+{
+    int         filter_latency; // samples at the quadrature rate, 0: default
+} rx_config_t;
+
 typedef struct
 {
     unsigned int        version;
     device_config_t     input;
     audio_config_t      audio;
+    rx_config_t         rx;
 } app_config_t;
 
 // error codes
@@ -52,6 +60,8 @@ public:
 private:
     void    readDeviceConf(const QSettings &settings);
     void    saveDeviceConf(QSettings &settings);
+    void    readRxConf(const QSettings &settings);
+    void    saveRxConf(QSettings &settings);
 
 private:
     app_config_t        app_config;
@@ -105,13 +105,16 @@ int SdrThread::start(const app_config_t *conf, SdrDevice * dev)
     rx_rate = input_cfg.rate;
     if (decimation > 1)
     {
-        decimation = input_decim.init(decimation, 100);
+        decimation = input_decim.init(decimation, 100, input_cfg.rate);
         rx_rate /= float(decimation);
     }
 
     buflen = buflen_ms * 1.e-3f * rx_rate;
     rx = new Receiver();
     rx->init(rx_rate, 48000, 100, buflen);
+    // config only (receiver/filter_latency), applied on each start
+    if (conf->rx.filter_latency > 0)
+        rx->set_filter_latency(conf->rx.filter_latency);
 
     is_running = true;
 
@@ -149,12 +152,15 @@ void SdrThread::stop(void)
     SDR_THREAD_DEBUG("Receiver statistics:\n"
                      "  Time: %" PRIu64 " ms\n"
                      "  Samples in:  %" PRIu64 " samples = %" PRIu64 " sps\n"
-                     "  Samples out: %" PRIu64 " samples = %" PRIu64 " sps\n",
+                     "  Samples out: %" PRIu64 " samples = %" PRIu64 " sps\n"
+                     "  Overruns:    %" PRIu64 " (%" PRIu64 " samples dropped)\n",
                      stats.tstop - stats.tstart,
                      stats.samples_in,
                      (1000 * stats.samples_in) / (stats.tstop - stats.tstart),
                      stats.samples_out,
-                     (1000 * stats.samples_out) / (stats.tstop - stats.tstart));
+                     (1000 * stats.samples_out) / (stats.tstop - stats.tstart),
+                     uint64_t(device->getStats().rx_overruns),
+                     uint64_t(device->getStats().rx_dropped));
     /* *INDENT-ON* */
     is_running = false;
 //    sdr_dev->stopRx();
@@ -169,9 +175,10 @@ void SdrThread::stop(void)
 
 void SdrThread::process(void)
 {
-    quint32    samples_in = buflen;
-    quint32    samples_read;
-    int        samples_out;
+    const complex_t    *span;
+    quint32             samples_in = buflen;
+    quint32             samples_read;
+    int                 samples_out;
 
     SDR_THREAD_DEBUG("SDR thread started\n");
 
@@ -189,16 +196,36 @@ void SdrThread::process(void)
             continue;
         }
 
-        samples_read = device->getRxSamples(input_samples, samples_in);
-        if (samples_read == 0)
+        if (decimation > 1)
         {
-            QThread::usleep(2000);
-            continue;
+            // decimate directly from the device buffer
+            span = device->acquireRxSamples(samples_in);
+            if (span == nullptr)
+            {
+                QThread::usleep(2000);
+                continue;
+            }
+            stats.samples_in += samples_in;
+            samples_read = input_decim.process(samples_in, span, input_samples);
+
+            // samples were overwritten while we used them; the output and
+            // the filter history are corrupt
+            if (!device->releaseRxSamples(samples_in))
+            {
+                input_decim.reset();
+                continue;
+            }
+        }
+        else
+        {
+            samples_read = device->getRxSamples(input_samples, samples_in);
+            if (samples_read == 0)
+            {
+                QThread::usleep(2000);
+                continue;
+            }
+            stats.samples_in += samples_read;
         }
-        stats.samples_in += samples_read;
-
-        if (decimation > 1)
-            samples_read = input_decim.process(samples_read, input_samples);
 
         fft->add_fft_input(samples_read, input_samples);
         samples_out = rx->process(samples_read, input_samples, output_samples);
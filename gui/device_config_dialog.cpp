@@ -30,6 +30,7 @@
 #include <QDebug>
 
 #include "device_config_dialog.h"
+#include "nanosdr/nanodsp/filter/decimator.h"
 #include "ui_device_config_dialog.h"
 
 // Flags used to match SDR type in combo box
@@ -148,8 +149,10 @@ void DeviceConfigDialog::sdrTypeChanged(int index)
 
 void DeviceConfigDialog::inputRateChanged(const QString &rate_str)
 {
+    Decimator::plan     plan;
     bool    conv_ok;
     int     rate;
+    int     decim;
 
     rate = rate_str.toInt(&conv_ok);
     if (!conv_ok || rate < 0)
@@ -157,25 +160,13 @@ void DeviceConfigDialog::inputRateChanged(const QString &rate_str)
 
     ui->decimCombo->clear();
     ui->decimCombo->addItem("None");
-    // add decimations that give an integer sample rate >= 48k
-    if (rate >= 96000 && rate % 2 == 0)
-        ui->decimCombo->addItem("2");
-    if (rate >= 192000 && rate % 4 == 0)
-        ui->decimCombo->addItem("4");
-    if (rate >= 384000 && rate % 8 == 0)
-        ui->decimCombo->addItem("8");
-    if (rate >= 768000 && rate % 16 == 0)
-        ui->decimCombo->addItem("16");
-    if (rate >= 1536000 && rate % 32 == 0)
-        ui->decimCombo->addItem("32");
-    if (rate >= 3072000 && rate % 64 == 0)
-        ui->decimCombo->addItem("64");
-    if (rate >= 6144000 && rate % 128 == 0)
-        ui->decimCombo->addItem("128");
-//    if (rate >= 12288000 && rate % 256 == 0)
-//        ui->decimCombo->addItem("256");
-//    if (rate >= 24576000 && rate % 512 == 0)
-//        ui->decimCombo->addItem("512");
+    // add decimations that give an integer sample rate >= 48k, the decimator
+    // is not limited to powers of 2
+    for (decim = 2; decim <= MAX_DECIMATION && rate / decim >= 48000; decim++)
+    {
+        if (rate % decim == 0 && Decimator::make_plan(decim, 100, &plan))
+            ui->decimCombo->addItem(QString::number(decim));
+    }
 
     decimationChanged(0);
 }
@@ -231,23 +222,12 @@ void DeviceConfigDialog::selectSampleRate(unsigned int rate)
     ui->inputRateCombo->setCurrentText(QString("%1").arg(rate));
 }
 
-static int decim2index(unsigned int decim)
-{
-    int         idx;
-
-    if (decim == 0)
-        return 0;
-
-    idx = 0;
-    while (decim >>= 1)
-        ++idx;
-
-    return idx;
-}
-
+// the combo only lists decimations with a plan, "None" is at index 0
 void DeviceConfigDialog::selectDecimation(unsigned int decimation)
 {
-    ui->decimCombo->setCurrentIndex(decim2index(decimation));
+    int     idx = ui->decimCombo->findText(QString::number(decimation));
+
+    ui->decimCombo->setCurrentIndex(idx < 0 ? 0 : idx);
 }
 
 void DeviceConfigDialog::setBandwidth(quint32 bw)
@@ -31,6 +31,7 @@
 #include <new>          // std::nothrow
 
 #include <QDebug>
+#include <QFileInfo>
 #include <QtWidgets>
 #include <QMessageBox>
 
@@ -41,6 +42,7 @@
 #include "gui/freq_ctrl.h"
 #include "gui/ssi_widget.h"
 #include "interfaces/sdr/sdr_device.h"
+#include "nanosdr/nanodsp/fft_backend.h"
 
 #include "mainwindow.h"
 
@@ -201,6 +203,7 @@ void MainWindow::restoreWindowState(void)
 void MainWindow::loadConfig(void)
 {
     app_config_t *conf;
+    QString       fft_cache;
 
     if (settings)
     {
@@ -217,6 +220,11 @@ void MainWindow::loadConfig(void)
 
     restoreWindowState();
 
+    // FFT backends benchmarked on this host are kept next to the config
+    fft_cache = QFileInfo(settings->fileName()).absolutePath() +
+                "/softrig_fft.cache";
+    FftBackend::set_cache_file(fft_cache.toLocal8Bit().constData());
+
     if (!cfg)
         cfg = new AppConfig();
 
@@ -277,6 +285,8 @@ void MainWindow::deviceConfigChanged(const device_config_t * conf)
         {
             cpanel->addRxControls(device->getRxControls());
             device->readSettings(*settings);
+            device->setRxOverrunPolicy(sdr_device_overrun_t(conf->overrun_policy),
+                                       conf->overrun_timeout);
             device->setRxSampleRate(conf->rate);
             device->setRxBandwidth(conf->bandwidth);
         }
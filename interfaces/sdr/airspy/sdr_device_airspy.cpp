@@ -29,12 +29,14 @@
 
 #include <stdint.h>
 
-#include "common/ring_buffer_cplx.h"
+#include "nanosdr/nanodsp/filter/filtercoef_hbf_70.h"
+#include "nanosdr/nanodsp/filter/filtercoef_hbf_100.h"
 #include "sdr_device_airspy.h"
 #include "sdr_device_airspy_api.h"
 #include "sdr_device_airspy_fir.h"
 
 
+#define DEFAULT_SAMPLE_TYPE "FLOAT32_IQ"
 #define DEFAULT_GAIN_MODE   "Linearity"
 #define DEFAULT_LIN_GAIN    16
 #define DEFAULT_SENS_GAIN   16
@@ -43,6 +45,7 @@
 #define DEFAULT_VGA_GAIN    10
 #define DEFAULT_BIAS        false
 
+#define CFG_KEY_SAMPLE_TYPE "airspy/sample_type"
 #define CFG_KEY_GAIN_MODE   "airspy/gain_mode"
 #define CFG_KEY_LIN_GAIN    "airspy/linearity_gain"
 #define CFG_KEY_SENS_GAIN   "airspy/sensitivity_gain"
@@ -51,6 +54,8 @@
 #define CFG_KEY_VGA_GAIN    "airspy/vga_gain"
 #define CFG_KEY_BIAS        "airspy/bias_on"
 
+#define INT16_SCALE         (1.0f / 32768.f)
+
 
 SdrDevice *sdr_device_create_airspy()
 {
@@ -70,41 +75,84 @@ int SdrDeviceAirspyBase::airspy_rx_callback(airspy_transfer_t *transfer)
     // we are in a static method, so we need to get the instance
     SdrDeviceAirspyBase *sdrdev = (SdrDeviceAirspyBase *)transfer->ctx;
 
-    if (transfer->sample_type != AIRSPY_SAMPLE_FLOAT32_IQ)
+    if (transfer->sample_type != sdrdev->sample_type)
     {
-        qCritical() << "Airspy is running with unsupported sample type:"
+        qCritical() << "Airspy is running with unexpected sample type:"
                     << transfer->sample_type;
         return -1;
     }
 
-    std::lock_guard<std::mutex> lock(sdrdev->reader_lock);
-    ring_buffer_cplx_write(sdrdev->sample_buffer,
-                           (complex_t *)transfer->samples,
-                           transfer->sample_count);
+    switch (transfer->sample_type)
+    {
+    case AIRSPY_SAMPLE_FLOAT32_IQ:
+    case AIRSPY_SAMPLE_INT16_IQ:
+        sdrdev->stats.rx_samples += quint64(transfer->sample_count);
+        sdrdev->writeRxSamples(transfer->samples, transfer->sample_count);
+        break;
+
+    case AIRSPY_SAMPLE_INT16_REAL:
+        sdrdev->convertRealSamples((const int16_t *)transfer->samples,
+                                   transfer->sample_count);
+        break;
 
-    sdrdev->stats.rx_samples += quint64(transfer->sample_count);
-    if (ring_buffer_cplx_is_full(sdrdev->sample_buffer))
-        sdrdev->stats.rx_overruns++;
+    default:
+        qCritical() << "Airspy is running with unsupported sample type:"
+                    << transfer->sample_type;
+        return -1;
+    }
 
     return 0;
 }
 
+/*
+ * Convert real samples to complex using the DDC. The output is written
+ * directly into the sample buffer; the span may be split if the buffer is
+ * not mirrored.
+ */
+void SdrDeviceAirspyBase::convertRealSamples(const int16_t *samples,
+                                             quint32 count)
+{
+    complex_t  *out;
+    quint32     num = count / 2;
+    quint32     len;
+    quint32     n = 0;
+
+    stats.rx_samples += num;
+    while (n < num)
+    {
+        len = num - n;
+        out = static_cast<complex_t *>(reserveRxSamples(len));
+        if (len == 0)
+        {
+            rxOverrun(num - n);
+            break;
+        }
+
+        ddc.process(2 * len, &samples[2 * n], out);
+        commitRxSamples(len);
+        n += len;
+    }
+}
+
 SdrDeviceAirspyBase::SdrDeviceAirspyBase(bool mini, QObject *parent) :
     SdrDevice(parent),
     driver("airspy", this),
     device(nullptr),
-    is_mini(mini)
+    is_mini(mini),
+    sample_type(AIRSPY_SAMPLE_FLOAT32_IQ),
+    ddc_len(HBF_100_59_LENGTH),
+    ddc_coef(HBF_100_59)
 {
     clearStatus(status);
     clearStats(stats);
 
-    sample_buffer = ring_buffer_cplx_create();
-    ring_buffer_cplx_init(sample_buffer, 1000000);
+    resizeRxBuffer(1000000);
 
     // initialize settings
     settings.frequency = 100e6;
     settings.sample_rate = mini ? 6e6 : 10e6;
     settings.bandwidth = 0;
+    settings.sample_type = DEFAULT_SAMPLE_TYPE;
     settings.gain_mode = DEFAULT_GAIN_MODE;
     settings.linearity_gain = DEFAULT_LIN_GAIN;
     settings.sensitivity_gain = DEFAULT_SENS_GAIN;
@@ -135,8 +183,6 @@ SdrDeviceAirspyBase::~SdrDeviceAirspyBase()
 
     if (status.driver_is_loaded)
         driver.unload();
-
-    ring_buffer_cplx_delete(sample_buffer);
 }
 
 int SdrDeviceAirspyBase::open()
@@ -162,6 +208,15 @@ int SdrDeviceAirspyBase::open()
         return SDR_DEVICE_EOPEN;
     }
 
+    result = airspy_set_sample_type(device, sample_type);
+    if (result != AIRSPY_SUCCESS)
+    {
+        qCritical("airspy_set_sample_type() failed with code %d: %s", result,
+                  airspy_error_name((enum airspy_error)result));
+        airspy_close(device);
+        return SDR_DEVICE_EINIT;
+    }
+
     status.device_is_open = true;
     rx_ctl.setEnabled(true);
 
@@ -193,6 +248,7 @@ int SdrDeviceAirspyBase::readSettings(const QSettings &s)
     bool    conv_ok;
     int     int_val;
 
+    settings.sample_type = s.value(CFG_KEY_SAMPLE_TYPE, DEFAULT_SAMPLE_TYPE).toString();
     settings.gain_mode = s.value(CFG_KEY_GAIN_MODE, DEFAULT_GAIN_MODE).toString();
 
     int_val = s.value(CFG_KEY_LIN_GAIN, DEFAULT_LIN_GAIN).toInt(&conv_ok);
@@ -217,7 +273,9 @@ int SdrDeviceAirspyBase::readSettings(const QSettings &s)
 
     settings.bias_on = s.value(CFG_KEY_BIAS, DEFAULT_BIAS).toBool();
 
-    if (status.device_is_open)
+    if (!status.device_is_open)
+        setupSampleType();
+    else
         applySettings();
 
     return SDR_DEVICE_OK;
@@ -225,6 +283,11 @@ int SdrDeviceAirspyBase::readSettings(const QSettings &s)
 
 int SdrDeviceAirspyBase::saveSettings(QSettings &s)
 {
+    if (settings.sample_type == DEFAULT_SAMPLE_TYPE)
+        s.remove(CFG_KEY_SAMPLE_TYPE);
+    else
+        s.setValue(CFG_KEY_SAMPLE_TYPE, settings.sample_type);
+
     if (settings.gain_mode == DEFAULT_GAIN_MODE)
         s.remove(CFG_KEY_GAIN_MODE);
     else
@@ -275,6 +338,10 @@ int SdrDeviceAirspyBase::startRx(void)
 
     qDebug() << "Starting Airspy...";
 
+    // pick up the DDC filter for the current bandwidth
+    if (sample_type == AIRSPY_SAMPLE_INT16_REAL)
+        ddc.init(ddc_len, ddc_coef, INT16_SCALE);
+
     status.rx_is_running = true;
 
     result = airspy_start_rx(device, airspy_rx_callback, this);
@@ -310,21 +377,6 @@ int SdrDeviceAirspyBase::stopRx(void)
     return SDR_DEVICE_OK;
 }
 
-quint32 SdrDeviceAirspyBase::getRxSamples(complex_t * buffer, quint32 count)
-{
-    std::lock_guard<std::mutex> lock(reader_lock);
-
-    if (!buffer || count == 0)
-        return 0;
-
-    if (count > ring_buffer_cplx_count(sample_buffer))
-        return 0;
-
-    ring_buffer_cplx_read(sample_buffer, buffer, count);
-
-    return count;
-}
-
 QWidget *SdrDeviceAirspyBase::getRxControls(void)
 {
     return  &rx_ctl;
@@ -397,6 +449,23 @@ int SdrDeviceAirspyBase::setRxBandwidth(quint32 bw)
 
     decim = bw ? settings.sample_rate / bw : 1;
 
+    // half band filter for the DDC, used from the next startRx()
+    if (decim < 4)
+    {
+        ddc_coef = HBF_100_59;
+        ddc_len = HBF_100_59_LENGTH;
+    }
+    else if (decim < 16)
+    {
+        ddc_coef = HBF_70_39;
+        ddc_len = HBF_70_39_LENGTH;
+    }
+    else
+    {
+        ddc_coef = HBF_70_11;
+        ddc_len = HBF_70_11_LENGTH;
+    }
+
     if (decim < 4)
     {
         kernel = KERNEL_2_80;
@@ -418,6 +487,7 @@ int SdrDeviceAirspyBase::setRxBandwidth(quint32 bw)
         size = KERNEL_16_110_LEN;
     }
 
+    // the conversion filter is only used by libairspy for FLOAT32_IQ
     qInfo("Airspy BW = %d, decim = %d, kernel size = %d", bw, decim, size);
     result = airspy_set_conversion_filter_float32(device, kernel, size);
     if (result != AIRSPY_SUCCESS)
@@ -430,6 +500,34 @@ int SdrDeviceAirspyBase::setRxBandwidth(quint32 bw)
     return SDR_DEVICE_OK;
 }
 
+/*
+ * Select the sample type and the matching buffer format. With INT16_REAL the
+ * real to complex conversion is done by our own DDC instead of libairspy,
+ * with INT16_IQ the samples are buffered as 16 bit integers. The buffer may
+ * be reallocated, so this is only done from readSettings() while the device
+ * is closed; the sample type is passed to libairspy in open().
+ */
+void SdrDeviceAirspyBase::setupSampleType(void)
+{
+    if (settings.sample_type == "FLOAT32_IQ")
+    {
+        sample_type = AIRSPY_SAMPLE_FLOAT32_IQ;
+        setRxFormat(SDR_DEVICE_FMT_CF32);
+    }
+    else if (settings.sample_type == "INT16_IQ")
+    {
+        sample_type = AIRSPY_SAMPLE_INT16_IQ;
+        setRxFormat(SDR_DEVICE_FMT_CS16, INT16_SCALE);
+    }
+    else
+    {
+        sample_type = AIRSPY_SAMPLE_INT16_REAL;
+        setRxFormat(SDR_DEVICE_FMT_CF32);
+    }
+
+    qInfo() << "Airspy sample type:" << settings.sample_type;
+}
+
 void SdrDeviceAirspyBase::saveGainMode(const QString &mode)
 {
     settings.gain_mode = mode;
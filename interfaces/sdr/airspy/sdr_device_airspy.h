@@ -8,10 +8,8 @@
 #include <QSettings>
 #include <QWidget>
 
-#include <mutex>
-
-#include "nanosdr/common/ring_buffer.h"
 #include "interfaces/sdr/sdr_device.h"
+#include "nanosdr/nanodsp/real_ddc.h"
 #include "sdr_device_airspy_api_defs.h"
 #include "sdr_device_airspy_rxctl.h"
 
@@ -29,7 +27,6 @@ public:
     int         saveSettings(QSettings &s) override;
     int         startRx(void) override;
     int         stopRx(void) override;
-    quint32     getRxSamples(complex_t * buffer, quint32 count) override;
     QWidget    *getRxControls(void) override;
 
     int         setRxFrequency(quint64 freq) override;
@@ -52,6 +49,9 @@ private:
 
     static int airspy_rx_callback(airspy_transfer_t *transfer);
 
+    void    convertRealSamples(const int16_t *samples, quint32 count);
+    void    setupSampleType(void);
+
     void    applySettings(void);
 
     QLibrary                driver;
@@ -60,11 +60,12 @@ private:
     airspy_lib_version_t    lib_ver;
     bool                    is_mini;
 
-    ring_buffer_t  *sample_buffer;
-    std::mutex      reader_lock;
+    enum airspy_sample_type sample_type;    // set while the device is closed
+    RealDdc                 ddc;            // for AIRSPY_SAMPLE_INT16_REAL
+    int                     ddc_len;
+    const real_t           *ddc_coef;
 
     sdr_device_status_t     status;
-    sdr_device_stats_t      stats;
     airspy_settings_t       settings;
 
 };
@@ -15,6 +15,7 @@ typedef struct {
     quint64     frequency;
     quint32     sample_rate;
     quint32     bandwidth;
+    QString     sample_type;
     QString     gain_mode;
     int         linearity_gain;
     int         sensitivity_gain;
@@ -31,7 +31,7 @@
 
 #include <QDebug>
 
-#include "common/ring_buffer_cplx.h"
+#include "nanosdr/common/ring_buffer_spsc.h"
 #include "sdr_device_bladerf.h"
 #include "sdr_device_bladerf_api.h"
 
@@ -42,6 +42,8 @@
 #define DEFAULT_RX_GAIN     0
 #define DEFAULT_USB_RESET   false
 
+#define SAMPLE_SCALE        (1.0f / 2048.0f)
+
 #define CFG_KEY_RX_GAIN     "bladerf/rx_gain"
 #define CFG_KEY_USB_RESET   "bladerf/usb_reset_on_open"
 
@@ -67,8 +69,8 @@ SdrDeviceBladerf::SdrDeviceBladerf(QObject *parent) :
     settings.rx_gain = DEFAULT_RX_GAIN;
     settings.usb_reset_on_open = DEFAULT_USB_RESET;
 
-    reader_buffer = ring_buffer_cplx_create();
-    ring_buffer_cplx_init(reader_buffer, quint32(0.5 * settings.rx_sample_rate));
+    setRxFormat(SDR_DEVICE_FMT_CS16, SAMPLE_SCALE);
+    updateRxBufferSize();
 
     // connect rx_ctl signals to slots
     rx_ctl.setEnabled(false);
@@ -87,8 +89,6 @@ SdrDeviceBladerf::~SdrDeviceBladerf()
 
     if (status.driver_is_loaded)
         driver.unload();
-
-    ring_buffer_cplx_delete(reader_buffer);
 }
 
 int SdrDeviceBladerf::open()
@@ -187,7 +187,7 @@ int SdrDeviceBladerf::startRx(void)
         return SDR_DEVICE_OK;
 
     qDebug() << "Starting BladeRF receiver";
-    ring_buffer_cplx_clear(reader_buffer);
+    discardRxSamples();
 
     result = bladerf_sync_config(device, BLADERF_RX_X1, BLADERF_FORMAT_SC16_Q11,
                                  16, 16384, 8, 3500);
@@ -259,10 +259,10 @@ int SdrDeviceBladerf::stopRx(void)
 void SdrDeviceBladerf::readerThread(void)
 {
     int             result;
-    unsigned int    i;
     unsigned int    num_samples = settings.rx_sample_rate / 20;
     int16_t        *buffer = new(std::nothrow)int16_t[2 * num_samples];
-    float          *rbuf   = new(std::nothrow)float[2 * num_samples];
+    int16_t        *rx_ptr;
+    quint32         rx_len;
 
     if (buffer == nullptr)
     {
@@ -273,8 +273,15 @@ void SdrDeviceBladerf::readerThread(void)
     qDebug() << "BladeRF reader thread started";
     while (keep_running)
     {
+        // receive directly into the sample buffer if there is room for a
+        // contiguous block, otherwise use the local buffer
+        rx_len = num_samples;
+        rx_ptr = static_cast<int16_t *>(reserveRxSamples(rx_len));
+        if (rx_len < num_samples)
+            rx_ptr = buffer;
+
         // read data
-        result = bladerf_sync_rx(device, buffer, num_samples, nullptr, 5000);
+        result = bladerf_sync_rx(device, rx_ptr, num_samples, nullptr, 5000);
         if (result)
         {
             qCritical() << "Error reading from BladeRF:" << bladerf_strerror(result);
@@ -282,38 +289,15 @@ void SdrDeviceBladerf::readerThread(void)
             continue;
         }
 
-#define SAMPLE_SCALE (1.0f / 2048.0f);
-
-        for (i = 0; i < num_samples; i++)
-        {
-            rbuf[2*i] = float(buffer[2*i]) * SAMPLE_SCALE;
-            rbuf[2*i+1] = float(buffer[2*i+1]) * SAMPLE_SCALE;
-        }
-        reader_lock.lock();
-        ring_buffer_cplx_write(reader_buffer, (complex_t *)rbuf, num_samples);
-        reader_lock.unlock();
-        // FIXME: check overflow
-
+        stats.rx_samples += num_samples;
+        if (rx_ptr != buffer)
+            commitRxSamples(num_samples);
+        else
+            writeRxSamples(rx_ptr, num_samples);
     }
     qDebug() << "BladeRF reader thread stopped";
 
     delete [] buffer;
-    delete [] rbuf;
-}
-
-quint32 SdrDeviceBladerf::getRxSamples(complex_t * buffer, quint32 count)
-{
-    std::lock_guard<std::mutex> lock(reader_lock);
-
-    if (!buffer || count == 0)
-        return 0;
-
-    if (count > ring_buffer_cplx_count(reader_buffer))
-        return 0;
-
-    ring_buffer_cplx_read(reader_buffer, buffer, count);
-
-    return count;
 }
 
 QWidget *SdrDeviceBladerf::getRxControls(void)
@@ -440,14 +424,10 @@ void SdrDeviceBladerf::setBias(bladerf_channel ch, bool enable)
 
 void SdrDeviceBladerf::updateRxBufferSize(void)
 {
-    std::lock_guard<std::mutex> lock(reader_lock);
     quint32 new_size = quint32(0.5f * settings.rx_sample_rate); // 500 msec
 
-    if (new_size == 0 || new_size == ring_buffer_cplx_size(reader_buffer))
-        return;
-
-    ring_buffer_cplx_clear(reader_buffer);
-    ring_buffer_cplx_resize(reader_buffer, new_size);
+    if (!status.rx_is_running)
+        resizeRxBuffer(new_size);
 }
 
 void SdrDeviceBladerf::applySettings()
@@ -8,10 +8,8 @@
 #include <QSettings>
 #include <QWidget>
 
-#include <mutex>
 #include <thread>
 
-#include "nanosdr/common/ring_buffer.h"
 #include "interfaces/sdr/sdr_device.h"
 #include "sdr_device_bladerf_api_defs.h"
 #include "sdr_device_bladerf_rxctl.h"
@@ -31,7 +29,6 @@ public:
     int         saveSettings(QSettings &s) override;
     int         startRx(void) override;
     int         stopRx(void) override;
-    quint32     getRxSamples(complex_t * buffer, quint32 count) override;
     QWidget    *getRxControls(void) override;
 
     int         setRxFrequency(quint64 freq) override;
@@ -54,13 +51,10 @@ private:
     struct bladerf         *device;
     SdrDeviceBladerfRxctl   rx_ctl;
 
-    ring_buffer_t  *reader_buffer;
-    std::mutex      reader_lock;
     std::thread    *reader_thread;
     bool            keep_running;
 
     sdr_device_status_t     status;
-    sdr_device_stats_t      stats;
     bladerf_settings_t      settings;
     bladerf_info_t          device_info;
 };
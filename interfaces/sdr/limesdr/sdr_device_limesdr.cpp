@@ -32,7 +32,6 @@
 #include <QMessageBox>
 #include <QString>
 
-#include "nanosdr/common/ring_buffer_cplx.h"
 #include "sdr_device_limesdr.h"
 #include "sdr_device_limesdr_api.h"
 
@@ -40,6 +39,8 @@
 #define DEFAULT_LPF_ON      true
 #define DEFAULT_GFIR_ON     false
 
+#define SAMPLE_SCALE        (1.0f / 2048.0f)     // LMS_FMT_I12
+
 #define CFG_KEY_RX_GAIN     "limesdr/rx_gain"
 #define CFG_KEY_LPF_ON      "limesdr/lpf_on"
 #define CFG_KEY_GFIR_ON     "limesdr/gfir_on"
@@ -67,8 +68,8 @@ SdrDeviceLimesdr::SdrDeviceLimesdr(QObject *parent) : SdrDevice(parent),
     settings.rx_lpf = DEFAULT_LPF_ON;
     settings.rx_gfir = DEFAULT_GFIR_ON;
 
-    reader_buffer = ring_buffer_cplx_create();
-    ring_buffer_cplx_init(reader_buffer, settings.rx_sample_rate / 2);
+    setRxFormat(SDR_DEVICE_FMT_CS16, SAMPLE_SCALE);
+    updateBufferSize();
 
     rx_ctl.setEnabled(false);
     connect(&rx_ctl, SIGNAL(gainChanged(unsigned int)), this, SLOT(setRxGain(unsigned int)));
@@ -87,8 +88,6 @@ SdrDeviceLimesdr::~SdrDeviceLimesdr()
 
     if (status.driver_is_loaded)
         driver.unload();
-
-    ring_buffer_delete(reader_buffer);
 }
 
 int SdrDeviceLimesdr::open()
@@ -201,7 +200,7 @@ int SdrDeviceLimesdr::startRx(void)
     rx_stream.fifoSize = 1024 * 1024;
     rx_stream.throughputVsLatency = 1.0;    // optimize for max throughput
     rx_stream.isTx = false;
-    rx_stream.dataFmt = lms_stream_t::LMS_FMT_F32;
+    rx_stream.dataFmt = lms_stream_t::LMS_FMT_I12;
     if (LMS_SetupStream(device, &rx_stream) != LMS_SUCCESS)
     {
         qCritical() << "Failed to set up RX stream";
@@ -269,10 +268,10 @@ int SdrDeviceLimesdr::stopRx(void)
 
 void SdrDeviceLimesdr::readerThread(void)
 {
-//    float *buffer[2*153600];
-
-    int     read_size = settings.rx_sample_rate / 10;
-    float  *buffer = new(std::nothrow)float[2*read_size];
+    int         read_size = settings.rx_sample_rate / 10;
+    int16_t    *buffer = new(std::nothrow)int16_t[2*read_size];
+    int16_t    *rx_ptr;
+    quint32     rx_len;
 
     if (buffer == nullptr)
     {
@@ -283,33 +282,30 @@ void SdrDeviceLimesdr::readerThread(void)
     qDebug() << "LimeSDR reader thread started";
     while (keep_running)
     {
-        if (LMS_RecvStream(&rx_stream, buffer, read_size, nullptr, 300) != read_size)
+        // receive directly into the sample buffer if there is room for a
+        // contiguous block, otherwise use the local buffer
+        rx_len = read_size;
+        rx_ptr = static_cast<int16_t *>(reserveRxSamples(rx_len));
+        if (rx_len < quint32(read_size))
+            rx_ptr = buffer;
+
+        if (LMS_RecvStream(&rx_stream, rx_ptr, read_size, nullptr, 300) != read_size)
         {
             qCritical() << "Error reading from RX stream";
             continue;
         }
-        // FIXME: check overflow
-        reader_lock.lock();
-        ring_buffer_cplx_write(reader_buffer, (complex_t *)buffer, read_size);
-        reader_lock.unlock();
+
+        stats.rx_samples += read_size;
+        if (rx_ptr != buffer)
+            commitRxSamples(read_size);
+        else
+            writeRxSamples(rx_ptr, read_size);
     }
     qDebug() << "LimeSDR reader thread stopped";
 
     delete [] buffer;
 }
 
-quint32 SdrDeviceLimesdr::getRxSamples(complex_t * buffer, quint32 count)
-{
-    std::lock_guard<std::mutex> lock(reader_lock);
-
-    if (!buffer || count == 0 || count > ring_buffer_cplx_count(reader_buffer))
-        return 0;
-
-    ring_buffer_cplx_read(reader_buffer, buffer, count);
-
-    return count;
-}
-
 QWidget *SdrDeviceLimesdr::getRxControls(void)
 {
     return &rx_ctl;
@@ -452,14 +448,10 @@ void SdrDeviceLimesdr::calibrateTx(void)
 
 void SdrDeviceLimesdr::updateBufferSize(void)
 {
-    std::lock_guard<std::mutex> lock(reader_lock);
     quint32 new_size = settings.rx_sample_rate / 2; // 500 msec
 
-    if (new_size == ring_buffer_cplx_size(reader_buffer))
-        return;
-
-    ring_buffer_cplx_clear(reader_buffer);
-    ring_buffer_cplx_resize(reader_buffer, new_size);
+    if (!status.rx_is_running)
+        resizeRxBuffer(new_size);
 }
 
 void SdrDeviceLimesdr::readDeviceLimits(void)
@@ -9,10 +9,8 @@
 #include <QWidget>
 
 #include <stdint.h>
-#include <mutex>
 #include <thread>
 
-#include "nanosdr/common/ring_buffer.h"
 #include "interfaces/sdr/sdr_device.h"
 #include "sdr_device_limesdr_api_defs.h"
 #include "sdr_device_limesdr_rxctl.h"
@@ -31,7 +29,6 @@ public:
     int         saveSettings(QSettings &s) override;
     int         startRx(void) override;
     int         stopRx(void) override;
-    quint32     getRxSamples(complex_t * buffer, quint32 count) override;
     QWidget    *getRxControls(void) override;
 
     int         setRxFrequency(quint64 freq) override;
@@ -60,13 +57,10 @@ private:
 
     SdrDeviceLimesdrRxctl   rx_ctl;
 
-    ring_buffer_t  *reader_buffer;      // raw sample buffer
-    std::mutex      reader_lock;
     std::thread    *reader_thread;
     bool            keep_running;
 
     sdr_device_status_t     status;
-    sdr_device_stats_t      stats;
     limesdr_settings_t      settings;
     limesdr_info_t          info;
 
@@ -59,9 +59,6 @@ SdrDeviceRtlsdr::SdrDeviceRtlsdr(QObject *parent) : SdrDevice(parent),
     clearStatus(status);
     clearStats(stats);
 
-    reader_buffer = ring_buffer_create();
-    ring_buffer_init(reader_buffer, 16384);
-
     settings.frequency = 100e6;
     settings.sample_rate = 2400000;
     settings.bandwidth = 0;
@@ -70,6 +67,10 @@ SdrDeviceRtlsdr::SdrDeviceRtlsdr(QObject *parent) : SdrDevice(parent),
     settings.agc_on = DEFAULT_AGC;
     settings.bias_on = DEFAULT_BIAS;
 
+    setRxFormat(SDR_DEVICE_FMT_CU8);
+    reader_buflen = 0;
+    updateBufferSize();
+
     connect(&rx_ctl, SIGNAL(gainChanged(int)), this, SLOT(setRxGain(int)));
     connect(&rx_ctl, SIGNAL(biasToggled(bool)), this, SLOT(setBias(bool)));
     connect(&rx_ctl, SIGNAL(agcToggled(bool)), this, SLOT(setAgc(bool)));
@@ -87,8 +88,6 @@ SdrDeviceRtlsdr::~SdrDeviceRtlsdr()
 
     if (status.driver_is_loaded)
         driver.unload();
-
-    ring_buffer_delete(reader_buffer);
 }
 
 int SdrDeviceRtlsdr::open()
@@ -195,6 +194,7 @@ int SdrDeviceRtlsdr::startRx(void)
     if (status.rx_is_running)
         return SDR_DEVICE_OK;
 
+    discardRxSamples();
     status.rx_is_running = true;
     startReaderThread();
 
@@ -212,29 +212,6 @@ int SdrDeviceRtlsdr::stopRx(void)
     return SDR_DEVICE_OK;
 }
 
-quint32 SdrDeviceRtlsdr::getRxSamples(complex_t * buffer, quint32 count)
-{
-    uint8_t buf[480000];  // FIXME
-    real_t *workbuf = reinterpret_cast<real_t *>(buffer);
-    quint32 byte_count = 2 * count;
-    quint32 i;
-
-    std::lock_guard<std::mutex> lock(reader_lock);
-
-    if (!buffer || count == 0)
-        return 0;
-
-    if (byte_count > ring_buffer_count(reader_buffer))
-        return 0;
-
-    ring_buffer_read(reader_buffer, buf, byte_count);
-
-    for (i = 0; i < byte_count; i++)
-        workbuf[i] = (real_t(buf[i]) - 127.4f) / 127.5f;  // FIXME: Use LUT
-
-    return count;
-}
-
 QWidget *SdrDeviceRtlsdr::getRxControls(void)
 {
     return &rx_ctl;
@@ -278,6 +255,7 @@ int SdrDeviceRtlsdr::setRxFrequency(quint64 freq)
 int SdrDeviceRtlsdr::setRxSampleRate(quint32 rate)
 {
     settings.sample_rate = rate;
+    updateBufferSize();
     if (!status.device_is_open)
         return SDR_DEVICE_OK;
 
@@ -285,6 +263,7 @@ int SdrDeviceRtlsdr::setRxSampleRate(quint32 rate)
     {
         qInfo() << "Failed to set RTL-SDR sample rate to" << rate;
         settings.sample_rate = rtlsdr_get_sample_rate(device);
+        updateBufferSize();
         return SDR_DEVICE_ERANGE;
     }
 
@@ -383,35 +362,18 @@ void SdrDeviceRtlsdr::readerCallback(unsigned char *buf, uint32_t count, void *c
 {
     SdrDeviceRtlsdr *this_backend = reinterpret_cast<SdrDeviceRtlsdr *>(ctx);
 
-    this_backend->reader_lock.lock();
     this_backend->stats.rx_samples += count / 2;
-    ring_buffer_write(this_backend->reader_buffer, buf, count);
-    if (ring_buffer_is_full(this_backend->reader_buffer))
-        this_backend->stats.rx_overruns++;
-    this_backend->reader_lock.unlock();
+    this_backend->writeRxSamples(buf, count / 2);
 }
 
 void SdrDeviceRtlsdr::readerThread(void)
 {
-    quint32     samprate;
-    quint32     buflen;
-
     qInfo() << "Entering RTL-SDR reader thread";
 
-    // aim for 20-40 ms buffers but in multiples of 16k
-    samprate = rtlsdr_get_sample_rate(device);
-    if (samprate < 1e6)
-        buflen = 16384;
-    else if (samprate < 2e6)
-        buflen = 4 * 16384;
-    else
-        buflen = 6 * 16384;
-
-    ring_buffer_resize(reader_buffer, 4 * buflen);
-
     // FIXME: return values
     rtlsdr_reset_buffer(device);
-    rtlsdr_read_async(device, &SdrDeviceRtlsdr::readerCallback, this, 0, buflen);
+    rtlsdr_read_async(device, &SdrDeviceRtlsdr::readerCallback, this, 0,
+                      reader_buflen);
 
     qInfo() << "Exiting RTL-SDR reader thread";
 }
@@ -437,6 +399,29 @@ void SdrDeviceRtlsdr::stopReaderThread(void)
     }
 }
 
+void SdrDeviceRtlsdr::updateBufferSize(void)
+{
+    quint32     buflen;
+
+    if (status.rx_is_running)
+        return;
+
+    // aim for 20-40 ms buffers but in multiples of 16k
+    if (settings.sample_rate < 1e6)
+        buflen = 16384;
+    else if (settings.sample_rate < 2e6)
+        buflen = 4 * 16384;
+    else
+        buflen = 6 * 16384;
+
+    if (buflen == reader_buflen)
+        return;
+
+    // buffer 4 transfers of 2 bytes per sample
+    reader_buflen = buflen;
+    resizeRxBuffer(2 * buflen);
+}
+
 void SdrDeviceRtlsdr::setupTunerGains(void)
 {
     int    *gains;
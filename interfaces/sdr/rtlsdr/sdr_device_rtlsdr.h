@@ -9,10 +9,8 @@
 #include <QWidget>
 
 #include <stdint.h>
-#include <mutex>
 #include <thread>
 
-#include "nanosdr/common/ring_buffer.h"
 #include "interfaces/sdr/sdr_device.h"
 #include "sdr_device_rtlsdr_rxctl.h"
 
@@ -29,7 +27,6 @@ public:
     int         saveSettings(QSettings &s) override;
     int         startRx(void) override;
     int         stopRx(void) override;
-    quint32     getRxSamples(complex_t * buffer, quint32 count) override;
     QWidget    *getRxControls(void) override;
 
     int         setRxFrequency(quint64 freq) override;
@@ -50,6 +47,7 @@ private:
 
     static void readerCallback(unsigned char *buf, uint32_t len, void *data);
 
+    void    updateBufferSize(void);
     void    setupTunerGains(void);
     void    applySettings(void);
 
@@ -58,12 +56,10 @@ private:
 
     SdrDeviceRtlsdrRxCtl    rx_ctl;
 
-    ring_buffer_t  *reader_buffer;      // raw sample buffer
-    std::mutex      reader_lock;
+    quint32         reader_buflen;      // USB transfer size in bytes
     std::thread    *reader_thread;
 
     sdr_device_status_t     status;
-    sdr_device_stats_t      stats;
     rtlsdr_settings_t       settings;
 
     int         ds_channel;
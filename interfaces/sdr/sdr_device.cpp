@@ -28,7 +28,9 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 #include <QString>
+#include <string.h>
 
+#include "nanosdr/common/sample_conv.h"
 #include "sdr_device.h"
 
 SdrDevice *sdr_device_create_rtlsdr(void);
@@ -56,9 +58,26 @@ SdrDevice *sdr_device_create(const QString &device_type)
     return nullptr;
 }
 
-SdrDevice::SdrDevice(QObject *parent) : QObject(parent)
+SdrDevice::SdrDevice(QObject *parent) : QObject(parent),
+    rx_buffer(nullptr),
+    rx_policy(SDR_DEVICE_DROP_NEWEST),
+    rx_timeout_ms(0),
+    rx_copy_buf(nullptr),
+    rx_copy_len(0),
+    rx_span_copied(false)
 {
+    rx_format.type = SDR_DEVICE_FMT_CF32;
+    rx_format.sample_size = sizeof(complex_t);
+    rx_format.scale = 1.0f;
+    clearStats(stats);
+}
+
+SdrDevice::~SdrDevice()
+{
+    if (rx_buffer)
+        ring_buffer_spsc_delete(rx_buffer);
 
+    delete[] rx_copy_buf;
 }
 
 int SdrDevice::startRx(void)
@@ -73,9 +92,102 @@ int SdrDevice::stopRx(void)
 
 quint32 SdrDevice::getRxSamples(complex_t * buffer, quint32 count)
 {
-    Q_UNUSED(buffer);
-    Q_UNUSED(count);
-    return 0;
+    const unsigned char    *span;
+    quint32                 avail;
+    quint32                 done = 0;
+
+    if (!rx_buffer || !buffer || count == 0)
+        return 0;
+
+    if (count * rx_format.sample_size > ring_buffer_spsc_count(rx_buffer))
+        return 0;
+
+    // a non-mirrored buffer may need two spans when the data wraps around
+    while (done < count)
+    {
+        span = ring_buffer_spsc_read_ptr(rx_buffer, &avail);
+        avail /= rx_format.sample_size;
+        if (avail > count - done)
+            avail = count - done;
+        if (avail == 0)
+            return done;
+
+        convertRxSamples(span, &buffer[done], avail);
+
+        // samples were dropped by the driver while we were reading them;
+        // the spans before this one are good and already consumed
+        if (!ring_buffer_spsc_read_advance(rx_buffer,
+                                           avail * rx_format.sample_size))
+            return done;
+
+        done += avail;
+    }
+
+    return count;
+}
+
+const complex_t *SdrDevice::acquireRxSamples(quint32 count)
+{
+    const unsigned char    *span;
+    quint32                 avail;
+
+    if (count == 0)
+        return nullptr;
+
+    // native complex samples can be used directly from the buffer
+    if (rx_buffer && rx_format.type == SDR_DEVICE_FMT_CF32)
+    {
+        span = ring_buffer_spsc_read_ptr(rx_buffer, &avail);
+        if (avail >= count * sizeof(complex_t))
+        {
+            rx_span_copied = false;
+            return reinterpret_cast<const complex_t *>(span);
+        }
+    }
+
+    if (rx_buffer &&
+        ring_buffer_spsc_count(rx_buffer) < count * rx_format.sample_size)
+        return nullptr;
+
+    if (count > rx_copy_len)
+    {
+        delete[] rx_copy_buf;
+        rx_copy_buf = new complex_t[count];
+        rx_copy_len = count;
+    }
+
+    if (getRxSamples(rx_copy_buf, count) != count)
+        return nullptr;
+
+    rx_span_copied = true;
+
+    return rx_copy_buf;
+}
+
+bool SdrDevice::releaseRxSamples(quint32 count)
+{
+    if (rx_span_copied)
+    {
+        rx_span_copied = false;
+        return true;
+    }
+
+    if (rx_buffer)
+        return ring_buffer_spsc_read_advance(rx_buffer,
+                                             count * sizeof(complex_t));
+
+    return true;
+}
+
+void SdrDevice::setRxOverrunPolicy(sdr_device_overrun_t policy,
+                                   quint32 timeout_ms)
+{
+    rx_policy = policy;
+    rx_timeout_ms = timeout_ms;
+
+    if (rx_buffer)
+        ring_buffer_spsc_set_policy(rx_buffer, rb_spsc_policy_t(policy),
+                                    timeout_ms);
 }
 
 QWidget *SdrDevice::getRxControls(void)
@@ -112,4 +224,134 @@ void SdrDevice::clearStats(sdr_device_stats_t &stats)
 {
     stats.rx_samples = 0;
     stats.rx_overruns = 0;
+    stats.rx_dropped = 0;
+}
+
+void *SdrDevice::reserveRxSamples(quint32 &count)
+{
+    unsigned char  *ptr;
+    quint32         space;
+    quint32         discarded;
+
+    if (!rx_buffer)
+    {
+        count = 0;
+        return nullptr;
+    }
+
+    discarded = ring_buffer_spsc_make_room(rx_buffer,
+                                           count * rx_format.sample_size);
+    if (discarded)
+        rxOverrun(discarded / rx_format.sample_size);
+
+    ptr = ring_buffer_spsc_write_ptr(rx_buffer, &space);
+    space /= rx_format.sample_size;
+    if (count > space)
+        count = space;
+
+    return ptr;
+}
+
+void SdrDevice::commitRxSamples(quint32 count)
+{
+    ring_buffer_spsc_write_commit(rx_buffer, count * rx_format.sample_size);
+}
+
+quint32 SdrDevice::writeRxSamples(const void * samples, quint32 count)
+{
+    quint32     dropped = count;
+
+    if (rx_buffer)
+        dropped = ring_buffer_spsc_push(rx_buffer,
+                                        static_cast<const unsigned char *>(samples),
+                                        count * rx_format.sample_size)
+                  / rx_format.sample_size;
+
+    if (dropped)
+        rxOverrun(dropped);
+
+    return dropped;
+}
+
+void SdrDevice::rxOverrun(quint32 dropped)
+{
+    stats.rx_overruns++;
+    stats.rx_dropped += dropped;
+}
+
+void SdrDevice::discardRxSamples(void)
+{
+    if (rx_buffer)
+        (void)ring_buffer_spsc_discard(rx_buffer);
+}
+
+void SdrDevice::setRxFormat(sdr_device_fmt_t type, real_t scale)
+{
+    quint32     old_size = rx_format.sample_size;
+    quint32     num_samples = 0;
+
+    if (rx_buffer)
+        num_samples = ring_buffer_spsc_size(rx_buffer) / old_size;
+
+    rx_format.type = type;
+    rx_format.scale = scale;
+    switch (type)
+    {
+    case SDR_DEVICE_FMT_CU8:
+        rx_format.sample_size = 2 * sizeof(uint8_t);
+        break;
+    case SDR_DEVICE_FMT_CS16:
+        rx_format.sample_size = 2 * sizeof(int16_t);
+        break;
+    case SDR_DEVICE_FMT_CF32:
+    default:
+        rx_format.type = SDR_DEVICE_FMT_CF32;
+        rx_format.sample_size = sizeof(complex_t);
+        break;
+    }
+
+    // the buffer is only reallocated if the sample size changes
+    if (num_samples && rx_format.sample_size != old_size)
+        ring_buffer_spsc_resize(rx_buffer, num_samples * rx_format.sample_size);
+}
+
+void SdrDevice::resizeRxBuffer(quint32 num_samples)
+{
+    quint32     cur_size;
+
+    if (num_samples == 0)
+        return;
+
+    if (!rx_buffer)
+    {
+        rx_buffer = ring_buffer_spsc_create();
+        ring_buffer_spsc_init(rx_buffer, num_samples * rx_format.sample_size);
+        ring_buffer_spsc_set_policy(rx_buffer, rb_spsc_policy_t(rx_policy),
+                                    rx_timeout_ms);
+        return;
+    }
+
+    cur_size = ring_buffer_spsc_size(rx_buffer) / rx_format.sample_size;
+    if (cur_size >= num_samples && cur_size < 2 * num_samples)
+        return;
+
+    ring_buffer_spsc_resize(rx_buffer, num_samples * rx_format.sample_size);
+}
+
+void SdrDevice::convertRxSamples(const void *in, complex_t *out,
+                                 quint32 count)
+{
+    switch (rx_format.type)
+    {
+    case SDR_DEVICE_FMT_CU8:
+        sample_conv_u8_to_cplx(static_cast<const uint8_t *>(in), out, count);
+        break;
+    case SDR_DEVICE_FMT_CS16:
+        sample_conv_s16_to_cplx(static_cast<const int16_t *>(in), out, count,
+                                rx_format.scale);
+        break;
+    case SDR_DEVICE_FMT_CF32:
+        memcpy(out, in, count * sizeof(complex_t));
+        break;
+    }
 }
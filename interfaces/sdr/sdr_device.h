@@ -9,6 +9,7 @@
 #include <QWidget>
 
 #include "nanosdr/common/datatypes.h"
+#include "nanosdr/common/ring_buffer_spsc.h"
 
 
 /* clang-format off */
@@ -32,16 +33,38 @@ typedef struct {
 } sdr_device_status_t;
 
 typedef struct {
-    quint64     rx_samples;
-    quint64     rx_overruns;
+    quint64     rx_samples;     // samples received from the device
+    quint64     rx_overruns;    // number of overrun events
+    quint64     rx_dropped;     // samples lost due to overruns
 } sdr_device_stats_t;
 
+// What to do when the DSP thread can not keep up with the device
+typedef enum {
+    SDR_DEVICE_DROP_NEWEST = RB_SPSC_DROP_NEWEST,   // drop incoming samples
+    SDR_DEVICE_DROP_OLDEST = RB_SPSC_DROP_OLDEST,   // drop buffered samples
+    SDR_DEVICE_BLOCK = RB_SPSC_BLOCK                // block driver thread
+} sdr_device_overrun_t;
+
+// Sample formats used in the device sample buffer
+typedef enum {
+    SDR_DEVICE_FMT_CF32 = 0,    // complex_t
+    SDR_DEVICE_FMT_CU8 = 1,     // interleaved unsigned 8 bit I/Q (RTL-SDR)
+    SDR_DEVICE_FMT_CS16 = 2     // interleaved signed 16 bit I/Q
+} sdr_device_fmt_t;
+
+typedef struct {
+    sdr_device_fmt_t    type;
+    quint32             sample_size;    // bytes per complex sample
+    real_t              scale;          // CS16 scale factor, e.g. 1/2048
+} sdr_device_format_t;
+
 class SdrDevice : public QObject
 {
     Q_OBJECT
 
 public:
     explicit SdrDevice(QObject *parent = nullptr);
+    virtual ~SdrDevice();
 
     virtual int         open(void) = 0;
     virtual int         close(void) = 0;
@@ -49,9 +72,58 @@ public:
     virtual int         saveSettings(QSettings &s) = 0;
     virtual int         startRx(void);
     virtual int         stopRx(void);
-    virtual quint32     getRxSamples(complex_t * buffer, quint32 count);
     virtual QWidget    *getRxControls(void);
 
+    const sdr_device_stats_t &getStats(void) const
+    {
+        return stats;
+    }
+
+    // Format of the samples in the device buffer
+    const sdr_device_format_t &getRxFormat(void) const
+    {
+        return rx_format;
+    }
+
+    /*
+     * Set the overrun policy for the sample buffer. timeout_ms is only used
+     * with SDR_DEVICE_BLOCK and is the maximum time the driver thread will
+     * wait for space before dropping samples. Should be called while RX is
+     * stopped.
+     */
+    void    setRxOverrunPolicy(sdr_device_overrun_t policy,
+                               quint32 timeout_ms = 0);
+
+    /*
+     * Read samples from the device (consumer side).
+     *
+     * The samples are kept in the native format of the device and are
+     * converted to complex_t while being read, so that the conversion is
+     * done in the DSP thread in the same pass as the copy.
+     *
+     * getRxSamples() converts count samples into buffer. It returns count or
+     * 0 if less than count samples are available. It returns less than count
+     * if the driver discarded samples during the read.
+     *
+     * acquireRxSamples() returns a read-only pointer to count contiguous
+     * samples, or nullptr if less than count samples are available. For
+     * SDR_DEVICE_FMT_CF32 the pointer points into the device buffer, for
+     * other formats to an internal buffer holding the converted samples.
+     * The samples remain valid until they are released using
+     * releaseRxSamples(count). Only one span may be acquired at a time.
+     * releaseRxSamples() returns false if the samples were discarded by the
+     * driver while in use, which can only happen with the
+     * SDR_DEVICE_DROP_OLDEST policy or when the driver resets the stream.
+     *
+     * All three functions must be called from the same thread. The default
+     * implementations read from rx_buffer. Drivers that use their own buffer
+     * override getRxSamples(), in which case acquireRxSamples() falls back to
+     * copying the samples via getRxSamples().
+     */
+    virtual quint32             getRxSamples(complex_t * buffer, quint32 count);
+    virtual const complex_t    *acquireRxSamples(quint32 count);
+    virtual bool                releaseRxSamples(quint32 count);
+
     virtual int         setRxFrequency(quint64 freq);
     virtual int         setRxSampleRate(quint32 rate);
     virtual int         setRxBandwidth(quint32 bw);
@@ -59,6 +131,63 @@ public:
 protected:
     void    clearStatus(sdr_device_status_t &status);
     void    clearStats(sdr_device_stats_t &stats);
+
+    /*
+     * Write samples into rx_buffer (producer side).
+     *
+     * The samples are in the format set using setRxFormat() and count is
+     * always in complex samples.
+     *
+     * reserveRxSamples() returns a pointer to free space in rx_buffer where
+     * the driver can write samples directly, e.g. when the device library
+     * can receive into a user buffer. The overrun policy is applied first. On return,
+     * count holds the number of contiguous samples that can be written,
+     * which is less than requested if the buffer is full. The samples are
+     * made available to the consumer using commitRxSamples(). Samples that
+     * do not fit must be reported using rxOverrun().
+     *
+     * writeRxSamples() copies the samples into rx_buffer using the overrun
+     * policy and returns the number of samples dropped.
+     *
+     * Both update the overrun statistics, but not rx_samples.
+     *
+     * discardRxSamples() drops all unread samples, e.g. when the device
+     * library signals a stream reset or before RX is started.
+     */
+    void       *reserveRxSamples(quint32 &count);
+    void        commitRxSamples(quint32 count);
+    quint32     writeRxSamples(const void * samples, quint32 count);
+    void        rxOverrun(quint32 dropped);
+    void        discardRxSamples(void);
+
+    /*
+     * Set the format of the samples written to rx_buffer. scale is only used
+     * for SDR_DEVICE_FMT_CS16. Should be called before resizeRxBuffer(); if
+     * the buffer already exists and the sample size changes it is
+     * reallocated, so this may only be called while neither the driver nor
+     * the DSP thread is using it.
+     */
+    void        setRxFormat(sdr_device_fmt_t type, real_t scale = 1.0f);
+
+    /*
+     * Allocate or resize rx_buffer to hold at least num_samples samples. The
+     * size is rounded up to a power of two. The buffer is lock-free, so it
+     * can only be resized while RX is stopped.
+     */
+    void        resizeRxBuffer(quint32 num_samples);
+
+    ring_buffer_spsc_t     *rx_buffer;
+    sdr_device_format_t     rx_format;
+    sdr_device_stats_t      stats;
+    sdr_device_overrun_t    rx_policy;
+    quint32                 rx_timeout_ms;
+
+private:
+    void        convertRxSamples(const void *in, complex_t *out, quint32 count);
+
+    complex_t  *rx_copy_buf;    // used when a span can not be borrowed
+    quint32     rx_copy_len;
+    bool        rx_span_copied;
 };
 
 SdrDevice *sdr_device_create(const QString &device_type);
@@ -29,7 +29,8 @@
 
 #include <stdint.h>
 
-#include "common/ring_buffer_cplx.h"
+#include "common/ring_buffer_spsc.h"
+#include "common/sample_conv.h"
 #include "sdr_device_sdrplay.h"
 #include "sdr_device_sdrplay_api.h"
 
@@ -41,6 +42,8 @@
 #define DEFAULT_LO_MODE     mir_sdr_LO_Auto
 #define DEFAULT_IF_MODE     mir_sdr_IF_Zero
 
+#define SAMPLE_SCALE        (1.0f / 32768.f)
+
 #define CFG_KEY_LNA_STATE   "sdrplay/lna_state"
 #define CFG_KEY_GRDB        "sdrplay/gain_reduction"
 #define CFG_KEY_GAIN_MODE   "sdrplay/gain_mode"
@@ -71,8 +74,8 @@ SdrDeviceSdrplay::SdrDeviceSdrplay(QObject *parent) :
     settings.lo_mode = DEFAULT_LO_MODE;
     settings.if_mode = DEFAULT_IF_MODE;
 
-    sample_buffer = ring_buffer_cplx_create();
-    ring_buffer_cplx_init(sample_buffer, quint32(0.5 * settings.sample_rate));
+    setRxFormat(SDR_DEVICE_FMT_CS16, SAMPLE_SCALE);
+    updateBufferSize();
 
     // connect rx_ctl signals to slots
     rx_ctl.setEnabled(false);
@@ -91,8 +94,6 @@ SdrDeviceSdrplay::~SdrDeviceSdrplay()
 
     if (status.driver_is_loaded)
         driver.unload();
-
-    ring_buffer_cplx_delete(sample_buffer);
 }
 
 // There is no specific "open" function in the SDRplay API; however, it seems
@@ -244,6 +245,7 @@ int SdrDeviceSdrplay::startRx(void)
     grdb = settings.grdb < mir_sdr_NORMAL_MIN_GR ? mir_sdr_NORMAL_MIN_GR : settings.grdb;
 
     qDebug() << "Starting SDRplay...";
+    discardRxSamples();
     result = mir_sdr_StreamInit(&grdb,
                                 1.e-6 * double(settings.sample_rate),
                                 1.e-6 * double(settings.frequency),
@@ -287,27 +289,11 @@ int SdrDeviceSdrplay::stopRx(void)
     if (result != mir_sdr_Success)
         qInfo() << "mir_sdr_StreamUninit() failed with error code" << result;
 
-    ring_buffer_cplx_clear(sample_buffer);
     status.rx_is_running = false;
 
     return SDR_DEVICE_OK;
 }
 
-quint32 SdrDeviceSdrplay::getRxSamples(complex_t * buffer, quint32 count)
-{
-    std::lock_guard<std::mutex> lock(reader_lock);
-
-    if (!buffer || count == 0)
-        return 0;
-
-    if (count > ring_buffer_cplx_count(sample_buffer))
-        return 0;
-
-    ring_buffer_cplx_read(sample_buffer, buffer, count);
-
-    return count;
-}
-
 QWidget *SdrDeviceSdrplay::getRxControls(void)
 {
     return  &rx_ctl;
@@ -454,15 +440,10 @@ void SdrDeviceSdrplay::setGrdb(int grdb)
 
 void SdrDeviceSdrplay::updateBufferSize(void)
 {
-
-    std::lock_guard<std::mutex> lock(reader_lock);
     quint32 new_size = quint32(0.5 * settings.sample_rate); // 500 msec
 
-    if (new_size == 0 || new_size == ring_buffer_cplx_size(sample_buffer))
-        return;
-
-    ring_buffer_cplx_clear(sample_buffer);
-    ring_buffer_cplx_resize(sample_buffer, new_size);
+    if (!status.rx_is_running)
+        resizeRxBuffer(new_size);
 }
 
 // returns the band according to the table in sec 6 of API docs
@@ -513,46 +494,43 @@ void SdrDeviceSdrplay::streamCallback(short *xi, short *xq, unsigned int first_s
                                       unsigned int num_samples, unsigned int reset,
                                       unsigned int hw_removed, void *ctx)
 {
-#define WORK_BUF_SIZE 8192
-#define SAMPLE_SCALE  1.0f / 32768.f
-
     Q_UNUSED(first_sample_num);
     Q_UNUSED(gr_changed);
     Q_UNUSED(rf_changed);
     Q_UNUSED(fs_changed);
 
     SdrDeviceSdrplay   *this_radio = reinterpret_cast<SdrDeviceSdrplay *>(ctx);
-    complex_t           work_buf[WORK_BUF_SIZE];
-    unsigned int        i;
+    int16_t            *out;
+    quint32             len;
+    unsigned int        n;
 
     if (hw_removed)
     {
         // signal stopped
     }
 
-    if (num_samples > WORK_BUF_SIZE)
-    {
-        qCritical() << "SdrDeviceSdrplay::streamCallback work buffer too small";
-        num_samples = WORK_BUF_SIZE;
-    }
+    if (reset)
+        this_radio->discardRxSamples();
 
-    for (i = 0; i < num_samples; i++)
-    {
-        work_buf[i].re = float(xi[i]) * SAMPLE_SCALE;
-        work_buf[i].im = float(xq[i]) * SAMPLE_SCALE;
-    }
+    this_radio->stats.rx_samples += num_samples;
 
-    if (num_samples > ring_buffer_cplx_size(this_radio->sample_buffer))
-        num_samples = ring_buffer_cplx_size(this_radio->sample_buffer);
+    // interleave directly into the sample buffer; the span may be split if
+    // the buffer is not mirrored
+    n = 0;
+    while (n < num_samples)
+    {
+        len = num_samples - n;
+        out = static_cast<int16_t *>(this_radio->reserveRxSamples(len));
+        if (len == 0)
+        {
+            this_radio->rxOverrun(num_samples - n);
+            break;
+        }
 
-    this_radio->reader_lock.lock();
-    if (reset)
-        ring_buffer_cplx_clear(this_radio->sample_buffer);
-    ring_buffer_cplx_write(this_radio->sample_buffer, work_buf, num_samples);
-    this_radio->stats.rx_samples += num_samples;
-    if (ring_buffer_cplx_is_full(this_radio->sample_buffer))
-        this_radio->stats.rx_overruns++;
-    this_radio->reader_lock.unlock();
+        sample_conv_s16_interleave(&xi[n], &xq[n], out, len);
+        this_radio->commitRxSamples(len);
+        n += len;
+    }
 }
 
 void SdrDeviceSdrplay::gainChangeCallback(unsigned int gRdB, unsigned int lnaGRdB,
@@ -8,9 +8,6 @@
 #include <QSettings>
 #include <QWidget>
 
-#include <mutex>
-
-#include "nanosdr/common/ring_buffer.h"
 #include "interfaces/sdr/sdr_device.h"
 #include "sdr_device_sdrplay_api_defs.h"
 #include "sdr_device_sdrplay_rxctl.h"
@@ -29,7 +26,6 @@ public:
     int         saveSettings(QSettings &s) override;
     int         startRx(void) override;
     int         stopRx(void) override;
-    quint32     getRxSamples(complex_t * buffer, quint32 count) override;
     QWidget    *getRxControls(void) override;
 
     int         setRxFrequency(quint64 freq) override;
@@ -60,11 +56,7 @@ private:
 
     SdrDeviceSdrplayRxctl   rx_ctl;
 
-    ring_buffer_t  *sample_buffer;
-    std::mutex      reader_lock;
-
     sdr_device_status_t     status;
-    sdr_device_stats_t      stats;
     sdrplay_settings_t      settings;
 
     unsigned char           hw_ver;
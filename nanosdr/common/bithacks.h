@@ -32,6 +32,17 @@ inline unsigned int next_power_of_two(unsigned int v)
     return v;
 }
 
+/* Find the log base 2 of an integer, i.e. the position of the highest bit */
+inline unsigned int ilog2(unsigned int v)
+{
+    unsigned int r = 0;
+
+    while (v >>= 1)
+        r++;
+
+    return r;
+}
+
 #ifdef __cplusplus
 }
 #endif
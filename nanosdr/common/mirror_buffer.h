@@ -0,0 +1,130 @@
+/*
+ * Virtual memory mirrored buffer allocation for nanosdr.
+ *
+ * Copyright 2019 Alexandru Csete OZ9AEC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Mirrored buffer allocation.
+ *
+ * mirror_buffer_alloc() maps the same memory twice back to back, i.e.
+ * buf[i] and buf[i + size] refer to the same byte for 0 <= i < size. A ring
+ * buffer using such memory can always read or write any region of up to size
+ * bytes as one contiguous span, even when it wraps around the end.
+ *
+ * The memory is backed by an anonymous memfd and is only available on Linux.
+ * On other systems, or if any of the system calls fail, NULL is returned and
+ * the caller should fall back to a normal allocation.
+ *
+ * The size must be a multiple of the page size; see
+ * mirror_buffer_page_size().
+ */
+
+static inline uint32_t mirror_buffer_page_size(void)
+{
+#if defined(__linux__)
+    long    page_size = sysconf(_SC_PAGESIZE);
+
+    return page_size > 0 ? (uint32_t)page_size : 4096;
+#else
+    return 4096;
+#endif
+}
+
+/*
+ * Allocate mirrored buffer of size bytes. The returned pointer gives access
+ * to 2 * size bytes of address space and must be freed using
+ * mirror_buffer_free().
+ */
+static inline unsigned char *mirror_buffer_alloc(uint32_t size)
+{
+#if defined(__linux__) && defined(SYS_memfd_create)
+    unsigned char  *addr;
+    void           *ret;
+    int             fd;
+
+    if (size == 0 || size % mirror_buffer_page_size())
+        return NULL;
+
+    fd = (int)syscall(SYS_memfd_create, "nanosdr_mirror", 0);
+    if (fd < 0)
+        return NULL;
+
+    if (ftruncate(fd, (off_t)size) != 0)
+        goto error_close;
+
+    /* reserve address space for both copies, then map the file into it */
+    ret = mmap(NULL, 2 * (size_t)size, PROT_NONE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ret == MAP_FAILED)
+        goto error_close;
+    addr = (unsigned char *)ret;
+
+    ret = mmap(addr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+               fd, 0);
+    if (ret != addr)
+        goto error_unmap;
+
+    ret = mmap(addr + size, size, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_FIXED, fd, 0);
+    if (ret != addr + size)
+        goto error_unmap;
+
+    /* the mappings keep the memory alive */
+    close(fd);
+
+    return addr;
+
+error_unmap:
+    munmap(addr, 2 * (size_t)size);
+error_close:
+    close(fd);
+    return NULL;
+#else
+    (void)size;
+    return NULL;
+#endif
+}
+
+static inline void mirror_buffer_free(unsigned char *buf, uint32_t size)
+{
+#if defined(__linux__)
+    if (buf)
+        munmap(buf, 2 * (size_t)size);
+#else
+    (void)buf;
+    (void)size;
+#endif
+}
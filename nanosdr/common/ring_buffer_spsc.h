@@ -0,0 +1,500 @@
+/*
+ * Lock-free single-producer single-consumer ring buffer for nanosdr.
+ *
+ * Copyright 2019 Alexandru Csete OZ9AEC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mirror_buffer.h"
+
+/*
+ * Lock-free single-producer single-consumer (SPSC) byte FIFO.
+ *
+ * Exactly one thread may call the producer functions (ring_buffer_spsc_write,
+ * ring_buffer_spsc_push and ring_buffer_spsc_discard) and exactly one thread
+ * may call the consumer functions (ring_buffer_spsc_read and
+ * ring_buffer_spsc_clear) at the same time. No locking is needed between the
+ * two.
+ *
+ * The head index is only written by the producer and published with release
+ * semantics. The tail index is updated by the consumer using compare and
+ * swap, because the producer may also advance it when the drop-oldest policy
+ * is used (see below). This guarantees that the data is visible before the
+ * index that makes it available.
+ *
+ * The buffer size is always rounded up to a power of two so that indices
+ * can be wrapped using a mask instead of a division.
+ *
+ * Overrun policy:
+ *
+ * ring_buffer_spsc_write() never overwrites unread data. If there is
+ * insufficient space, the newest data is dropped and the function returns
+ * the number of bytes that were actually written.
+ *
+ * ring_buffer_spsc_push() and ring_buffer_spsc_make_room() apply the policy
+ * set using ring_buffer_spsc_set_policy():
+ *
+ *   RB_SPSC_DROP_NEWEST  Data that does not fit is dropped (default).
+ *   RB_SPSC_DROP_OLDEST  The producer discards the oldest data to make room.
+ *                        A consumer that was reading the discarded data
+ *                        detects this when it tries to release it and
+ *                        retries; see ring_buffer_spsc_read_advance().
+ *   RB_SPSC_BLOCK        The producer waits up to timeout_ms for the
+ *                        consumer to make room, then drops the newest data.
+ *
+ * The number of bytes dropped is returned so that the caller can keep
+ * exact statistics.
+ *
+ * ring_buffer_spsc_init(), ring_buffer_spsc_resize() and
+ * ring_buffer_spsc_delete() are not thread safe and may only be called while
+ * neither producer nor consumer is active.
+ *
+ * Zero-copy access:
+ *
+ * If the buffer size is a multiple of the page size, the buffer memory is
+ * allocated using mirror_buffer_alloc() so that any readable or writable
+ * region is one contiguous span. The span functions give direct access to
+ * the buffer memory:
+ *
+ *   ring_buffer_spsc_read_ptr()     / ring_buffer_spsc_read_advance()
+ *   ring_buffer_spsc_write_ptr()    / ring_buffer_spsc_write_commit()
+ *
+ * If mirrored memory is not available, the spans end at the edge of the
+ * buffer and the caller will see the remaining data on the next call.
+ */
+
+/* keep head and tail on separate cache lines to avoid false sharing */
+#define RB_SPSC_CACHE_LINE  64
+
+typedef enum {
+    RB_SPSC_DROP_NEWEST = 0,
+    RB_SPSC_DROP_OLDEST = 1,
+    RB_SPSC_BLOCK = 2
+} rb_spsc_policy_t;
+
+typedef struct {
+    uint32_t        size;   /* buffer size in bytes (power of 2) */
+    uint32_t        mask;   /* size - 1 */
+    unsigned char  *buffer;
+    uint32_t        mirrored;   /* buffer is mapped twice, see mirror_buffer.h */
+    uint32_t        policy;     /* rb_spsc_policy_t */
+    uint32_t        timeout_ms; /* timeout for RB_SPSC_BLOCK */
+    char            _pad0[RB_SPSC_CACHE_LINE - 5 * sizeof(uint32_t) -
+                          sizeof(unsigned char *)];
+    uint32_t        head;   /* write index, owned by producer */
+    char            _pad1[RB_SPSC_CACHE_LINE - sizeof(uint32_t)];
+    uint32_t        tail;   /* read index */
+    uint32_t        span_tail;  /* tail at the time of the last read_ptr */
+    char            _pad2[RB_SPSC_CACHE_LINE - 2 * sizeof(uint32_t)];
+} ring_buffer_spsc_t;
+
+static inline uint32_t rb_spsc_load_acquire(const uint32_t *idx)
+{
+    return __atomic_load_n(idx, __ATOMIC_ACQUIRE);
+}
+
+static inline void rb_spsc_store_release(uint32_t *idx, uint32_t val)
+{
+    __atomic_store_n(idx, val, __ATOMIC_RELEASE);
+}
+
+/* Move tail from old to new. Fails if the tail has been moved by somebody
+ * else in the meantime. */
+static inline int rb_spsc_move_tail(ring_buffer_spsc_t *rb, uint32_t old,
+                                    uint32_t new_tail)
+{
+    return __atomic_compare_exchange_n(&rb->tail, &old, new_tail, 0,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+static inline ring_buffer_spsc_t *ring_buffer_spsc_create(void)
+{
+    ring_buffer_spsc_t *rb;
+
+    rb = (ring_buffer_spsc_t *)calloc(1, sizeof(ring_buffer_spsc_t));
+
+    return rb;
+}
+
+static inline void rb_spsc_free_buffer(ring_buffer_spsc_t *rb)
+{
+    if (rb->mirrored)
+        mirror_buffer_free(rb->buffer, rb->size);
+    else
+        free(rb->buffer);
+
+    rb->buffer = NULL;
+    rb->mirrored = 0;
+}
+
+static inline void ring_buffer_spsc_delete(ring_buffer_spsc_t *rb)
+{
+    if (rb)
+    {
+        rb_spsc_free_buffer(rb);
+        free(rb);
+    }
+}
+
+/*
+ * Initialize buffer. The size is rounded up to the next power of two. If the
+ * resulting size is a multiple of the page size, mirrored memory is used.
+ */
+static inline void ring_buffer_spsc_init(ring_buffer_spsc_t *rb, uint32_t size)
+{
+    rb->size = 1;
+    while (rb->size < size)
+        rb->size <<= 1;
+    rb->mask = rb->size - 1;
+    rb->head = 0;
+    rb->tail = 0;
+    rb->span_tail = 0;
+
+    rb->buffer = NULL;
+    if (rb->size % mirror_buffer_page_size() == 0)
+        rb->buffer = mirror_buffer_alloc(rb->size);
+
+    if (rb->buffer)
+    {
+        rb->mirrored = 1;
+    }
+    else
+    {
+        rb->mirrored = 0;
+        rb->buffer = (unsigned char *)malloc(rb->size);
+    }
+}
+
+static inline void ring_buffer_spsc_resize(ring_buffer_spsc_t *rb,
+                                           uint32_t            newsize)
+{
+    rb_spsc_free_buffer(rb);
+    ring_buffer_spsc_init(rb, newsize);
+}
+
+static inline int ring_buffer_spsc_is_mirrored(const ring_buffer_spsc_t *rb)
+{
+    return rb->mirrored;
+}
+
+/* Set overrun policy. Not thread safe; call before starting the producer. */
+static inline void ring_buffer_spsc_set_policy(ring_buffer_spsc_t *rb,
+                                               rb_spsc_policy_t    policy,
+                                               uint32_t            timeout_ms)
+{
+    rb->policy = (uint32_t)policy;
+    rb->timeout_ms = timeout_ms;
+}
+
+static inline uint32_t ring_buffer_spsc_size(const ring_buffer_spsc_t *rb)
+{
+    return rb->size;
+}
+
+/* Number of bytes available for reading. Can be called from either side. */
+static inline uint32_t ring_buffer_spsc_count(const ring_buffer_spsc_t *rb)
+{
+    return rb_spsc_load_acquire(&rb->head) - rb_spsc_load_acquire(&rb->tail);
+}
+
+/* Number of bytes available for writing. Can be called from either side. */
+static inline uint32_t ring_buffer_spsc_space(const ring_buffer_spsc_t *rb)
+{
+    return rb->size - ring_buffer_spsc_count(rb);
+}
+
+static inline int ring_buffer_spsc_is_empty(const ring_buffer_spsc_t *rb)
+{
+    return ring_buffer_spsc_count(rb) == 0;
+}
+
+static inline int ring_buffer_spsc_is_full(const ring_buffer_spsc_t *rb)
+{
+    return ring_buffer_spsc_count(rb) == rb->size;
+}
+
+/*
+ * Write up to num bytes into the buffer (producer only).
+ *
+ * Returns the number of bytes written. This is less than num if the buffer
+ * does not have room for all the data, in which case the remaining bytes are
+ * dropped.
+ */
+static inline uint32_t ring_buffer_spsc_write(ring_buffer_spsc_t  *rb,
+                                              const unsigned char *src,
+                                              uint32_t             num)
+{
+    uint32_t    head = rb->head;   /* we own head, no need for atomic load */
+    uint32_t    tail = rb_spsc_load_acquire(&rb->tail);
+    uint32_t    space = rb->size - (head - tail);
+    uint32_t    wp, first;
+
+    if (num > space)
+        num = space;
+    if (num == 0)
+        return 0;
+
+    wp = head & rb->mask;
+    first = rb->size - wp;
+    if (num <= first || rb->mirrored)
+    {
+        memcpy(&rb->buffer[wp], src, num);
+    }
+    else
+    {
+        memcpy(&rb->buffer[wp], src, first);
+        memcpy(rb->buffer, &src[first], num - first);
+    }
+
+    rb_spsc_store_release(&rb->head, head + num);
+
+    return num;
+}
+
+/*
+ * Read up to num bytes from the buffer (consumer only).
+ *
+ * Returns the number of bytes read, which is less than num if the buffer
+ * contains less than num bytes.
+ */
+static inline uint32_t ring_buffer_spsc_read(ring_buffer_spsc_t *rb,
+                                             unsigned char      *dest,
+                                             uint32_t            num)
+{
+    uint32_t    tail, head, count, n;
+    uint32_t    rp, first;
+
+    do
+    {
+        tail = rb_spsc_load_acquire(&rb->tail);
+        head = rb_spsc_load_acquire(&rb->head);
+        count = head - tail;
+
+        n = (num > count) ? count : num;
+        if (n == 0)
+            return 0;
+
+        rp = tail & rb->mask;
+        first = rb->size - rp;
+        if (n <= first || rb->mirrored)
+        {
+            memcpy(dest, &rb->buffer[rp], n);
+        }
+        else
+        {
+            memcpy(dest, &rb->buffer[rp], first);
+            memcpy(&dest[first], rb->buffer, n - first);
+        }
+
+        /* retry if the producer discarded the data while we copied it */
+    } while (!rb_spsc_move_tail(rb, tail, tail + n));
+
+    return n;
+}
+
+/* Discard all data currently in the buffer (consumer only). */
+static inline void ring_buffer_spsc_clear(ring_buffer_spsc_t *rb)
+{
+    uint32_t    tail;
+
+    do
+    {
+        tail = rb_spsc_load_acquire(&rb->tail);
+    } while (!rb_spsc_move_tail(rb, tail, rb_spsc_load_acquire(&rb->head)));
+}
+
+/* Discard up to num bytes of the oldest data (consumer only). */
+static inline void ring_buffer_spsc_skip(ring_buffer_spsc_t *rb, uint32_t num)
+{
+    uint32_t    tail, count;
+
+    do
+    {
+        tail = rb_spsc_load_acquire(&rb->tail);
+        count = rb_spsc_load_acquire(&rb->head) - tail;
+        if (num > count)
+            num = count;
+    } while (!rb_spsc_move_tail(rb, tail, tail + num));
+}
+
+/*
+ * Discard all data currently in the buffer (producer only), e.g. when the
+ * data source is reset. A consumer that was reading the discarded data
+ * detects this the same way as with RB_SPSC_DROP_OLDEST.
+ *
+ * Returns the number of bytes discarded.
+ */
+static inline uint32_t ring_buffer_spsc_discard(ring_buffer_spsc_t *rb)
+{
+    uint32_t    tail;
+
+    do
+    {
+        tail = rb_spsc_load_acquire(&rb->tail);
+    } while (!rb_spsc_move_tail(rb, tail, rb->head));
+
+    return rb->head - tail;
+}
+
+/*
+ * Make room for num bytes according to the overrun policy (producer only).
+ *
+ * For RB_SPSC_DROP_OLDEST the oldest data is discarded and the number of
+ * discarded bytes is returned. For RB_SPSC_BLOCK the function waits until
+ * there is room or the timeout expires. num is limited to the buffer size.
+ *
+ * Returns the number of bytes of old data that were discarded.
+ */
+static inline uint32_t ring_buffer_spsc_make_room(ring_buffer_spsc_t *rb,
+                                                  uint32_t            num)
+{
+    struct timespec ts = { 0, 100000 };   /* 100 us */
+    uint32_t        head = rb->head;
+    uint32_t        tail, space;
+    uint32_t        waited_us = 0;
+
+    if (num > rb->size)
+        num = rb->size;
+
+    for (;;)
+    {
+        tail = rb_spsc_load_acquire(&rb->tail);
+        space = rb->size - (head - tail);
+        if (space >= num)
+            return 0;
+
+        if (rb->policy == RB_SPSC_DROP_OLDEST)
+        {
+            if (rb_spsc_move_tail(rb, tail, tail + num - space))
+                return num - space;
+        }
+        else if (rb->policy == RB_SPSC_BLOCK &&
+                 waited_us < 1000 * rb->timeout_ms)
+        {
+            nanosleep(&ts, NULL);
+            waited_us += 100;
+        }
+        else
+        {
+            return 0;
+        }
+    }
+}
+
+/*
+ * Write num bytes using the overrun policy (producer only).
+ *
+ * Returns the number of bytes dropped, i.e. old data discarded for
+ * RB_SPSC_DROP_OLDEST and new data that did not fit for the other policies.
+ * A return value of 0 means that no data was lost.
+ */
+static inline uint32_t ring_buffer_spsc_push(ring_buffer_spsc_t  *rb,
+                                             const unsigned char *src,
+                                             uint32_t             num)
+{
+    uint32_t    dropped = 0;
+
+    /* only the most recent data can fit */
+    if (rb->policy == RB_SPSC_DROP_OLDEST && num > rb->size)
+    {
+        dropped = num - rb->size;
+        src += dropped;
+        num = rb->size;
+    }
+
+    dropped += ring_buffer_spsc_make_room(rb, num);
+
+    return dropped + num - ring_buffer_spsc_write(rb, src, num);
+}
+
+/*
+ * Get pointer to the readable data (consumer only).
+ *
+ * On return, count contains the number of bytes that can be accessed
+ * contiguously starting at the returned pointer. The data remains in the
+ * buffer until it is released using ring_buffer_spsc_read_advance().
+ */
+static inline const unsigned char *
+ring_buffer_spsc_read_ptr(ring_buffer_spsc_t *rb, uint32_t *count)
+{
+    uint32_t    tail = rb_spsc_load_acquire(&rb->tail);
+    uint32_t    rp = tail & rb->mask;
+    uint32_t    avail = rb_spsc_load_acquire(&rb->head) - tail;
+
+    if (!rb->mirrored && avail > rb->size - rp)
+        avail = rb->size - rp;
+
+    rb->span_tail = tail;
+    *count = avail;
+
+    return &rb->buffer[rp];
+}
+
+/*
+ * Release num bytes previously obtained by ring_buffer_spsc_read_ptr().
+ *
+ * Returns 1 on success, or 0 if the producer discarded the data while it was
+ * being accessed (RB_SPSC_DROP_OLDEST only). In that case the data must be
+ * considered corrupt and nothing is released.
+ */
+static inline int ring_buffer_spsc_read_advance(ring_buffer_spsc_t *rb,
+                                                uint32_t            num)
+{
+    return rb_spsc_move_tail(rb, rb->span_tail, rb->span_tail + num);
+}
+
+/*
+ * Get pointer to the free space (producer only).
+ *
+ * On return, space contains the number of bytes that can be written
+ * contiguously starting at the returned pointer. The data is made available
+ * to the consumer using ring_buffer_spsc_write_commit().
+ */
+static inline unsigned char *ring_buffer_spsc_write_ptr(ring_buffer_spsc_t *rb,
+                                                        uint32_t *space)
+{
+    uint32_t    head = rb->head;
+    uint32_t    wp = head & rb->mask;
+    uint32_t    avail = rb->size - (head - rb_spsc_load_acquire(&rb->tail));
+
+    if (!rb->mirrored && avail > rb->size - wp)
+        avail = rb->size - wp;
+
+    *space = avail;
+
+    return &rb->buffer[wp];
+}
+
+/* Commit num bytes written to the space returned by ring_buffer_spsc_write_ptr(). */
+static inline void ring_buffer_spsc_write_commit(ring_buffer_spsc_t *rb,
+                                                 uint32_t            num)
+{
+    rb_spsc_store_release(&rb->head, rb->head + num);
+}
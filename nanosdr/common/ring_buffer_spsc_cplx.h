@@ -0,0 +1,175 @@
+/*
+ * Lock-free single-producer single-consumer ring buffer for nanosdr.
+ *
+ * Copyright 2019 Alexandru Csete OZ9AEC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include "datatypes.h"
+#include "ring_buffer_spsc.h"
+
+#define RB_SPSC_ELEMENT_SIZE sizeof(complex_t)
+
+/*
+ * SPSC ring buffer API for data of type complex_t.
+ *
+ * This file adds a complex_t wrapper around the lock-free SPSC ring buffer.
+ * All sizes and counts are in number of complex_t elements. Because the byte
+ * size of the buffer is a power of two and all transfers are whole elements,
+ * the buffer never contains partial elements.
+ */
+
+static inline ring_buffer_spsc_t *ring_buffer_spsc_cplx_create(void)
+{
+    return ring_buffer_spsc_create();
+}
+
+static inline void ring_buffer_spsc_cplx_delete(ring_buffer_spsc_t *rb)
+{
+    ring_buffer_spsc_delete(rb);
+}
+
+static inline void ring_buffer_spsc_cplx_init(ring_buffer_spsc_t *rb,
+                                              uint32_t            size)
+{
+    ring_buffer_spsc_init(rb, size * RB_SPSC_ELEMENT_SIZE);
+}
+
+static inline void ring_buffer_spsc_cplx_resize(ring_buffer_spsc_t *rb,
+                                                uint32_t            newsize)
+{
+    ring_buffer_spsc_resize(rb, newsize * RB_SPSC_ELEMENT_SIZE);
+}
+
+static inline uint32_t ring_buffer_spsc_cplx_size(const ring_buffer_spsc_t *rb)
+{
+    return ring_buffer_spsc_size(rb) / RB_SPSC_ELEMENT_SIZE;
+}
+
+static inline uint32_t ring_buffer_spsc_cplx_count(const ring_buffer_spsc_t *rb)
+{
+    return ring_buffer_spsc_count(rb) / RB_SPSC_ELEMENT_SIZE;
+}
+
+static inline uint32_t ring_buffer_spsc_cplx_space(const ring_buffer_spsc_t *rb)
+{
+    return ring_buffer_spsc_space(rb) / RB_SPSC_ELEMENT_SIZE;
+}
+
+static inline int ring_buffer_spsc_cplx_is_empty(const ring_buffer_spsc_t *rb)
+{
+    return ring_buffer_spsc_is_empty(rb);
+}
+
+static inline int ring_buffer_spsc_cplx_is_full(const ring_buffer_spsc_t *rb)
+{
+    return ring_buffer_spsc_is_full(rb);
+}
+
+/* Returns the number of elements written. */
+static inline uint32_t ring_buffer_spsc_cplx_write(ring_buffer_spsc_t *rb,
+                                                   const complex_t    *src,
+                                                   uint32_t            num)
+{
+    return ring_buffer_spsc_write(rb, (const unsigned char *)src,
+                                  num * RB_SPSC_ELEMENT_SIZE) /
+           RB_SPSC_ELEMENT_SIZE;
+}
+
+/* Returns the number of elements dropped, see ring_buffer_spsc_push(). */
+static inline uint32_t ring_buffer_spsc_cplx_push(ring_buffer_spsc_t *rb,
+                                                  const complex_t    *src,
+                                                  uint32_t            num)
+{
+    return ring_buffer_spsc_push(rb, (const unsigned char *)src,
+                                 num * RB_SPSC_ELEMENT_SIZE) /
+           RB_SPSC_ELEMENT_SIZE;
+}
+
+/* Returns the number of elements discarded, see ring_buffer_spsc_make_room(). */
+static inline uint32_t ring_buffer_spsc_cplx_make_room(ring_buffer_spsc_t *rb,
+                                                       uint32_t            num)
+{
+    return ring_buffer_spsc_make_room(rb, num * RB_SPSC_ELEMENT_SIZE) /
+           RB_SPSC_ELEMENT_SIZE;
+}
+
+/* Returns the number of elements read. */
+static inline uint32_t ring_buffer_spsc_cplx_read(ring_buffer_spsc_t *rb,
+                                                  complex_t          *dest,
+                                                  uint32_t            num)
+{
+    return ring_buffer_spsc_read(rb, (unsigned char *)dest,
+                                 num * RB_SPSC_ELEMENT_SIZE) /
+           RB_SPSC_ELEMENT_SIZE;
+}
+
+static inline void ring_buffer_spsc_cplx_clear(ring_buffer_spsc_t *rb)
+{
+    ring_buffer_spsc_clear(rb);
+}
+
+static inline void ring_buffer_spsc_cplx_skip(ring_buffer_spsc_t *rb,
+                                              uint32_t            num)
+{
+    ring_buffer_spsc_skip(rb, num * RB_SPSC_ELEMENT_SIZE);
+}
+
+/* Zero-copy access; counts are in number of elements. */
+static inline const complex_t *
+ring_buffer_spsc_cplx_read_ptr(ring_buffer_spsc_t *rb, uint32_t *count)
+{
+    const complex_t    *ptr;
+
+    ptr = (const complex_t *)ring_buffer_spsc_read_ptr(rb, count);
+    *count /= RB_SPSC_ELEMENT_SIZE;
+
+    return ptr;
+}
+
+static inline int ring_buffer_spsc_cplx_read_advance(ring_buffer_spsc_t *rb,
+                                                     uint32_t            num)
+{
+    return ring_buffer_spsc_read_advance(rb, num * RB_SPSC_ELEMENT_SIZE);
+}
+
+static inline complex_t *ring_buffer_spsc_cplx_write_ptr(ring_buffer_spsc_t *rb,
+                                                         uint32_t *space)
+{
+    complex_t  *ptr;
+
+    ptr = (complex_t *)ring_buffer_spsc_write_ptr(rb, space);
+    *space /= RB_SPSC_ELEMENT_SIZE;
+
+    return ptr;
+}
+
+static inline void ring_buffer_spsc_cplx_write_commit(ring_buffer_spsc_t *rb,
+                                                      uint32_t            num)
+{
+    ring_buffer_spsc_write_commit(rb, num * RB_SPSC_ELEMENT_SIZE);
+}
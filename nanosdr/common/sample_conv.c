@@ -0,0 +1,304 @@
+/*
+ * Sample format conversion routines for nanosdr.
+ *
+ * Copyright 2019 Alexandru Csete OZ9AEC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdint.h>
+
+#if defined(__SSE2__) && !defined(USE_DOUBLE)
+#include <emmintrin.h>
+#define SAMPLE_CONV_SSE2
+#elif defined(__ARM_NEON) && !defined(USE_DOUBLE)
+#include <arm_neon.h>
+#define SAMPLE_CONV_NEON
+#endif
+
+#include "datatypes.h"
+#include "sample_conv.h"
+
+#define U8_ZERO     127.4f
+#define U8_SCALE    (1.0f / 127.5f)
+
+/* lookup table for u8 -> float conversion computed at compile time */
+#define U8(i)       (((real_t)(i) - U8_ZERO) * U8_SCALE)
+#define U8_4(i)     U8(i), U8(i + 1), U8(i + 2), U8(i + 3)
+#define U8_16(i)    U8_4(i), U8_4(i + 4), U8_4(i + 8), U8_4(i + 12)
+#define U8_64(i)    U8_16(i), U8_16(i + 16), U8_16(i + 32), U8_16(i + 48)
+
+static const real_t u8_lut[256] = {
+    U8_64(0), U8_64(64), U8_64(128), U8_64(192)
+};
+
+void sample_conv_u8_to_cplx_lut(const uint8_t *in, complex_t *out,
+                                uint32_t num)
+{
+    uint32_t    i;
+
+    for (i = 0; i < num; i++)
+    {
+        out[i].re = u8_lut[in[2 * i]];
+        out[i].im = u8_lut[in[2 * i + 1]];
+    }
+}
+
+void sample_conv_u8_to_cplx(const uint8_t *in, complex_t *out, uint32_t num)
+{
+    uint32_t    i = 0;
+
+#if defined(SAMPLE_CONV_SSE2)
+    const __m128i   zero = _mm_setzero_si128();
+    const __m128    offset = _mm_set1_ps(U8_ZERO);
+    const __m128    scale = _mm_set1_ps(U8_SCALE);
+    float          *fout = (float *)out;
+
+    /* 16 bytes = 8 complex samples per iteration */
+    for (; i + 8 <= num; i += 8)
+    {
+        __m128i v8 = _mm_loadu_si128((const __m128i *)&in[2 * i]);
+        __m128i lo16 = _mm_unpacklo_epi8(v8, zero);
+        __m128i hi16 = _mm_unpackhi_epi8(v8, zero);
+        __m128  f0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo16, zero));
+        __m128  f1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo16, zero));
+        __m128  f2 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi16, zero));
+        __m128  f3 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi16, zero));
+
+        _mm_storeu_ps(&fout[2 * i], _mm_mul_ps(_mm_sub_ps(f0, offset), scale));
+        _mm_storeu_ps(&fout[2 * i + 4], _mm_mul_ps(_mm_sub_ps(f1, offset), scale));
+        _mm_storeu_ps(&fout[2 * i + 8], _mm_mul_ps(_mm_sub_ps(f2, offset), scale));
+        _mm_storeu_ps(&fout[2 * i + 12], _mm_mul_ps(_mm_sub_ps(f3, offset), scale));
+    }
+#elif defined(SAMPLE_CONV_NEON)
+    const float32x4_t   offset = vdupq_n_f32(U8_ZERO);
+    const float32x4_t   scale = vdupq_n_f32(U8_SCALE);
+    float              *fout = (float *)out;
+
+    for (; i + 8 <= num; i += 8)
+    {
+        uint8x16_t  v8 = vld1q_u8(&in[2 * i]);
+        uint16x8_t  lo16 = vmovl_u8(vget_low_u8(v8));
+        uint16x8_t  hi16 = vmovl_u8(vget_high_u8(v8));
+        float32x4_t f0 = vcvtq_f32_u32(vmovl_u16(vget_low_u16(lo16)));
+        float32x4_t f1 = vcvtq_f32_u32(vmovl_u16(vget_high_u16(lo16)));
+        float32x4_t f2 = vcvtq_f32_u32(vmovl_u16(vget_low_u16(hi16)));
+        float32x4_t f3 = vcvtq_f32_u32(vmovl_u16(vget_high_u16(hi16)));
+
+        vst1q_f32(&fout[2 * i], vmulq_f32(vsubq_f32(f0, offset), scale));
+        vst1q_f32(&fout[2 * i + 4], vmulq_f32(vsubq_f32(f1, offset), scale));
+        vst1q_f32(&fout[2 * i + 8], vmulq_f32(vsubq_f32(f2, offset), scale));
+        vst1q_f32(&fout[2 * i + 12], vmulq_f32(vsubq_f32(f3, offset), scale));
+    }
+#endif
+
+    /* remaining samples */
+    sample_conv_u8_to_cplx_lut(&in[2 * i], &out[i], num - i);
+}
+
+/*
+ * Signed 16 bit conversions with runtime kernel selection.
+ *
+ * SSE2 is the baseline on x86_64 so the only runtime choice on x86 is
+ * whether AVX2 is available. NEON is selected at compile time.
+ */
+#if !defined(USE_DOUBLE) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SAMPLE_CONV_AVX2
+#endif
+
+typedef void (*s16_conv_fn)(const int16_t *in, complex_t *out, uint32_t num,
+                            real_t scale);
+
+static void s16_to_cplx_generic(const int16_t *in, complex_t *out,
+                                uint32_t num, real_t scale)
+{
+    uint32_t    i;
+
+    for (i = 0; i < num; i++)
+    {
+        out[i].re = (real_t)in[2 * i] * scale;
+        out[i].im = (real_t)in[2 * i + 1] * scale;
+    }
+}
+
+#if defined(SAMPLE_CONV_SSE2)
+/* sign extend the low / high four int16 of v to float */
+#define S16_LO_PS(v)    _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16))
+#define S16_HI_PS(v)    _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16))
+
+static void s16_to_cplx_sse2(const int16_t *in, complex_t *out,
+                             uint32_t num, real_t scale)
+{
+    const __m128    vscale = _mm_set1_ps(scale);
+    float          *fout = (float *)out;
+    uint32_t        i;
+
+    /* 8 int16 = 4 complex samples per iteration */
+    for (i = 0; i + 4 <= num; i += 4)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)&in[2 * i]);
+
+        _mm_storeu_ps(&fout[2 * i], _mm_mul_ps(S16_LO_PS(v), vscale));
+        _mm_storeu_ps(&fout[2 * i + 4], _mm_mul_ps(S16_HI_PS(v), vscale));
+    }
+
+    s16_to_cplx_generic(&in[2 * i], &out[i], num - i, scale);
+}
+#endif /* SAMPLE_CONV_SSE2 */
+
+#if defined(SAMPLE_CONV_AVX2)
+__attribute__((target("avx2")))
+static void s16_to_cplx_avx2(const int16_t *in, complex_t *out,
+                             uint32_t num, real_t scale)
+{
+    const __m256    vscale = _mm256_set1_ps(scale);
+    float          *fout = (float *)out;
+    uint32_t        i;
+
+    /* 16 int16 = 8 complex samples per iteration */
+    for (i = 0; i + 8 <= num; i += 8)
+    {
+        __m128i v0 = _mm_loadu_si128((const __m128i *)&in[2 * i]);
+        __m128i v1 = _mm_loadu_si128((const __m128i *)&in[2 * i + 8]);
+        __m256  f0 = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(v0));
+        __m256  f1 = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(v1));
+
+        _mm256_storeu_ps(&fout[2 * i], _mm256_mul_ps(f0, vscale));
+        _mm256_storeu_ps(&fout[2 * i + 8], _mm256_mul_ps(f1, vscale));
+    }
+
+    s16_to_cplx_generic(&in[2 * i], &out[i], num - i, scale);
+}
+#endif /* SAMPLE_CONV_AVX2 */
+
+#if defined(SAMPLE_CONV_NEON)
+static void s16_to_cplx_neon(const int16_t *in, complex_t *out,
+                             uint32_t num, real_t scale)
+{
+    float      *fout = (float *)out;
+    uint32_t    i;
+
+    for (i = 0; i + 4 <= num; i += 4)
+    {
+        int16x8_t   v = vld1q_s16(&in[2 * i]);
+
+        vst1q_f32(&fout[2 * i],
+                  vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), scale));
+        vst1q_f32(&fout[2 * i + 4],
+                  vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), scale));
+    }
+
+    s16_to_cplx_generic(&in[2 * i], &out[i], num - i, scale);
+}
+#endif /* SAMPLE_CONV_NEON */
+
+static void s16_to_cplx_init(const int16_t *in, complex_t *out,
+                             uint32_t num, real_t scale);
+
+/*
+ * The kernel starts out pointing to the init function, which selects the
+ * actual kernel on the first call. The selection is idempotent so a race
+ * between two threads calling for the first time is harmless.
+ */
+static s16_conv_fn  s16_to_cplx = s16_to_cplx_init;
+static const char  *s16_impl = "generic";
+
+static void s16_select(void)
+{
+    s16_conv_fn     fn = s16_to_cplx_generic;
+    const char     *impl = "generic";
+
+#if defined(SAMPLE_CONV_SSE2)
+    fn = s16_to_cplx_sse2;
+    impl = "sse2";
+#elif defined(SAMPLE_CONV_NEON)
+    fn = s16_to_cplx_neon;
+    impl = "neon";
+#endif
+
+#if defined(SAMPLE_CONV_AVX2)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        fn = s16_to_cplx_avx2;
+        impl = "avx2";
+    }
+#endif
+
+    s16_impl = impl;
+    __atomic_store_n(&s16_to_cplx, fn, __ATOMIC_RELEASE);
+}
+
+static void s16_to_cplx_init(const int16_t *in, complex_t *out,
+                             uint32_t num, real_t scale)
+{
+    s16_select();
+    s16_to_cplx(in, out, num, scale);
+}
+
+void sample_conv_s16_to_cplx(const int16_t *in, complex_t *out, uint32_t num,
+                             real_t scale)
+{
+    __atomic_load_n(&s16_to_cplx, __ATOMIC_ACQUIRE)(in, out, num, scale);
+}
+
+void sample_conv_s16_interleave(const int16_t *in_i, const int16_t *in_q,
+                                int16_t *out, uint32_t num)
+{
+    uint32_t    i = 0;
+
+#if defined(SAMPLE_CONV_SSE2)
+    for (; i + 8 <= num; i += 8)
+    {
+        __m128i vi = _mm_loadu_si128((const __m128i *)&in_i[i]);
+        __m128i vq = _mm_loadu_si128((const __m128i *)&in_q[i]);
+
+        _mm_storeu_si128((__m128i *)&out[2 * i], _mm_unpacklo_epi16(vi, vq));
+        _mm_storeu_si128((__m128i *)&out[2 * i + 8], _mm_unpackhi_epi16(vi, vq));
+    }
+#elif defined(SAMPLE_CONV_NEON)
+    for (; i + 8 <= num; i += 8)
+    {
+        int16x8x2_t iq;
+
+        iq.val[0] = vld1q_s16(&in_i[i]);
+        iq.val[1] = vld1q_s16(&in_q[i]);
+        vst2q_s16(&out[2 * i], iq);
+    }
+#endif
+
+    for (; i < num; i++)
+    {
+        out[2 * i] = in_i[i];
+        out[2 * i + 1] = in_q[i];
+    }
+}
+
+const char *sample_conv_s16_impl(void)
+{
+    if (__atomic_load_n(&s16_to_cplx, __ATOMIC_ACQUIRE) == s16_to_cplx_init)
+        s16_select();
+
+    return s16_impl;
+}
@@ -0,0 +1,75 @@
+/*
+ * Sample format conversion routines for nanosdr.
+ *
+ * Copyright 2019 Alexandru Csete OZ9AEC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include "datatypes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Convert interleaved unsigned 8 bit I/Q samples to complex_t.
+ *
+ * This is the RTL-SDR format where 127.4 is the zero level. num is the
+ * number of complex samples, i.e. in must contain 2 * num bytes.
+ *
+ * Uses SSE2 or NEON when available at compile time and a lookup table
+ * otherwise.
+ */
+void sample_conv_u8_to_cplx(const uint8_t *in, complex_t *out, uint32_t num);
+
+/* Same as sample_conv_u8_to_cplx() but always using the lookup table. */
+void sample_conv_u8_to_cplx_lut(const uint8_t *in, complex_t *out,
+                                uint32_t num);
+
+/*
+ * Convert interleaved signed 16 bit I/Q samples to complex_t.
+ *
+ * Each sample is multiplied by scale, e.g. 1/2048 for 12 bit data.
+ * num is the number of complex samples. The fastest kernel supported by
+ * the CPU is selected at runtime on the first call.
+ */
+void sample_conv_s16_to_cplx(const int16_t *in, complex_t *out, uint32_t num,
+                             real_t scale);
+
+/*
+ * Interleave separate I and Q arrays of signed 16 bit samples without
+ * converting them. out must have room for 2 * num samples.
+ */
+void sample_conv_s16_interleave(const int16_t *in_i, const int16_t *in_q,
+                                int16_t *out, uint32_t num);
+
+/* Name of the kernel set selected for the 16 bit conversions. */
+const char *sample_conv_s16_impl(void);
+
+#ifdef __cplusplus
+}
+#endif
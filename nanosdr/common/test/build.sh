@@ -1,2 +1,4 @@
 gcc -Wall -Wextra -O3 -o test_buffer test_buffer.c
 gcc -Wall -Wextra -O3 -o test_buffer_cplx test_buffer_cplx.c
+gcc -Wall -Wextra -O3 -pthread -o test_buffer_spsc test_buffer_spsc.c
+gcc -Wall -Wextra -O3 -o test_sample_conv test_sample_conv.c ../sample_conv.c -lm
@@ -0,0 +1,483 @@
+/*
+ * Lock-free SPSC ring buffer test
+ *
+ * Runs single threaded API tests followed by a two-thread stress test that
+ * checks data integrity and a throughput test that compares the SPSC buffer
+ * with the mutex protected ring_buffer_t. The last tests check zero-copy
+ * access using mirrored memory and the overrun policies.
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../ring_buffer.h"
+#include "../ring_buffer_spsc.h"
+#include "../ring_buffer_spsc_cplx.h"
+
+static int failed = 0;
+static int passed = 0;
+
+
+static void test_int(const char *string, int var, int value)
+{
+    fprintf(stderr, "%s %d (exp: %d) ... ", string, var, value);
+
+    if (var == value)
+    {
+        passed++;
+        fprintf(stderr, "PASSED\n");
+    }
+    else
+    {
+        failed++;
+        fprintf(stderr, "FAILED\n");
+    }
+}
+
+static double time_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + 1.e-9 * (double)ts.tv_nsec;
+}
+
+
+/* stress test: producer writes a counter sequence, consumer verifies it */
+#define STRESS_WORDS    (16 * 1024 * 1024)
+#define STRESS_RB_SIZE  4096
+
+static ring_buffer_spsc_t *stress_rb;
+static uint32_t            stress_errors;
+
+static void *stress_producer(void *arg)
+{
+    uint32_t    buf[512];
+    uint32_t    next = 0;
+    uint32_t    num, written, i;
+    unsigned int seed = 1;
+
+    (void)arg;
+
+    while (next < STRESS_WORDS)
+    {
+        num = 1 + rand_r(&seed) % 512;
+        if (num > STRESS_WORDS - next)
+            num = STRESS_WORDS - next;
+
+        for (i = 0; i < num; i++)
+            buf[i] = next + i;
+
+        /* retry until everything has been written; no data may be lost */
+        i = 0;
+        while (i < num)
+        {
+            written = ring_buffer_spsc_write(stress_rb,
+                                             (unsigned char *)&buf[i],
+                                             (num - i) * sizeof(uint32_t));
+            i += written / sizeof(uint32_t);
+            if (written == 0)
+                sched_yield();
+        }
+        next += num;
+    }
+
+    return NULL;
+}
+
+static void *stress_consumer(void *arg)
+{
+    uint32_t    buf[512];
+    uint32_t    expected = 0;
+    uint32_t    num, nread, i;
+    unsigned int seed = 2;
+
+    (void)arg;
+
+    while (expected < STRESS_WORDS)
+    {
+        num = 1 + rand_r(&seed) % 512;
+        nread = ring_buffer_spsc_read(stress_rb, (unsigned char *)buf,
+                                      num * sizeof(uint32_t));
+        nread /= sizeof(uint32_t);
+        if (nread == 0)
+            sched_yield();
+
+        for (i = 0; i < nread; i++)
+        {
+            if (buf[i] != expected)
+                stress_errors++;
+            expected = buf[i] + 1;
+        }
+    }
+
+    return NULL;
+}
+
+
+/* drop-oldest stress test: data may be lost but never corrupted */
+static ring_buffer_spsc_t *oldest_rb;
+static uint32_t            oldest_errors;
+static uint64_t            oldest_dropped;
+static uint64_t            oldest_received;
+static int                 oldest_done;
+
+static void *oldest_producer(void *arg)
+{
+    uint32_t    buf[512];
+    uint32_t    next = 0;
+    uint32_t    num, i;
+    unsigned int seed = 3;
+
+    (void)arg;
+
+    while (next < STRESS_WORDS)
+    {
+        num = 1 + rand_r(&seed) % 512;
+        if (num > STRESS_WORDS - next)
+            num = STRESS_WORDS - next;
+
+        for (i = 0; i < num; i++)
+            buf[i] = next + i;
+
+        oldest_dropped += ring_buffer_spsc_push(oldest_rb,
+                                                (unsigned char *)buf,
+                                                num * sizeof(uint32_t));
+        next += num;
+
+        /* give the consumer a chance on single core machines */
+        if ((next & 0xff) == 0)
+            sched_yield();
+    }
+
+    __atomic_store_n(&oldest_done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void *oldest_consumer(void *arg)
+{
+    uint32_t    buf[512];
+    uint32_t    last = 0;
+    uint32_t    nread, i;
+    int         first = 1;
+
+    (void)arg;
+
+    for (;;)
+    {
+        nread = ring_buffer_spsc_read(oldest_rb, (unsigned char *)buf,
+                                      sizeof(buf));
+        nread /= sizeof(uint32_t);
+        if (nread == 0)
+        {
+            if (__atomic_load_n(&oldest_done, __ATOMIC_ACQUIRE) &&
+                ring_buffer_spsc_is_empty(oldest_rb))
+                break;
+            sched_yield();
+            continue;
+        }
+
+        /* samples must be increasing; gaps are allowed */
+        for (i = 0; i < nread; i++)
+        {
+            if (!first && buf[i] <= last)
+                oldest_errors++;
+            last = buf[i];
+            first = 0;
+        }
+        oldest_received += nread;
+    }
+
+    return NULL;
+}
+
+
+/* throughput test */
+#define TP_BLOCK        8192                /* samples per block */
+#define TP_BLOCKS       20000
+#define TP_RB_SIZE      (16 * TP_BLOCK)
+
+static ring_buffer_spsc_t *tp_spsc;
+static ring_buffer_t      *tp_locked;
+static pthread_mutex_t     tp_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t            tp_dropped;
+static int                 tp_done;
+
+static void *tp_spsc_producer(void *arg)
+{
+    complex_t   *buf = (complex_t *)calloc(TP_BLOCK, sizeof(complex_t));
+    int          i;
+
+    (void)arg;
+
+    for (i = 0; i < TP_BLOCKS; i++)
+        tp_dropped += TP_BLOCK - ring_buffer_spsc_cplx_write(tp_spsc, buf,
+                                                             TP_BLOCK);
+
+    __atomic_store_n(&tp_done, 1, __ATOMIC_RELEASE);
+    free(buf);
+    return NULL;
+}
+
+static void *tp_locked_producer(void *arg)
+{
+    complex_t   *buf = (complex_t *)calloc(TP_BLOCK, sizeof(complex_t));
+    int          i;
+
+    (void)arg;
+
+    for (i = 0; i < TP_BLOCKS; i++)
+    {
+        pthread_mutex_lock(&tp_lock);
+        ring_buffer_write(tp_locked, (unsigned char *)buf,
+                          TP_BLOCK * sizeof(complex_t));
+        pthread_mutex_unlock(&tp_lock);
+    }
+
+    __atomic_store_n(&tp_done, 1, __ATOMIC_RELEASE);
+    free(buf);
+    return NULL;
+}
+
+static double run_throughput(int locked)
+{
+    pthread_t   producer;
+    complex_t  *buf = (complex_t *)calloc(TP_BLOCK, sizeof(complex_t));
+    uint64_t    total = 0;
+    double      t0, t1;
+    int         done = 0;
+
+    tp_done = 0;
+    t0 = time_now();
+    pthread_create(&producer, NULL,
+                   locked ? tp_locked_producer : tp_spsc_producer, NULL);
+
+    /* consume until the producer has finished and the buffer is empty */
+    while (!done)
+    {
+        uint32_t    nread;
+
+        if (locked)
+        {
+            pthread_mutex_lock(&tp_lock);
+            nread = ring_buffer_count(tp_locked);
+            if (nread > TP_BLOCK * sizeof(complex_t))
+                nread = TP_BLOCK * sizeof(complex_t);
+            ring_buffer_read(tp_locked, (unsigned char *)buf, nread);
+            pthread_mutex_unlock(&tp_lock);
+            nread /= sizeof(complex_t);
+        }
+        else
+        {
+            nread = ring_buffer_spsc_cplx_read(tp_spsc, buf, TP_BLOCK);
+        }
+
+        total += nread;
+        if (nread == 0)
+        {
+            if (__atomic_load_n(&tp_done, __ATOMIC_ACQUIRE))
+                done = 1;
+            sched_yield();
+        }
+    }
+
+    pthread_join(producer, NULL);
+    t1 = time_now();
+    free(buf);
+
+    return 1.e-6 * (double)total / (t1 - t0);
+}
+
+
+int main(void)
+{
+    int             retval = 0;
+    int             i;
+    unsigned char   wrbuf[16];
+    unsigned char   rdbuf[16];
+    pthread_t       producer, consumer;
+    double          t0, t1;
+    uint32_t        num_read;
+
+    ring_buffer_spsc_t *rb = ring_buffer_spsc_create();
+
+    /* test 1 */
+    fprintf(stderr, "\nTEST 1 - Size is rounded up to power of two\n");
+    ring_buffer_spsc_init(rb, 10);
+    test_int("    Check size:", ring_buffer_spsc_size(rb), 16);
+    test_int("    Check count:", ring_buffer_spsc_count(rb), 0);
+    test_int("    Check space:", ring_buffer_spsc_space(rb), 16);
+
+    /* test 2 */
+    fprintf(stderr, "\nTEST 2 - Write and read across the edge\n");
+    for (i = 0; i < 16; i++)
+        wrbuf[i] = (unsigned char)i;
+
+    test_int("    Write 11 bytes:", ring_buffer_spsc_write(rb, wrbuf, 11), 11);
+    test_int("    Read 11 bytes:", ring_buffer_spsc_read(rb, rdbuf, 11), 11);
+    test_int("    Write 10 bytes:", ring_buffer_spsc_write(rb, wrbuf, 10), 10);
+    test_int("    Check count:", ring_buffer_spsc_count(rb), 10);
+    test_int("    Read 10 bytes:", ring_buffer_spsc_read(rb, rdbuf, 10), 10);
+    test_int("    Compare R/W buf:", memcmp(wrbuf, rdbuf, 10), 0);
+
+    /* test 3 */
+    fprintf(stderr, "\nTEST 3 - Newest data is dropped when full\n");
+    ring_buffer_spsc_clear(rb);
+    test_int("    Write 12 bytes:", ring_buffer_spsc_write(rb, wrbuf, 12), 12);
+    test_int("    Write 8 bytes:", ring_buffer_spsc_write(rb, &wrbuf[12], 8), 4);
+    test_int("    Check full:", ring_buffer_spsc_is_full(rb), 1);
+    test_int("    Read 20 bytes:", ring_buffer_spsc_read(rb, rdbuf, 20), 16);
+    test_int("    Compare R/W buf:", memcmp(wrbuf, rdbuf, 16), 0);
+    test_int("    Check empty:", ring_buffer_spsc_is_empty(rb), 1);
+
+    /* test 4 */
+    fprintf(stderr, "\nTEST 4 - Two-thread stress test (%d words)\n",
+            STRESS_WORDS);
+    stress_rb = ring_buffer_spsc_create();
+    ring_buffer_spsc_init(stress_rb, STRESS_RB_SIZE);
+    stress_errors = 0;
+    t0 = time_now();
+    pthread_create(&producer, NULL, stress_producer, NULL);
+    pthread_create(&consumer, NULL, stress_consumer, NULL);
+    pthread_join(producer, NULL);
+    pthread_join(consumer, NULL);
+    t1 = time_now();
+    fprintf(stderr, "  Completed in %.3f s\n", t1 - t0);
+    test_int("    Sequence errors:", stress_errors, 0);
+    test_int("    Check empty:", ring_buffer_spsc_is_empty(stress_rb), 1);
+    ring_buffer_spsc_delete(stress_rb);
+
+    /* test 5 */
+    fprintf(stderr, "\nTEST 5 - Throughput (%d blocks of %d samples)\n",
+            TP_BLOCKS, TP_BLOCK);
+    tp_spsc = ring_buffer_spsc_cplx_create();
+    ring_buffer_spsc_cplx_init(tp_spsc, TP_RB_SIZE);
+    tp_locked = ring_buffer_create();
+    ring_buffer_init(tp_locked, TP_RB_SIZE * sizeof(complex_t));
+
+    fprintf(stderr, "  Mutex + ring_buffer_t: %8.2f Msps\n",
+            run_throughput(1));
+    fprintf(stderr, "  Lock-free SPSC:        %8.2f Msps (%llu dropped)\n",
+            run_throughput(0), (unsigned long long)tp_dropped);
+
+    ring_buffer_spsc_cplx_delete(tp_spsc);
+    ring_buffer_delete(tp_locked);
+
+    /* test 6 */
+    fprintf(stderr, "\nTEST 6 - Contiguous spans across the edge\n");
+    {
+        ring_buffer_spsc_t     *mrb = ring_buffer_spsc_cplx_create();
+        const complex_t        *rptr;
+        complex_t              *wptr;
+        uint32_t                num, size;
+        int                     errors = 0;
+
+        size = mirror_buffer_page_size() / sizeof(complex_t);
+        ring_buffer_spsc_cplx_init(mrb, size);
+        test_int("    Check mirrored:", ring_buffer_spsc_is_mirrored(mrb), 1);
+
+        /* move indices close to the end of the buffer */
+        wptr = ring_buffer_spsc_cplx_write_ptr(mrb, &num);
+        test_int("    Check write space:", num, size);
+        ring_buffer_spsc_cplx_write_commit(mrb, size - 10);
+        ring_buffer_spsc_cplx_read_ptr(mrb, &num);
+        ring_buffer_spsc_cplx_read_advance(mrb, num);
+
+        /* write 100 samples in one span that wraps around the edge */
+        wptr = ring_buffer_spsc_cplx_write_ptr(mrb, &num);
+        test_int("    Check write space:", num, size);
+        for (i = 0; i < 100; i++)
+        {
+            wptr[i].re = (real_t)i;
+            wptr[i].im = (real_t)-i;
+        }
+        ring_buffer_spsc_cplx_write_commit(mrb, 100);
+
+        rptr = ring_buffer_spsc_cplx_read_ptr(mrb, &num);
+        test_int("    Check read count:", num, 100);
+        for (i = 0; i < 100; i++)
+            if (rptr[i].re != (real_t)i || rptr[i].im != (real_t)-i)
+                errors++;
+        test_int("    Compare R/W span:", errors, 0);
+        ring_buffer_spsc_cplx_read_advance(mrb, num);
+        test_int("    Check empty:", ring_buffer_spsc_is_empty(mrb), 1);
+
+        ring_buffer_spsc_cplx_delete(mrb);
+    }
+
+    /* test 7 */
+    fprintf(stderr, "\nTEST 7 - Overrun policies\n");
+    for (i = 0; i < 16; i++)
+        wrbuf[i] = (unsigned char)i;
+
+    ring_buffer_spsc_init(rb, 8);
+    ring_buffer_spsc_set_policy(rb, RB_SPSC_DROP_NEWEST, 0);
+    test_int("    Drop newest, push 6:", ring_buffer_spsc_push(rb, wrbuf, 6), 0);
+    test_int("    Drop newest, push 6:", ring_buffer_spsc_push(rb, wrbuf, 6), 4);
+    test_int("    Check count:", ring_buffer_spsc_count(rb), 8);
+
+    ring_buffer_spsc_clear(rb);
+    ring_buffer_spsc_set_policy(rb, RB_SPSC_DROP_OLDEST, 0);
+    test_int("    Drop oldest, push 6:", ring_buffer_spsc_push(rb, wrbuf, 6), 0);
+    test_int("    Drop oldest, push 6:", ring_buffer_spsc_push(rb, &wrbuf[6], 6), 4);
+    test_int("    Read 8 bytes:", ring_buffer_spsc_read(rb, rdbuf, 8), 8);
+    test_int("    Compare R/W buf:", memcmp(&wrbuf[4], rdbuf, 8), 0);
+    test_int("    Drop oldest, push 12:", ring_buffer_spsc_push(rb, wrbuf, 12), 4);
+    test_int("    Read 8 bytes:", ring_buffer_spsc_read(rb, rdbuf, 8), 8);
+    test_int("    Compare R/W buf:", memcmp(&wrbuf[4], rdbuf, 8), 0);
+
+    /* span is invalidated if the producer discards it */
+    ring_buffer_spsc_push(rb, wrbuf, 8);
+    ring_buffer_spsc_read_ptr(rb, &num_read);
+    ring_buffer_spsc_push(rb, wrbuf, 2);
+    test_int("    Release discarded span:",
+             ring_buffer_spsc_read_advance(rb, num_read), 0);
+    test_int("    Check count:", ring_buffer_spsc_count(rb), 8);
+
+    /* the producer can discard everything, e.g. on a stream reset */
+    ring_buffer_spsc_read_ptr(rb, &num_read);
+    test_int("    Discard all:", ring_buffer_spsc_discard(rb), 8);
+    test_int("    Release discarded span:",
+             ring_buffer_spsc_read_advance(rb, num_read), 0);
+    test_int("    Check empty:", ring_buffer_spsc_is_empty(rb), 1);
+    ring_buffer_spsc_push(rb, wrbuf, 8);
+
+    ring_buffer_spsc_set_policy(rb, RB_SPSC_BLOCK, 20);
+    t0 = time_now();
+    test_int("    Block, push 4:", ring_buffer_spsc_push(rb, wrbuf, 4), 4);
+    t1 = time_now();
+    test_int("    Blocked for timeout:", t1 - t0 >= 0.019, 1);
+
+    /* test 8 */
+    fprintf(stderr, "\nTEST 8 - Drop oldest two-thread stress test\n");
+    oldest_rb = ring_buffer_spsc_create();
+    ring_buffer_spsc_init(oldest_rb, STRESS_RB_SIZE);
+    ring_buffer_spsc_set_policy(oldest_rb, RB_SPSC_DROP_OLDEST, 0);
+    pthread_create(&producer, NULL, oldest_producer, NULL);
+    pthread_create(&consumer, NULL, oldest_consumer, NULL);
+    pthread_join(producer, NULL);
+    pthread_join(consumer, NULL);
+    fprintf(stderr, "  Received %llu words, dropped %llu words\n",
+            (unsigned long long)oldest_received,
+            (unsigned long long)oldest_dropped / sizeof(uint32_t));
+    test_int("    Sequence errors:", oldest_errors, 0);
+    test_int("    Received + dropped:",
+             oldest_received + oldest_dropped / sizeof(uint32_t) ==
+             STRESS_WORDS, 1);
+    ring_buffer_spsc_delete(oldest_rb);
+
+    fprintf(stderr, "\nTest summary:\n");
+    fprintf(stderr, "    Passed: %d\n", passed);
+    fprintf(stderr, "    Failed: %d\n\n", failed);
+
+    ring_buffer_spsc_delete(rb);
+
+    if (failed)
+        retval = 1;
+
+    return retval;
+}
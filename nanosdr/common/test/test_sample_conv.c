@@ -0,0 +1,149 @@
+/*
+ * Sample conversion test
+ *
+ * Checks the SIMD conversion routines against the scalar reference and
+ * prints the conversion rate.
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../sample_conv.h"
+
+#define NUM_SAMPLES     (1024 * 1024 + 3)   /* odd size to test the tail */
+#define BENCH_LOOPS     100
+
+static int failed = 0;
+static int passed = 0;
+
+
+static void test_int(const char *string, int var, int value)
+{
+    fprintf(stderr, "%s %d (exp: %d) ... ", string, var, value);
+
+    if (var == value)
+    {
+        passed++;
+        fprintf(stderr, "PASSED\n");
+    }
+    else
+    {
+        failed++;
+        fprintf(stderr, "FAILED\n");
+    }
+}
+
+static double time_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + 1.e-9 * (double)ts.tv_nsec;
+}
+
+/* number of samples that differ from the reference by more than 1e-6 */
+static int compare(const complex_t *a, const complex_t *b, uint32_t num)
+{
+    uint32_t    i;
+    int         errors = 0;
+
+    for (i = 0; i < num; i++)
+        if (fabsf(a[i].re - b[i].re) > 1.e-6f ||
+            fabsf(a[i].im - b[i].im) > 1.e-6f)
+            errors++;
+
+    return errors;
+}
+
+int main(void)
+{
+    uint8_t    *in_u8;
+    int16_t    *in_s16;
+    complex_t  *ref, *out;
+    uint32_t    i;
+    double      t0, t1;
+
+    in_u8 = (uint8_t *)malloc(2 * NUM_SAMPLES);
+    in_s16 = (int16_t *)malloc(2 * NUM_SAMPLES * sizeof(int16_t));
+    ref = (complex_t *)malloc(NUM_SAMPLES * sizeof(complex_t));
+    out = (complex_t *)malloc(NUM_SAMPLES * sizeof(complex_t));
+
+    srand(1);
+    for (i = 0; i < 2 * NUM_SAMPLES; i++)
+    {
+        in_u8[i] = (uint8_t)(rand() & 0xff);
+        in_s16[i] = (int16_t)(rand() & 0xffff);
+    }
+
+    /* test 1 */
+    fprintf(stderr, "\nTEST 1 - u8 to complex\n");
+    for (i = 0; i < NUM_SAMPLES; i++)
+    {
+        ref[i].re = ((float)in_u8[2 * i] - 127.4f) / 127.5f;
+        ref[i].im = ((float)in_u8[2 * i + 1] - 127.4f) / 127.5f;
+    }
+    sample_conv_u8_to_cplx_lut(in_u8, out, NUM_SAMPLES);
+    test_int("    LUT errors:", compare(ref, out, NUM_SAMPLES), 0);
+    sample_conv_u8_to_cplx(in_u8, out, NUM_SAMPLES);
+    test_int("    SIMD errors:", compare(ref, out, NUM_SAMPLES), 0);
+
+    t0 = time_now();
+    for (i = 0; i < BENCH_LOOPS; i++)
+        sample_conv_u8_to_cplx_lut(in_u8, out, NUM_SAMPLES);
+    t1 = time_now();
+    fprintf(stderr, "  LUT:  %8.1f Msps\n",
+            1.e-6 * BENCH_LOOPS * NUM_SAMPLES / (t1 - t0));
+
+    t0 = time_now();
+    for (i = 0; i < BENCH_LOOPS; i++)
+        sample_conv_u8_to_cplx(in_u8, out, NUM_SAMPLES);
+    t1 = time_now();
+    fprintf(stderr, "  SIMD: %8.1f Msps\n",
+            1.e-6 * BENCH_LOOPS * NUM_SAMPLES / (t1 - t0));
+
+    /* test 2 */
+    fprintf(stderr, "\nTEST 2 - s16 to complex (%s)\n",
+            sample_conv_s16_impl());
+    for (i = 0; i < NUM_SAMPLES; i++)
+    {
+        ref[i].re = (float)in_s16[2 * i] / 32768.f;
+        ref[i].im = (float)in_s16[2 * i + 1] / 32768.f;
+    }
+    sample_conv_s16_to_cplx(in_s16, out, NUM_SAMPLES, 1.f / 32768.f);
+    test_int("    Interleaved errors:", compare(ref, out, NUM_SAMPLES), 0);
+
+    t0 = time_now();
+    for (i = 0; i < BENCH_LOOPS; i++)
+        sample_conv_s16_to_cplx(in_s16, out, NUM_SAMPLES, 1.f / 32768.f);
+    t1 = time_now();
+    fprintf(stderr, "  Interleaved: %8.1f Msps\n",
+            1.e-6 * BENCH_LOOPS * NUM_SAMPLES / (t1 - t0));
+
+    /* test 3 */
+    fprintf(stderr, "\nTEST 3 - s16 interleave\n");
+    {
+        int16_t    *out_s16 = (int16_t *)out;
+        int         errors = 0;
+
+        sample_conv_s16_interleave(in_s16, &in_s16[NUM_SAMPLES], out_s16,
+                                   NUM_SAMPLES);
+        for (i = 0; i < NUM_SAMPLES; i++)
+            if (out_s16[2 * i] != in_s16[i] ||
+                out_s16[2 * i + 1] != in_s16[NUM_SAMPLES + i])
+                errors++;
+        test_int("    Errors:", errors, 0);
+    }
+
+    fprintf(stderr, "\nTest summary:\n");
+    fprintf(stderr, "    Passed: %d\n", passed);
+    fprintf(stderr, "    Failed: %d\n\n", failed);
+
+    free(in_u8);
+    free(in_s16);
+    free(ref);
+    free(out);
+
+    return failed ? 1 : 0;
+}
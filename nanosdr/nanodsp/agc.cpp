@@ -126,6 +126,28 @@ void CAgc::setup(bool AgcOn,  bool UseHang, int Threshold, int ManualGain,
     m_GainSlope = m_SlopeFactor / 100.0;
     m_FixedGain = AGC_OUTSCALE * MPOW(10.0, m_Knee * (m_GainSlope - 1.0));
 
+    update_rate();
+}
+
+void CAgc::set_sample_rate(real_t SampleRate)
+{
+    if (SampleRate == m_SampleRate)
+        return;
+
+    m_HangTimer = (int)(m_HangTimer * SampleRate / m_SampleRate);
+    m_SampleRate = SampleRate;
+    update_rate();
+
+    // the buffers keep their contents, only the lengths change
+    if (m_SigDelayPtr >= m_DelaySamples)
+        m_SigDelayPtr = 0;
+    if (m_MagBufPos >= m_WindowSamples)
+        m_MagBufPos = 0;
+}
+
+// Filter constants and buffer lengths that depend on the sample rate
+void CAgc::update_rate(void)
+{
     // fast and slow filter values.
     m_AttackRiseAlpha = 1.0 - MEXP(-1.0 / (m_SampleRate * ATTACK_RISE_TIMECONST));
     m_AttackFallAlpha = 1.0 - MEXP(-1.0 / (m_SampleRate * ATTACK_FALL_TIMECONST));
@@ -31,10 +31,18 @@ public:
     void        setup(bool AgcOn, bool UseHang, int Threshold, int ManualGain,
                       int Slope, int Decay, real_t SampleRate);
 
+    /*
+     * Change the sample rate without resetting the AGC, so the gain carries
+     * over. setup() must have been called first.
+     */
+    void        set_sample_rate(real_t SampleRate);
+
     void        process(int num, complex_t * inbuf, complex_t * outbuf);
     void        process(int num, real_t * inbuf, real_t * outbuf);
 
 private:
+    void        update_rate(void);
+
     bool        m_AgcOn;
     bool        m_UseHang;
     int         m_Threshold;
@@ -36,6 +36,323 @@
 
 #include "cute_fft.h"
 
+/*
+ * SIMD versions of the radix 4 butterflies in cftmdl() and of the last pass
+ * of cpx_fft() and cftbsub(). One call does the butterflies of one group,
+ * i.e. the l reals at a, a + l, a + 2l and a + 3l, with the same twiddles
+ * for the whole group:
+ *
+ *   out0 = x0 + x2
+ *   out1 = w1 * (x1 + j * x3)
+ *   out2 = w2 * (x0 - x2)
+ *   out3 = w3 * (x1 - j * x3)
+ *
+ * where x0 = a0 + a1, x1 = a0 - a1, x2 = a2 + a3 and x3 = a2 - a3. tw holds
+ * w1, w2 and w3 as re, im pairs or is NULL for unit twiddles. conj negates
+ * the imaginary part of the output, which the last pass of cftbsub() needs.
+ *
+ * cft1st() stays scalar. Its butterflies span four consecutive complex
+ * values with new twiddles for each, so it is one pass out of log4(n).
+ *
+ * SSE is the baseline on x86_64, so the runtime choice on x86 is whether
+ * AVX2 is available. NEON is selected at compile time.
+ */
+#if defined(__SSE__) && !defined(USE_DOUBLE)
+#include <xmmintrin.h>
+#define CUTE_FFT_SSE
+#elif defined(__ARM_NEON) && !defined(USE_DOUBLE)
+#include <arm_neon.h>
+#define CUTE_FFT_NEON
+#endif
+
+#if !defined(USE_DOUBLE) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define CUTE_FFT_AVX2
+#endif
+
+struct cft_kernels
+{
+    const char *name;
+    int32_t     width;      // reals per vector, l must be a multiple
+    void      (*radix4)(real_t *a, int32_t l, const real_t *tw, bool conj);
+    void      (*radix2)(real_t *a, int32_t l, bool conj);
+};
+
+#if defined(CUTE_FFT_SSE)
+/* x * w for a broadcast twiddle, wr = (re, re) and wi = (-im, im) */
+static inline __m128 cmul_sse(__m128 x, __m128 wr, __m128 wi)
+{
+    return _mm_add_ps(_mm_mul_ps(x, wr),
+                      _mm_mul_ps(_mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 3, 0, 1)),
+                                 wi));
+}
+
+static void radix4_sse(real_t *a, int32_t l, const real_t *tw, bool conj)
+{
+    const __m128    jmask = _mm_setr_ps(-0.0f, 0.0f, -0.0f, 0.0f);
+    const __m128    cmask = conj ? _mm_setr_ps(0.0f, -0.0f, 0.0f, -0.0f) :
+                                   _mm_setzero_ps();
+    __m128          w1r, w1i, w2r, w2i, w3r, w3i;
+    __m128          x0, x1, x2, x3;
+    int32_t         j;
+
+    if (tw)
+    {
+        w1r = _mm_set1_ps(tw[0]);
+        w1i = _mm_setr_ps(-tw[1], tw[1], -tw[1], tw[1]);
+        w2r = _mm_set1_ps(tw[2]);
+        w2i = _mm_setr_ps(-tw[3], tw[3], -tw[3], tw[3]);
+        w3r = _mm_set1_ps(tw[4]);
+        w3i = _mm_setr_ps(-tw[5], tw[5], -tw[5], tw[5]);
+    }
+
+    for (j = 0; j < l; j += 4)
+    {
+        x0 = _mm_loadu_ps(a + j);
+        x1 = _mm_loadu_ps(a + j + l);
+        x2 = _mm_loadu_ps(a + j + 2 * l);
+        x3 = _mm_loadu_ps(a + j + 3 * l);
+
+        __m128  s01 = _mm_add_ps(x0, x1);
+        __m128  d01 = _mm_sub_ps(x0, x1);
+        __m128  s23 = _mm_add_ps(x2, x3);
+        __m128  d23 = _mm_sub_ps(x2, x3);
+
+        // j * (a2 - a3)
+        d23 = _mm_xor_ps(_mm_shuffle_ps(d23, d23, _MM_SHUFFLE(2, 3, 0, 1)),
+                         jmask);
+
+        x0 = _mm_add_ps(s01, s23);
+        x1 = _mm_add_ps(d01, d23);
+        x2 = _mm_sub_ps(s01, s23);
+        x3 = _mm_sub_ps(d01, d23);
+        if (tw)
+        {
+            x1 = cmul_sse(x1, w1r, w1i);
+            x2 = cmul_sse(x2, w2r, w2i);
+            x3 = cmul_sse(x3, w3r, w3i);
+        }
+
+        _mm_storeu_ps(a + j, _mm_xor_ps(x0, cmask));
+        _mm_storeu_ps(a + j + l, _mm_xor_ps(x1, cmask));
+        _mm_storeu_ps(a + j + 2 * l, _mm_xor_ps(x2, cmask));
+        _mm_storeu_ps(a + j + 3 * l, _mm_xor_ps(x3, cmask));
+    }
+}
+
+static void radix2_sse(real_t *a, int32_t l, bool conj)
+{
+    const __m128    cmask = conj ? _mm_setr_ps(0.0f, -0.0f, 0.0f, -0.0f) :
+                                   _mm_setzero_ps();
+    __m128          x0, x1;
+    int32_t         j;
+
+    for (j = 0; j < l; j += 4)
+    {
+        x0 = _mm_loadu_ps(a + j);
+        x1 = _mm_loadu_ps(a + j + l);
+        _mm_storeu_ps(a + j, _mm_xor_ps(_mm_add_ps(x0, x1), cmask));
+        _mm_storeu_ps(a + j + l, _mm_xor_ps(_mm_sub_ps(x0, x1), cmask));
+    }
+}
+
+static const struct cft_kernels cft_sse = {
+    "sse", 4, radix4_sse, radix2_sse
+};
+#endif /* CUTE_FFT_SSE */
+
+#if defined(CUTE_FFT_AVX2)
+__attribute__((target("avx2")))
+static inline __m256 cmul_avx2(__m256 x, __m256 wr, __m256 wi)
+{
+    return _mm256_add_ps(_mm256_mul_ps(x, wr),
+                         _mm256_mul_ps(_mm256_permute_ps(x, 0xB1), wi));
+}
+
+__attribute__((target("avx2")))
+static void radix4_avx2(real_t *a, int32_t l, const real_t *tw, bool conj)
+{
+    const __m256    jmask = _mm256_setr_ps(-0.0f, 0.0f, -0.0f, 0.0f,
+                                           -0.0f, 0.0f, -0.0f, 0.0f);
+    const __m256    cmask = conj ? _mm256_setr_ps(0.0f, -0.0f, 0.0f, -0.0f,
+                                                  0.0f, -0.0f, 0.0f, -0.0f) :
+                                   _mm256_setzero_ps();
+    __m256          w1r, w1i, w2r, w2i, w3r, w3i;
+    __m256          x0, x1, x2, x3;
+    int32_t         j;
+
+    if (tw)
+    {
+        w1r = _mm256_set1_ps(tw[0]);
+        w1i = _mm256_setr_ps(-tw[1], tw[1], -tw[1], tw[1],
+                             -tw[1], tw[1], -tw[1], tw[1]);
+        w2r = _mm256_set1_ps(tw[2]);
+        w2i = _mm256_setr_ps(-tw[3], tw[3], -tw[3], tw[3],
+                             -tw[3], tw[3], -tw[3], tw[3]);
+        w3r = _mm256_set1_ps(tw[4]);
+        w3i = _mm256_setr_ps(-tw[5], tw[5], -tw[5], tw[5],
+                             -tw[5], tw[5], -tw[5], tw[5]);
+    }
+
+    for (j = 0; j < l; j += 8)
+    {
+        x0 = _mm256_loadu_ps(a + j);
+        x1 = _mm256_loadu_ps(a + j + l);
+        x2 = _mm256_loadu_ps(a + j + 2 * l);
+        x3 = _mm256_loadu_ps(a + j + 3 * l);
+
+        __m256  s01 = _mm256_add_ps(x0, x1);
+        __m256  d01 = _mm256_sub_ps(x0, x1);
+        __m256  s23 = _mm256_add_ps(x2, x3);
+        __m256  d23 = _mm256_sub_ps(x2, x3);
+
+        // j * (a2 - a3)
+        d23 = _mm256_xor_ps(_mm256_permute_ps(d23, 0xB1), jmask);
+
+        x0 = _mm256_add_ps(s01, s23);
+        x1 = _mm256_add_ps(d01, d23);
+        x2 = _mm256_sub_ps(s01, s23);
+        x3 = _mm256_sub_ps(d01, d23);
+        if (tw)
+        {
+            x1 = cmul_avx2(x1, w1r, w1i);
+            x2 = cmul_avx2(x2, w2r, w2i);
+            x3 = cmul_avx2(x3, w3r, w3i);
+        }
+
+        _mm256_storeu_ps(a + j, _mm256_xor_ps(x0, cmask));
+        _mm256_storeu_ps(a + j + l, _mm256_xor_ps(x1, cmask));
+        _mm256_storeu_ps(a + j + 2 * l, _mm256_xor_ps(x2, cmask));
+        _mm256_storeu_ps(a + j + 3 * l, _mm256_xor_ps(x3, cmask));
+    }
+}
+
+__attribute__((target("avx2")))
+static void radix2_avx2(real_t *a, int32_t l, bool conj)
+{
+    const __m256    cmask = conj ? _mm256_setr_ps(0.0f, -0.0f, 0.0f, -0.0f,
+                                                  0.0f, -0.0f, 0.0f, -0.0f) :
+                                   _mm256_setzero_ps();
+    __m256          x0, x1;
+    int32_t         j;
+
+    for (j = 0; j < l; j += 8)
+    {
+        x0 = _mm256_loadu_ps(a + j);
+        x1 = _mm256_loadu_ps(a + j + l);
+        _mm256_storeu_ps(a + j, _mm256_xor_ps(_mm256_add_ps(x0, x1), cmask));
+        _mm256_storeu_ps(a + j + l,
+                         _mm256_xor_ps(_mm256_sub_ps(x0, x1), cmask));
+    }
+}
+
+static const struct cft_kernels cft_avx2 = {
+    "avx2", 8, radix4_avx2, radix2_avx2
+};
+#endif /* CUTE_FFT_AVX2 */
+
+#if defined(CUTE_FFT_NEON)
+/* x * w for a broadcast twiddle, wr = (re, re) and wi = (-im, im) */
+static inline float32x4_t cmul_neon(float32x4_t x, float32x4_t wr,
+                                    float32x4_t wi)
+{
+    return vmlaq_f32(vmulq_f32(x, wr), vrev64q_f32(x), wi);
+}
+
+static void radix4_neon(real_t *a, int32_t l, const real_t *tw, bool conj)
+{
+    const float32x4_t   jsign = { -1.0f, 1.0f, -1.0f, 1.0f };
+    const float32x4_t   csign = { 1.0f, conj ? -1.0f : 1.0f,
+                                  1.0f, conj ? -1.0f : 1.0f };
+    float32x4_t         w1r, w1i, w2r, w2i, w3r, w3i;
+    float32x4_t         x0, x1, x2, x3;
+    int32_t             j;
+
+    if (tw)
+    {
+        w1r = vdupq_n_f32(tw[0]);
+        w1i = vmulq_n_f32(jsign, tw[1]);
+        w2r = vdupq_n_f32(tw[2]);
+        w2i = vmulq_n_f32(jsign, tw[3]);
+        w3r = vdupq_n_f32(tw[4]);
+        w3i = vmulq_n_f32(jsign, tw[5]);
+    }
+
+    for (j = 0; j < l; j += 4)
+    {
+        x0 = vld1q_f32(a + j);
+        x1 = vld1q_f32(a + j + l);
+        x2 = vld1q_f32(a + j + 2 * l);
+        x3 = vld1q_f32(a + j + 3 * l);
+
+        float32x4_t s01 = vaddq_f32(x0, x1);
+        float32x4_t d01 = vsubq_f32(x0, x1);
+        float32x4_t s23 = vaddq_f32(x2, x3);
+        float32x4_t d23 = vsubq_f32(x2, x3);
+
+        // j * (a2 - a3)
+        d23 = vmulq_f32(vrev64q_f32(d23), jsign);
+
+        x0 = vaddq_f32(s01, s23);
+        x1 = vaddq_f32(d01, d23);
+        x2 = vsubq_f32(s01, s23);
+        x3 = vsubq_f32(d01, d23);
+        if (tw)
+        {
+            x1 = cmul_neon(x1, w1r, w1i);
+            x2 = cmul_neon(x2, w2r, w2i);
+            x3 = cmul_neon(x3, w3r, w3i);
+        }
+
+        vst1q_f32(a + j, vmulq_f32(x0, csign));
+        vst1q_f32(a + j + l, vmulq_f32(x1, csign));
+        vst1q_f32(a + j + 2 * l, vmulq_f32(x2, csign));
+        vst1q_f32(a + j + 3 * l, vmulq_f32(x3, csign));
+    }
+}
+
+static void radix2_neon(real_t *a, int32_t l, bool conj)
+{
+    const float32x4_t   csign = { 1.0f, conj ? -1.0f : 1.0f,
+                                  1.0f, conj ? -1.0f : 1.0f };
+    float32x4_t         x0, x1;
+    int32_t             j;
+
+    for (j = 0; j < l; j += 4)
+    {
+        x0 = vld1q_f32(a + j);
+        x1 = vld1q_f32(a + j + l);
+        vst1q_f32(a + j, vmulq_f32(vaddq_f32(x0, x1), csign));
+        vst1q_f32(a + j + l, vmulq_f32(vsubq_f32(x0, x1), csign));
+    }
+}
+
+static const struct cft_kernels cft_neon = {
+    "neon", 4, radix4_neon, radix2_neon
+};
+#endif /* CUTE_FFT_NEON */
+
+/* Fastest kernels supported by the CPU, or NULL for the scalar code. */
+static const struct cft_kernels *cft_select(void)
+{
+    const struct cft_kernels   *kern = NULL;
+
+#if defined(CUTE_FFT_SSE)
+    kern = &cft_sse;
+#elif defined(CUTE_FFT_NEON)
+    kern = &cft_neon;
+#endif
+
+#if defined(CUTE_FFT_AVX2)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        kern = &cft_avx2;
+#endif
+
+    return kern;
+}
+
 
 CuteFft::CuteFft()
 {
@@ -44,6 +361,8 @@ CuteFft::CuteFft()
     work_area = NULL;
     sincos_tbl = NULL;
     fft_in_buf = NULL;
+    twiddle = NULL;
+    kern = cft_select();
 
     setup(2048);
 }
@@ -70,8 +389,49 @@ void CuteFft::free_memory()
         delete[] fft_in_buf;
         fft_in_buf = NULL;
     }
+    if (twiddle)
+    {
+        delete[] twiddle;
+        twiddle = NULL;
+    }
+}
+
+bool CuteFft::valid_size(int32_t size)
+{
+    if (size < MIN_FFT_SIZE || size > MAX_FFT_SIZE)
+        return false;
+
+    while (size % 2 == 0)
+        size /= 2;
+    while (size % 3 == 0)
+        size /= 3;
+    while (size % 5 == 0)
+        size /= 5;
+
+    return size == 1;
+}
+
+int32_t CuteFft::next_size(int32_t size)
+{
+    if (size < MIN_FFT_SIZE)
+        return MIN_FFT_SIZE;
+
+    while (size < MAX_FFT_SIZE && !valid_size(size))
+        size++;
+
+    return size > MAX_FFT_SIZE ? MAX_FFT_SIZE : size;
+}
+
+
+void CuteFft::set_simd(bool enable)
+{
+    kern = enable ? cft_select() : NULL;
 }
 
+const char *CuteFft::simd_name(void) const
+{
+    return kern ? kern->name : "generic";
+}
 
 // FFT initialization and parameter setup function
 void CuteFft::setup(int32_t size)
@@ -79,23 +439,38 @@ void CuteFft::setup(int32_t size)
     if (size == 0)
         return;
 
-    if (size < MIN_FFT_SIZE)
-        fft_size = MIN_FFT_SIZE;
-    else if (size > MAX_FFT_SIZE)
-        fft_size = MAX_FFT_SIZE;
-    else
-        fft_size = size;
+    fft_size = next_size(size);
 
     if (last_fft_size != fft_size)
     {
+        int32_t     k;
+
         last_fft_size = fft_size;
         free_memory();
-        sincos_tbl = new real_t[fft_size/2];
-        work_area = new int32_t[(int32_t)MSQRT((real_t)fft_size)+2];
+
+        pow2_size = 1;
+        while (fft_size % (2 * pow2_size) == 0)
+            pow2_size *= 2;
+
+        // Ooura tables for the power of 2 part
+        sincos_tbl = new real_t[pow2_size / 2 + 2];
+        work_area = new int32_t[(int32_t)MSQRT((real_t)pow2_size)+2];
         work_area[0] = 0;
+        if (pow2_size >= 4)
+            makewt(pow2_size / 2, work_area, sincos_tbl);
+
         fft_in_buf = new real_t[fft_size*2];
         memset(fft_in_buf, 0, sizeof(real_t) * fft_size * 2);
-        makewt(fft_size / 2, work_area, sincos_tbl);
+
+        if (pow2_size != fft_size)
+        {
+            twiddle = new complex_t[fft_size];
+            for (k = 0; k < fft_size; k++)
+            {
+                twiddle[k].re = MCOS(K_2PI * k / fft_size);
+                twiddle[k].im = MSIN(K_2PI * k / fft_size);
+            }
+        }
     }
 }
 
@@ -105,14 +480,206 @@ void CuteFft::setup(int32_t size)
  */
 void CuteFft::fwd_fft(complex_t * iobuf)
 {
-    bitrv2(fft_size*2, work_area + 2, (real_t*)iobuf);
-    cpx_fft(fft_size*2, (real_t*)iobuf, sincos_tbl);
+    if (pow2_size == fft_size)
+        pow2_fft(iobuf, 1);
+    else
+        mixed_fft(iobuf, (complex_t *)fft_in_buf, fft_size, 1);
 }
 
 void CuteFft::rev_fft(complex_t * iobuf)
 {
-    bitrv2conj(fft_size*2, work_area + 2, (real_t*)iobuf);
-    cftbsub(fft_size*2, (real_t*)iobuf, sincos_tbl);
+    if (pow2_size == fft_size)
+        pow2_fft(iobuf, -1);
+    else
+        mixed_fft(iobuf, (complex_t *)fft_in_buf, fft_size, -1);
+}
+
+/*
+ * In place transform of pow2_size points. sign is the sign of the exponent,
+ * +1 for fwd_fft() and -1 for rev_fft().
+ */
+void CuteFft::pow2_fft(complex_t * buf, int sign)
+{
+    complex_t   x;
+
+    if (pow2_size == 1)
+        return;
+
+    if (pow2_size == 2)
+    {
+        x = buf[1];
+        buf[1].re = buf[0].re - x.re;
+        buf[1].im = buf[0].im - x.im;
+        buf[0].re += x.re;
+        buf[0].im += x.im;
+        return;
+    }
+
+    if (sign > 0)
+    {
+        bitrv2(pow2_size*2, work_area + 2, (real_t*)buf);
+        cpx_fft(pow2_size*2, (real_t*)buf, sincos_tbl);
+    }
+    else
+    {
+        bitrv2conj(pow2_size*2, work_area + 2, (real_t*)buf);
+        cftbsub(pow2_size*2, (real_t*)buf, sincos_tbl);
+    }
+}
+
+/*
+ * Mixed radix decimation in time. The n points in buf are split into r
+ * interleaved sequences of m = n / r points, which are transformed
+ * recursively and combined by a radix r butterfly. The factors of 5 and 3
+ * are split off first, leaving the power of 2 part to pow2_fft().
+ *
+ * tmp is scratch space for n points. The result is placed in buf.
+ */
+void CuteFft::mixed_fft(complex_t * buf, complex_t * tmp, int32_t n,
+                        int sign)
+{
+    int32_t     i, q, r, m;
+
+    if (n == pow2_size)
+    {
+        pow2_fft(buf, sign);
+        return;
+    }
+
+    r = (n % 5 == 0) ? 5 : 3;
+    m = n / r;
+
+    for (q = 0; q < r; q++)
+        for (i = 0; i < m; i++)
+            tmp[q * m + i] = buf[i * r + q];
+
+    // the sub transforms use their part of buf as scratch
+    for (q = 0; q < r; q++)
+        mixed_fft(tmp + q * m, buf + q * m, m, sign);
+
+    if (r == 5)
+        radix5(tmp, buf, m, fft_size / n, sign);
+    else
+        radix3(tmp, buf, m, fft_size / n, sign);
+}
+
+/* a = x * (w.re + j * wi) */
+static inline void twiddle_mpy(complex_t &a, const complex_t &x,
+                               const complex_t &w, real_t wi)
+{
+    a.re = x.re * w.re - x.im * wi;
+    a.im = x.re * wi + x.im * w.re;
+}
+
+/*
+ * Combine the m point transforms in tmp into out. Input q of bin k is
+ * twiddled with exp(sign*j*2*pi*q*k/n), which is entry q*k*step of the
+ * table since step is fft_size / n. q*k < n, so the index does not wrap.
+ */
+void CuteFft::radix3(complex_t * tmp, complex_t * out, int32_t m,
+                     int32_t step, int sign)
+{
+    const real_t    c = -0.5;
+    const real_t    d = sign * 0.86602540378443864676;  // sin(2*pi/3)
+    const complex_t    *x1 = tmp + m;
+    const complex_t    *x2 = tmp + 2 * m;
+    complex_t      *y1 = out + m;
+    complex_t      *y2 = out + 2 * m;
+    const complex_t    *w;
+    complex_t       a0, a1, a2;
+    real_t          sr, si, tr, ti;
+    int32_t         k, j;
+
+    for (k = 0, j = 0; k < m; k++, j += step)
+    {
+        a0 = tmp[k];
+        w = &twiddle[j];
+        twiddle_mpy(a1, x1[k], *w, sign * w->im);
+        w = &twiddle[2 * j];
+        twiddle_mpy(a2, x2[k], *w, sign * w->im);
+
+        sr = a1.re + a2.re;
+        si = a1.im + a2.im;
+        tr = a0.re + c * sr;
+        ti = a0.im + c * si;
+        out[k].re = a0.re + sr;
+        out[k].im = a0.im + si;
+
+        // j * d * (a1 - a2)
+        sr = -d * (a1.im - a2.im);
+        si = d * (a1.re - a2.re);
+
+        y1[k].re = tr + sr;
+        y1[k].im = ti + si;
+        y2[k].re = tr - sr;
+        y2[k].im = ti - si;
+    }
+}
+
+void CuteFft::radix5(complex_t * tmp, complex_t * out, int32_t m,
+                     int32_t step, int sign)
+{
+    const real_t    c1 = 0.30901699437494742410;            // cos(2*pi/5)
+    const real_t    c2 = -0.80901699437494742410;           // cos(4*pi/5)
+    const real_t    s1 = sign * 0.95105651629515357212;     // sin(2*pi/5)
+    const real_t    s2 = sign * 0.58778525229247312917;     // sin(4*pi/5)
+    const complex_t    *x1 = tmp + m;
+    const complex_t    *x2 = tmp + 2 * m;
+    const complex_t    *x3 = tmp + 3 * m;
+    const complex_t    *x4 = tmp + 4 * m;
+    complex_t      *y1 = out + m;
+    complex_t      *y2 = out + 2 * m;
+    complex_t      *y3 = out + 3 * m;
+    complex_t      *y4 = out + 4 * m;
+    const complex_t    *w;
+    complex_t       a0, a1, a2, a3, a4;
+    real_t          b1r, b1i, b2r, b2i, d1r, d1i, d2r, d2i;
+    real_t          t1r, t1i, t2r, t2i, u1r, u1i, u2r, u2i;
+    int32_t         k, j;
+
+    for (k = 0, j = 0; k < m; k++, j += step)
+    {
+        a0 = tmp[k];
+        w = &twiddle[j];
+        twiddle_mpy(a1, x1[k], *w, sign * w->im);
+        w = &twiddle[2 * j];
+        twiddle_mpy(a2, x2[k], *w, sign * w->im);
+        w = &twiddle[3 * j];
+        twiddle_mpy(a3, x3[k], *w, sign * w->im);
+        w = &twiddle[4 * j];
+        twiddle_mpy(a4, x4[k], *w, sign * w->im);
+
+        b1r = a1.re + a4.re;
+        b1i = a1.im + a4.im;
+        b2r = a2.re + a3.re;
+        b2i = a2.im + a3.im;
+        d1r = a1.re - a4.re;
+        d1i = a1.im - a4.im;
+        d2r = a2.re - a3.re;
+        d2i = a2.im - a3.im;
+
+        t1r = a0.re + c1 * b1r + c2 * b2r;
+        t1i = a0.im + c1 * b1i + c2 * b2i;
+        t2r = a0.re + c2 * b1r + c1 * b2r;
+        t2i = a0.im + c2 * b1i + c1 * b2i;
+
+        // j * (s1 * d1 + s2 * d2) and j * (s2 * d1 - s1 * d2)
+        u1r = -(s1 * d1i + s2 * d2i);
+        u1i = s1 * d1r + s2 * d2r;
+        u2r = -(s2 * d1i - s1 * d2i);
+        u2i = s2 * d1r - s1 * d2r;
+
+        out[k].re = a0.re + b1r + b2r;
+        out[k].im = a0.im + b1i + b2i;
+        y1[k].re = t1r + u1r;
+        y1[k].im = t1i + u1i;
+        y2[k].re = t2r + u2r;
+        y2[k].im = t2i + u2i;
+        y3[k].re = t2r - u2r;
+        y3[k].im = t2i - u2i;
+        y4[k].re = t1r - u1r;
+        y4[k].im = t1i - u1i;
+    }
 }
 
 /*
@@ -166,6 +733,14 @@ void CuteFft::cpx_fft(int32_t n, real_t * a, real_t * w)
             l <<= 2;
         }
     }
+    if (kern && l >= kern->width)
+    {
+        if ((l << 2) == n)
+            kern->radix4(a, l, NULL, false);
+        else
+            kern->radix2(a, l, false);
+        return;
+    }
     if ((l << 2) == n)
     {
         for (j = 0; j < l; j += 2)
@@ -381,6 +956,14 @@ void CuteFft::cftfsub(int32_t n, real_t * a, real_t * w)
             l <<= 2;
         }
     }
+    if (kern && l >= kern->width)
+    {
+        if ((l << 2) == n)
+            kern->radix4(a, l, NULL, false);
+        else
+            kern->radix2(a, l, false);
+        return;
+    }
     if ((l << 2) == n)
     {
         for (j = 0; j < l; j += 2)
@@ -532,6 +1115,12 @@ void CuteFft::cftmdl(int32_t n, int32_t l, real_t * a, real_t * w)
     real_t      wk1r, wk1i, wk2r, wk2i, wk3r, wk3i;
     real_t      x0r, x0i, x1r, x1i, x2r, x2i, x3r, x3i;
 
+    if (kern)
+    {
+        cftmdl_simd(n, l, a, w);
+        return;
+    }
+
     m = l << 2;
     for (j = 0; j < l; j += 2)
     {
@@ -657,6 +1246,58 @@ void CuteFft::cftmdl(int32_t n, int32_t l, real_t * a, real_t * w)
     }
 }
 
+/*
+ * cftmdl() using the SIMD kernels. The groups are the same, with the twiddles
+ * of the special cases written out.
+ */
+void CuteFft::cftmdl_simd(int32_t n, int32_t l, real_t * a, real_t * w)
+{
+    int32_t     k, k1, k2, m, m2;
+    real_t      wk1r, wk1i, wk2r, wk2i;
+    real_t      tw[6];
+
+    m = l << 2;
+    kern->radix4(a, l, NULL, false);
+
+    wk1r = w[2];
+    tw[0] = wk1r;
+    tw[1] = wk1r;
+    tw[2] = 0.0;
+    tw[3] = 1.0;
+    tw[4] = -wk1r;
+    tw[5] = wk1r;
+    kern->radix4(a + m, l, tw, false);
+
+    k1 = 0;
+    m2 = 2 * m;
+    for (k = m2; k < n; k += m2)
+    {
+        k1 += 2;
+        k2 = 2 * k1;
+        wk2r = w[k1];
+        wk2i = w[k1 + 1];
+        wk1r = w[k2];
+        wk1i = w[k2 + 1];
+        tw[0] = wk1r;
+        tw[1] = wk1i;
+        tw[2] = wk2r;
+        tw[3] = wk2i;
+        tw[4] = wk1r - 2 * wk2i * wk1i;
+        tw[5] = 2 * wk2i * wk1r - wk1i;
+        kern->radix4(a + k, l, tw, false);
+
+        wk1r = w[k2 + 2];
+        wk1i = w[k2 + 3];
+        tw[0] = wk1r;
+        tw[1] = wk1i;
+        tw[2] = -wk2i;
+        tw[3] = wk2r;
+        tw[4] = wk1r - 2 * wk2r * wk1i;
+        tw[5] = 2 * wk2r * wk1r - wk1i;
+        kern->radix4(a + k + m, l, tw, false);
+    }
+}
+
 void CuteFft::bitrv2conj(int n, int * ip, real_t * a)
 {
     int         j, j1, k, k1, l, m, m2;
@@ -790,6 +1431,14 @@ void CuteFft::cftbsub(int n, real_t * a, real_t * w)
             l <<= 2;
         }
     }
+    if (kern && l >= kern->width)
+    {
+        if ((l << 2) == n)
+            kern->radix4(a, l, NULL, true);
+        else
+            kern->radix2(a, l, true);
+        return;
+    }
     if ((l << 2) == n)
     {
         for (j = 0; j < l; j += 2)
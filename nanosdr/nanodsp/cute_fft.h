@@ -8,9 +8,16 @@
 #include <stdint.h>
 #include "common/datatypes.h"
 
+struct cft_kernels;
+
 #define MAX_FFT_SIZE 65536
-#define MIN_FFT_SIZE 512
+#define MIN_FFT_SIZE 16
 
+/*
+ * Sizes are a power of 2 times any product of 3s and 5s, for example 960,
+ * 1920 or 3840. The odd factors are split off by radix 3 and radix 5 stages
+ * on top of the radix 4 transform of the power of 2 part.
+ */
 class CuteFft
 {
 public:
@@ -18,12 +25,38 @@ public:
 	virtual    ~CuteFft();
 	void        setup(int32_t size);
 
+	// Size used after setup(), see valid_size()
+	int32_t     get_size(void) const
+	{
+		return fft_size;
+	}
+
+	// True if size is a supported FFT size
+	static bool     valid_size(int32_t size);
+
+	// Smallest supported FFT size >= size, or MAX_FFT_SIZE
+	static int32_t  next_size(int32_t size);
+
+	/*
+	 * The radix 4 passes use AVX2, SSE or NEON kernels when the CPU has
+	 * them, see cute_fft.cpp. set_simd(false) selects the scalar code.
+	 */
+	void        set_simd(bool enable);
+	const char *simd_name(void) const;
+
 	// Methods for doing Fast convolutions using forward and reverse FFT
 	void        fwd_fft(complex_t * iobuf);
 	void        rev_fft(complex_t * iobuf);
 
 private:
 	void        free_memory();
+	void        pow2_fft(complex_t * buf, int sign);
+	void        mixed_fft(complex_t * buf, complex_t * tmp, int32_t n,
+	                      int sign);
+	void        radix3(complex_t * tmp, complex_t * out, int32_t m,
+	                   int32_t step, int sign);
+	void        radix5(complex_t * tmp, complex_t * out, int32_t m,
+	                   int32_t step, int sign);
 	void        cpx_fft(int32_t n, real_t * a, real_t * w);
 	void        makewt(int32_t nw, int32_t * ip, real_t * w);
 	void        makect(int32_t nc, int32_t * ip, real_t * c);
@@ -32,14 +65,19 @@ private:
 	void        rftfsub(int32_t n, real_t * a, int32_t nc, real_t * c);
 	void        cft1st(int32_t n, real_t * a, real_t * w);
 	void        cftmdl(int32_t n, int32_t l, real_t * a, real_t * w);
+	void        cftmdl_simd(int32_t n, int32_t l, real_t * a, real_t * w);
 	void        bitrv2conj(int n, int * ip, real_t * a);
 	void        cftbsub(int n, real_t * a, real_t * w);
 
 	int32_t     fft_size;
 	int32_t     last_fft_size;
+	int32_t     pow2_size;      // power of 2 part of fft_size
 
     int32_t    *work_area;
     real_t     *sincos_tbl;
-    real_t     *fft_in_buf;
+    real_t     *fft_in_buf;     // scratch for the radix 3 and 5 stages
+    complex_t  *twiddle;        // exp(j*2*pi*k/fft_size) for mixed sizes
+
+    const struct cft_kernels   *kern;  // SIMD kernels or NULL
 };
 
@@ -32,109 +32,355 @@
  */
 #include <stddef.h>
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 #include "fastfir.h"
 
-#define CONV_FFT_SIZE 2048  // must be power of 2
-#define CONV_FIR_SIZE 1025  // must be <= FFT size. Make 1/2 + 1 if you want
-                            // output to be in power of 2
+// Transition width of the window in bins of fs / taps. The main lobe of the
+// Blackman-Nuttall window is 8 bins wide.
+#define WINDOW_TRANSITION   8.0
 
-#define CONV_INBUF_SIZE (CONV_FFT_SIZE+CONV_FIR_SIZE-1)
+// The transition width is TRANSITION_RATIO times the bandwidth, which keeps
+// the default 2.4 kHz SSB filter at 1025 taps at 48 ksps, but at least
+// MIN_TRANSITION Hz to limit the delay of narrow CW filters.
+#define TRANSITION_RATIO    0.16
+#define MIN_TRANSITION      100.0
+
+// The history holds the samples needed to rebuild the delay line for a new
+// block size, see activate(), plus the samples waiting for the next block.
+#define HIST_LEN            16384
+#define HIST_MASK           (HIST_LEN - 1)
+
+// Delay line size for the largest filter at any block size
+#define FDL_SIZE            (2 * (FASTFIR_MAX_TAPS - 1 + FASTFIR_MAX_BLOCK))
+
+#if (1 << (FASTFIR_NUM_FFTS - 1)) != FASTFIR_MAX_DECIM
+#error "FASTFIR_NUM_FFTS does not cover FASTFIR_MAX_DECIM"
+#endif
+#if HIST_LEN < FASTFIR_MAX_TAPS - 1 + 2 * FASTFIR_MAX_BLOCK
+#error "HIST_LEN is too small for FASTFIR_MAX_TAPS"
+#endif
 
 
 FastFIR::FastFIR()
+{
+    hist = new complex_t[HIST_LEN];
+    fdl = new complex_t[FDL_SIZE];
+    fftbuf = new complex_t[2 * FASTFIR_MAX_BLOCK];
+    memset(hist, 0, HIST_LEN * sizeof(complex_t));
+    memset(fdl, 0, FDL_SIZE * sizeof(complex_t));
+
+    num_cached = 0;
+    slots[0].des = NULL;
+    slots[0].decim = 1;
+    slots[1] = slots[0];
+    last_slot = 0;
+    pending = -1;
+
+    cur = NULL;
+    cur_block = 0;
+    out_decim = 1;
+    inv_fft = NULL;
+    fdl_len = 1;
+    fdl_pos = 0;
+    hist_pos = 0;
+    unfiltered = 0;
+
+    // default filter until setup() is called
+    locut = -250.0;
+    hicut = 250.0;
+    offset = 0.0;
+    samprate = 48000.0;
+    max_block_size = FASTFIR_MAX_BLOCK;
+    max_decim = 1;
+    publish();
+
+    // process() always has a design, even when a change is in progress
+    activate(&slots[pending]);
+    pending = -1;
+}
+
+FastFIR::~FastFIR()
 {
     int     i;
 
-    window = NULL;
-    fftbuf = NULL;
-    fftovrbuf = NULL;
-    filter_coef = NULL;
+    for (i = 0; i < num_cached; i++)
+        free_design(cache[i]);
+    delete[] hist;
+    delete[] fdl;
+    delete[] fftbuf;
+}
 
-    window = new real_t[CONV_FIR_SIZE];
-    filter_coef = new complex_t[CONV_FFT_SIZE];
-    fftbuf = new complex_t[CONV_FFT_SIZE];
-    fftovrbuf = new complex_t[CONV_FIR_SIZE];
+void FastFIR::free_design(struct design * des)
+{
+    int     i;
 
-    if (!window || !filter_coef || !fftbuf || !fftovrbuf)
-        return;
+    for (i = 0; i < des->num_ffts; i++)
+        delete des->ffts[i];
+    delete[] des->coef;
+    delete des;
+}
+
+void FastFIR::make_window(real_t * window, int taps)
+{
+    int     i;
 
-    inbuf_inpos = (CONV_FIR_SIZE - 1);
-    for (i = 0; i < CONV_FFT_SIZE; i++)
-    {
-        fftbuf[i].re = 0.0;
-        fftbuf[i].im = 0.0;
-    }
 #if 1
     // Blackman-Nuttall window function for windowed sinc low pass filter design
-    for (i = 0; i < CONV_FIR_SIZE; i++)
+    for (i = 0; i < taps; i++)
     {
         window[i] = (0.3635819
-            - 0.4891775 * MCOS((K_2PI * i) / (CONV_FIR_SIZE - 1))
-            + 0.1365995 * MCOS((2.0 * K_2PI * i) / (CONV_FIR_SIZE - 1))
-            - 0.0106411 * MCOS((3.0 * K_2PI * i) / (CONV_FIR_SIZE - 1)));
-        fftovrbuf[i].re = 0.0;
-        fftovrbuf[i].im = 0.0;
+            - 0.4891775 * MCOS((K_2PI * i) / (taps - 1))
+            + 0.1365995 * MCOS((2.0 * K_2PI * i) / (taps - 1))
+            - 0.0106411 * MCOS((3.0 * K_2PI * i) / (taps - 1)));
     }
 #endif
 #if 0
     // Blackman-Harris window function for windowed sinc low pass filter design
-    for (i = 0; i < CONV_FIR_SIZE; i++)
+    for (i = 0; i < taps; i++)
     {
         window[i] = (0.35875
-            - 0.48829 * MCOS((K_2PI * i) / (CONV_FIR_SIZE - 1))
-            + 0.14128 * MCOS((2.0 * K_2PI * i) / (CONV_FIR_SIZE - 1))
-            - 0.01168 * MCOS((3.0 * K_2PI * i) / (CONV_FIR_SIZE - 1)));
-        fftovrbuf[i].re = 0.0;
-        fftovrbuf[i].im = 0.0;
+            - 0.48829 * MCOS((K_2PI * i) / (taps - 1))
+            + 0.14128 * MCOS((2.0 * K_2PI * i) / (taps - 1))
+            - 0.01168 * MCOS((3.0 * K_2PI * i) / (taps - 1)));
     }
 #endif
 #if 0
     // Nuttall window function for windowed sinc low pass filter design
-    for (i = 0; i < CONV_FIR_SIZE; i++)
+    for (i = 0; i < taps; i++)
     {
         window[i] = (0.355768
-            - 0.487396 * MCOS((K_2PI * i) / (CONV_FIR_SIZE - 1))
-            + 0.144232 * MCOS((2.0 * K_2PI * i) / (CONV_FIR_SIZE - 1))
-            - 0.012604 * MCOS((3.0 * K_2PI * i) / (CONV_FIR_SIZE - 1)));
-        fftovrbuf[i].re = 0.0;
-        fftovrbuf[i].im = 0.0;
+            - 0.487396 * MCOS((K_2PI * i) / (taps - 1))
+            + 0.144232 * MCOS((2.0 * K_2PI * i) / (taps - 1))
+            - 0.012604 * MCOS((3.0 * K_2PI * i) / (taps - 1)));
     }
 #endif
-    m_Fft.setup(CONV_FFT_SIZE);
-    locut = -1.0;
-    hicut = 1.0;
-    offset = 1.0;
-    samprate = 1.0;
 }
 
-FastFIR::~FastFIR()
+int FastFIR::estimate_taps(real_t tw, real_t fs)
+{
+    int     n = (int)ceil(WINDOW_TRANSITION * fs / tw);
+
+    // round up to fill the smallest partitions
+    n = (n + FASTFIR_MIN_BLOCK - 1) / FASTFIR_MIN_BLOCK * FASTFIR_MIN_BLOCK;
+    if (n > FASTFIR_MAX_TAPS - 1)
+        n = FASTFIR_MAX_TAPS - 1;
+
+    return n + 1;
+}
+
+/*
+ * Design the filter for the current parameters. The design has its own FFTs,
+ * so process() does not allocate when it switches to a new block size.
+ *
+ * Partition p holds taps p * block to (p + 1) * block - 1, and the last one
+ * also holds the final tap. A partition of block + 1 taps still leaves block
+ * valid outputs of an overlap-save FFT of 2 * block.
+ */
+struct FastFIR::design *FastFIR::make_design(void)
 {
-    free_memory();
+    struct design  *des = new struct design;
+    real_t     *window;
+    real_t      tw;
+    int         fft_size;
+    int         p, k;
+
+    des->locut = locut;
+    des->hicut = hicut;
+    des->offset = offset;
+    des->samprate = samprate;
+    des->max_block = max_block_size;
+
+    tw = TRANSITION_RATIO * (hicut - locut);
+    if (tw < MIN_TRANSITION)
+        tw = MIN_TRANSITION;
+    des->taps = estimate_taps(tw, samprate);
+
+    // smallest block holding the filter within the limit, halving keeps a
+    // block lined up with the frames the limit was chosen for
+    des->block = max_block_size;
+    while (des->block % 2 == 0 && des->block / 2 >= FASTFIR_MIN_BLOCK &&
+           des->block / 2 >= des->taps - 1)
+        des->block /= 2;
+    des->parts = (des->taps - 2) / des->block + 1;
+
+    fft_size = 2 * des->block;
+
+    // inverse FFT sizes for each decimation dividing the block size, since
+    // filter_block() keeps block / decim samples of each inverse FFT
+    des->num_ffts = 1;
+    while (des->num_ffts < FASTFIR_NUM_FFTS &&
+           (fft_size >> des->num_ffts) >= MIN_FFT_SIZE &&
+           des->block % (1 << des->num_ffts) == 0)
+        des->num_ffts++;
+    for (p = 0; p < des->num_ffts; p++)
+        des->ffts[p] = FftBackend::create_best(fft_size >> p);
+
+    des->coef = new complex_t[des->parts * fft_size];
+    memset(des->coef, 0, des->parts * fft_size * sizeof(complex_t));
+
+    window = new real_t[des->taps];
+    make_window(window, des->taps);
+
+    // normalized filter parameters
+    real_t  nFL = (locut + offset) / samprate;
+    real_t  nFH = (hicut + offset) / samprate;
+    real_t  nFc = (nFH - nFL) / 2.0;         // prototype LP filter cutoff
+    real_t  nFs = K_2PI * (nFH + nFL) / 2.0; // 2*PI times required frequency shift
+    real_t  fCenter = 0.5 * (real_t)(des->taps-1);
+
+    // create LP FIR windowed sinc, sin(x)/x complex LP filter coefficients
+    for (int i = 0; i < des->taps; i++)
+    {
+        real_t x = (real_t)i - fCenter;
+        real_t z;
+
+        if ((real_t) i == fCenter)    // deal with odd size filter singularity where sin(0)/0==1
+            z = 2.0 * nFc;
+        else
+            z = (real_t)MSIN(K_2PI * x * nFc) / (K_PI * x) * window[i];
+
+        p = i / des->block;
+        if (p == des->parts)
+            p--;
+        k = p * fft_size + i - p * des->block;
+
+        // shift lowpass filter coefficients in frequency by (hicut+lowcut)/2 to
+        // form bandpass filter anywhere in range
+        // (also scales by 1/FFTsize since inverse FFT routine scales by FFTsize)
+        des->coef[k].re = z * MCOS(nFs * x) / (real_t)fft_size;
+        des->coef[k].im = z * MSIN(nFs * x) / (real_t)fft_size;
+    }
+    delete[] window;
+
+    // convert FIR coefficients to frequency domain by taking forward FFT
+    for (p = 0; p < des->parts; p++)
+        des->ffts[0]->forward(des->coef + p * fft_size,
+                              des->coef + p * fft_size);
+
+    return des;
 }
 
-void FastFIR::free_memory()
+/*
+ * Get the design for the current parameters from the cache or make it. The
+ * design in slot keep may be in use by process() and is never evicted.
+ */
+struct FastFIR::design *FastFIR::find_design(int keep)
 {
-    if (window)
+    struct design  *des = NULL;
+    int     i;
+
+    for (i = 0; i < num_cached; i++)
     {
-        delete[] window;
-        window = NULL;
+        des = cache[i];
+        if (des->locut == locut && des->hicut == hicut &&
+            des->offset == offset && des->samprate == samprate &&
+            des->max_block == max_block_size)
+            break;
     }
-    if (fftovrbuf)
+
+    if (i == num_cached)
     {
-        delete[] fftovrbuf;
-        fftovrbuf = NULL;
+        des = make_design();
+        if (num_cached < FASTFIR_CACHE_SIZE)
+        {
+            i = num_cached++;
+        }
+        else
+        {
+            // evict the least recently used design
+            i = num_cached - 1;
+            if (cache[i] == slots[keep].des)
+                i--;
+            free_design(cache[i]);
+        }
     }
-    if (filter_coef)
+
+    // move to the front
+    for (; i > 0; i--)
+        cache[i] = cache[i - 1];
+    cache[0] = des;
+
+    return des;
+}
+
+/*
+ * Hand the current parameters over to process() through the slot it is not
+ * using. If the last slot was not picked up yet, it is taken back and
+ * reused, otherwise process() is on the last slot and the other one is free.
+ */
+void FastFIR::publish(void)
+{
+    const struct design    *des;
+    int     old, in_use, s;
+    int     decim;
+
+    old = __atomic_exchange_n(&pending, -1, __ATOMIC_ACQ_REL);
+    in_use = old < 0 ? last_slot : 1 - old;
+    s = 1 - in_use;
+
+    des = find_design(in_use);
+    decim = max_decim;
+    while (decim >= 1 << des->num_ffts)
+        decim /= 2;
+
+    slots[s].des = des;
+    slots[s].decim = decim;
+    last_slot = s;
+    __atomic_store_n(&pending, s, __ATOMIC_RELEASE);
+}
+
+int FastFIR::set_decimation(int decim)
+{
+    int     new_decim = 1;
+
+    while (new_decim < FASTFIR_MAX_DECIM && 2 * new_decim <= decim)
+        new_decim *= 2;
+
+    if (new_decim != max_decim)
     {
-        delete[] filter_coef;
-        filter_coef = NULL;
+        max_decim = new_decim;
+        publish();
     }
-    if (fftbuf)
+
+    return slots[last_slot].decim;
+}
+
+int FastFIR::max_decimation(void) const
+{
+    real_t  lo = fabs(locut + offset);
+    real_t  hi = fabs(hicut + offset);
+    real_t  edge;
+    int     decim = 1;
+
+    // outer edge of the transition band
+    edge = (lo > hi ? lo : hi) + 0.5 * WINDOW_TRANSITION * samprate /
+           (real_t)(cache[0]->taps - 1);
+
+    while (decim < FASTFIR_MAX_DECIM && samprate / (4 * decim) >= edge)
+        decim *= 2;
+
+    return decim;
+}
+
+int FastFIR::set_block_size(int size)
+{
+    int     new_size = size;
+
+    if (new_size > FASTFIR_MAX_BLOCK)
+        new_size = FASTFIR_MAX_BLOCK;
+    while (new_size > FASTFIR_MIN_BLOCK && !valid_block_size(new_size))
+        new_size--;
+    if (new_size < FASTFIR_MIN_BLOCK)
+        new_size = FASTFIR_MIN_BLOCK;
+
+    if (new_size != max_block_size)
     {
-        delete[] fftbuf;
-        fftbuf = NULL;
+        max_block_size = new_size;
+        publish();
     }
+
+    return cache[0]->block;
 }
 
 void FastFIR::setup(real_t low_cut, real_t high_cut, real_t cw_offs, real_t fs)
@@ -160,90 +406,153 @@ void FastFIR::setup(real_t low_cut, real_t high_cut, real_t cw_offs, real_t fs)
     hicut = high_cut;
     offset = cw_offs;
     samprate = fs;
-    locut += cw_offs;
-    hicut += cw_offs;
 
-    // normalized filter parameters
-    real_t  nFL = locut / fs;
-    real_t  nFH = hicut / fs;
-    real_t  nFc = (nFH - nFL) / 2.0;         // prototype LP filter cutoff
-    real_t  nFs = K_2PI * (nFH + nFL) / 2.0; // 2*PI times required frequency shift
-    real_t  fCenter = 0.5 * (real_t)(CONV_FIR_SIZE-1);
+    publish();
+}
 
-    for (int i = 0; i < CONV_FFT_SIZE; i++)
-    {
-        filter_coef[i].re = 0.0;
-        filter_coef[i].im = 0.0;
-    }
+void FastFIR::set_sample_rate(real_t new_rate)
+{
+    setup(locut, hicut, offset, new_rate);
+}
 
-    // create LP FIR windowed sinc, sin(x)/x complex LP filter coefficients
-    for (int i = 0; i < CONV_FIR_SIZE; i++)
-    {
-        real_t x = (real_t)i - fCenter;
-        real_t z;
+/* Copy the len samples of history before position end into out. */
+void FastFIR::history(int end, int len, complex_t * out) const
+{
+    int     start = (end - len) & HIST_MASK;
+    int     n = HIST_LEN - start;
 
-        if ((real_t) i == fCenter)    // deal with odd size filter singularity where sin(0)/0==1
-            z = 2.0 * nFc;
-        else
-            z = (real_t)MSIN(K_2PI * x * nFc) / (K_PI * x) * window[i];
+    if (n > len)
+        n = len;
+    memcpy(out, hist + start, n * sizeof(complex_t));
+    memcpy(out + n, hist, (len - n) * sizeof(complex_t));
+}
 
-        // shift lowpass filter coefficients in frequency by (hicut+lowcut)/2 to
-        // form bandpass filter anywhere in range
-        // (also scales by 1/FFTsize since inverse FFT routine scales by FFTsize)
-        filter_coef[i].re = z * MCOS(nFs * x) / (real_t)CONV_FFT_SIZE;
-        filter_coef[i].im = z * MSIN(nFs * x) / (real_t)CONV_FFT_SIZE;
+/*
+ * Switch to a new design. The spectra in the delay line stay valid as long as
+ * the block size is the same, otherwise they are computed again from the
+ * history, so the output continues without a gap.
+ */
+void FastFIR::activate(const struct slot * s)
+{
+    int     fft_size = 2 * s->des->block;
+    int     end;
+    int     q;
+
+    // the old design may be gone once the slot has been picked up, so only
+    // the block size kept in cur_block is compared
+    if (s->des->block != cur_block)
+    {
+        cur_block = s->des->block;
+        fdl_len = (FASTFIR_MAX_TAPS - 2) / cur_block + 1;
+        fdl_pos = 0;
+
+        // spectrum q is the block ending q blocks before the last one
+        end = hist_pos - unfiltered;
+        for (q = 0; q < fdl_len - 1; q++)
+        {
+            history(end - q * cur_block, fft_size, fdl + q * fft_size);
+            s->des->ffts[0]->forward(fdl + q * fft_size, fdl + q * fft_size);
+        }
     }
 
-    // convert FIR coefficients to frequency domain by taking forward FFT
-    m_Fft.fwd_fft(filter_coef);
+    cur = s->des;
+    out_decim = s->decim;
+    q = 0;
+    while ((1 << q) < out_decim)
+        q++;
+    inv_fft = cur->ffts[q];
 }
 
-void FastFIR::set_sample_rate(real_t new_rate)
+void FastFIR::filter_block(complex_t * outbuf)
 {
-    setup(locut, hicut, offset, new_rate);
+    complex_t  *spec;
+    int     fft_size = 2 * cur->block;
+    int     len = fft_size / out_decim;
+    int     p;
+
+    // transform the last two blocks into the newest delay line slot
+    fdl_pos = fdl_pos ? fdl_pos - 1 : fdl_len - 1;
+    spec = fdl + fdl_pos * fft_size;
+    history(hist_pos - unfiltered + cur->block, fft_size, spec);
+    cur->ffts[0]->forward(spec, spec);
+
+    // partition p filters the spectrum from p blocks ago
+    cpx_mpy(fft_size, cur->coef, spec, fftbuf);
+    for (p = 1; p < cur->parts; p++)
+    {
+        spec += fft_size;
+        if (spec == fdl + fdl_len * fft_size)
+            spec = fdl;
+        cpx_mac(fft_size, cur->coef + p * fft_size, spec, fftbuf);
+    }
+
+    if (out_decim > 1)
+        fold(fftbuf, len);
+    inv_fft->inverse(fftbuf, fftbuf);
+
+    // the first half of the FFT output is aliased, the second is valid
+    memcpy(outbuf, fftbuf + len / 2, len / 2 * sizeof(complex_t));
+    unfiltered -= cur->block;
 }
 
 int FastFIR::process(int num, complex_t * inbuf, complex_t * outbuf)
 {
     int     i = 0;
-    int     j;
-    int     len = num;
+    int     len, n;
+    int     s;
     int     outpos = 0;
 
-    if (!num)
-        return 0;
+    // pick up a new design at the start, so all output uses one design
+    s = __atomic_exchange_n(&pending, -1, __ATOMIC_ACQ_REL);
+    if (s >= 0)
+        activate(&slots[s]);
 
-    while (len--)
+    for (;;)
     {
-        j = inbuf_inpos - (CONV_FFT_SIZE - CONV_FIR_SIZE + 1) ;
-        if (j >= 0)
-            // keep copy of last CONV_FIR_SIZE-1 samples for overlap save
-            fftovrbuf[j] = inbuf[i];
-
-        fftbuf[inbuf_inpos++] = inbuf[i++];
-        if (inbuf_inpos >= CONV_FFT_SIZE)
+        while (unfiltered >= cur->block)
         {
-            m_Fft.fwd_fft(fftbuf);
-            cpx_mpy(CONV_FFT_SIZE, filter_coef, fftbuf, fftbuf);
-            m_Fft.rev_fft(fftbuf);
-
-            for (j = CONV_FIR_SIZE - 1; j < CONV_FFT_SIZE; j++)
-                // copy FFT output into OutBuf minus CONV_FIR_SIZE-1 samples at beginning
-                outbuf[outpos++] = fftbuf[j];
-
-            for (j = 0; j < CONV_FIR_SIZE - 1; j++)
-                // copy overlap buffer into start of fft input buffer
-                fftbuf[j] = fftovrbuf[j];
-
-            // reset input position to data start position of fft input buffer
-            inbuf_inpos = CONV_FIR_SIZE - 1;
+            filter_block(outbuf + outpos);
+            outpos += cur->block / out_decim;
         }
+        if (i >= num)
+            break;
+
+        // fill up the next block
+        len = cur->block - unfiltered;
+        if (len > num - i)
+            len = num - i;
+        n = HIST_LEN - hist_pos;
+        if (n > len)
+            n = len;
+        memcpy(hist + hist_pos, inbuf + i, n * sizeof(complex_t));
+        memcpy(hist, inbuf + i + n, (len - n) * sizeof(complex_t));
+        hist_pos = (hist_pos + len) & HIST_MASK;
+        unfiltered += len;
+        i += len;
     }
 
     // return number of output samples processed and placed in OutBuf
     return outpos;
 }
 
+/*
+ * Add the bins k + n * len into bin k. The inverse FFT of the first len bins
+ * is then every out_decim'th sample of the full inverse FFT.
+ */
+void FastFIR::fold(complex_t * buf, int len)
+{
+    int     i, k;
+
+    for (k = 1; k < out_decim; k++)
+    {
+        for (i = 0; i < len; i++)
+        {
+            buf[i].re += buf[k * len + i].re;
+            buf[i].im += buf[k * len + i].im;
+        }
+    }
+}
+
 /*
  * Complex multiply N point array m with src and place in dest.
  * src and dest can be the same buffer.
@@ -259,3 +568,16 @@ inline void FastFIR::cpx_mpy(int N, complex_t * m, complex_t * src,
         dest[i].im = m[i].re * si + m[i].im * sr;
     }
 }
+
+/* Complex multiply N point array m with src and add to dest. */
+inline void FastFIR::cpx_mac(int N, complex_t * m, complex_t * src,
+                             complex_t * dest)
+{
+    for (int i = 0; i < N; i++)
+    {
+        real_t  sr = src[i].re;
+        real_t  si = src[i].im;
+        dest[i].re += m[i].re * sr - m[i].im * si;
+        dest[i].im += m[i].re * si + m[i].im * sr;
+    }
+}
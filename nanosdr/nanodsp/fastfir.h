@@ -7,7 +7,49 @@
 
 #include "common/datatypes.h"
 #include "cute_fft.h"
+#include "fft_backend.h"
 
+// Block sizes for process(). The output is delayed by one block on top of the
+// group delay of the filter.
+#define FASTFIR_MIN_BLOCK   64
+#define FASTFIR_MAX_BLOCK   1024
+
+// Filter length limits, see setup()
+#define FASTFIR_MIN_TAPS    (FASTFIR_MIN_BLOCK + 1)
+#define FASTFIR_MAX_TAPS    8193
+
+// Largest output decimation, see set_decimation()
+#define FASTFIR_MAX_DECIM   64
+
+// Number of filter designs kept for reuse
+#define FASTFIR_CACHE_SIZE  8
+
+// Number of inverse FFT sizes, one for each decimation up to FASTFIR_MAX_DECIM
+#define FASTFIR_NUM_FFTS    7
+
+/*
+ * The filter uses uniformly partitioned overlap-save convolution. The impulse
+ * response is split into partitions of one block each. Every block of input
+ * is transformed once using an FFT of twice the block size and kept in a
+ * frequency domain delay line. The output spectrum is the sum of the spectra
+ * in the delay line multiplied with the partition they line up with. Small
+ * blocks give low latency for the same filter at the cost of more complex
+ * multiplications per sample.
+ *
+ * The block size is the limit set by set_block_size(), halved as long as the
+ * filter still fits in one block. A filter fitting in one partition runs the
+ * plain overlap-save algorithm. Blocks with factors of 3 and 5, like 960 at
+ * 48 ksps, can be lined up with the frames of the caller, so every call
+ * gives the same number of output samples.
+ *
+ * setup(), set_block_size() and set_decimation() may be called from another
+ * thread than process(). They design the filter in the calling thread, or
+ * take it from a cache of recent designs, and hand it over through one of two
+ * slots. process() picks up the latest design when it starts, so all output
+ * from one call uses the same filter and decimation. The input history is
+ * kept across changes, so the output does not glitch. Only one thread may
+ * change the filter at a time.
+ */
 class FastFIR
 {
 public:
@@ -23,10 +65,73 @@ public:
      *
      * Cutoff frequencies range from -SampleRate/2 to +SampleRate/2
      * high_cut must be greater than low_cut
+     *
+     * The transition width is a fraction of the bandwidth with a lower limit
+     * in Hz, so the skirts look the same at any sample rate. The number of
+     * taps follows from the transition width and the sample rate, and the
+     * block and FFT sizes from the number of taps.
      */
     void        setup(real_t low_cut, real_t high_cut, real_t cw_offs, real_t fs);
     void        set_sample_rate(real_t new_rate);
 
+    /*
+     * Set the largest processing block size, which is rounded down to a
+     * size between FASTFIR_MIN_BLOCK and FASTFIR_MAX_BLOCK where twice the
+     * size is a valid CuteFft size. The block size used is this size halved
+     * while it stays even and holds the filter length minus one. The filter
+     * keeps its response and history.
+     *
+     * Returns the block size used.
+     */
+    int         set_block_size(int size);
+
+    /* True if set_block_size() accepts size without rounding it. */
+    static bool valid_block_size(int size)
+    {
+        return size >= FASTFIR_MIN_BLOCK && size <= FASTFIR_MAX_BLOCK &&
+               CuteFft::valid_size(2 * size);
+    }
+
+    int         get_block_size(void) const
+    {
+        return cache[0]->block;
+    }
+
+    /* Number of taps of the current filter. */
+    int         get_taps(void) const
+    {
+        return cache[0]->taps;
+    }
+
+    /* Number of taps needed for the transition width tw at sample rate fs. */
+    static int  estimate_taps(real_t tw, real_t fs);
+
+    /*
+     * Decimate the output by decim, which is rounded down to a power of 2 up
+     * to FASTFIR_MAX_DECIM that divides the block size. The filtered
+     * spectrum is folded into decim times fewer bins before a smaller inverse
+     * FFT, which gives every decim'th sample of the full rate output.
+     * Anything outside +/- fs / (2 * decim) aliases, see max_decimation().
+     *
+     * The inverse FFT is kept at least MIN_FFT_SIZE points, which limits the
+     * decimation for small blocks.
+     *
+     * Returns the decimation process() will use.
+     */
+    int         set_decimation(int decim);
+
+    /* Decimation of the output from the last process() call. */
+    int         get_decimation(void) const
+    {
+        return out_decim;
+    }
+
+    /*
+     * Largest decimation that keeps the pass band and the transition bands
+     * free from aliases.
+     */
+    int         max_decimation(void) const;
+
     /*
      * Process complex samples
      *   num      The number of complex samples in the input buffer.
@@ -36,24 +141,75 @@ public:
      * Returns the number of complex samples placed in the output buffer.
      *
      * The number of samples returned in general will not be equal to the number
-     * of input samples due to FFT block size processing.
+     * of input samples due to FFT block size processing. Output is produced in
+     * multiples of the block size divided by the decimation, so outbuf must
+     * have space for num samples plus one block.
      */
     int         process(int num, complex_t * inbuf, complex_t * outbuf);
 
 private:
+    /* Frequency domain coefficients for one set of parameters */
+    struct design
+    {
+        real_t      locut;
+        real_t      hicut;
+        real_t      offset;
+        real_t      samprate;
+        int         max_block;
+
+        int         taps;
+        int         block;      // new samples per FFT
+        int         parts;      // number of partitions of 2 * block bins
+        int         num_ffts;   // decimations 1 to 2^(num_ffts - 1)
+        complex_t  *coef;
+        FftBackend *ffts[FASTFIR_NUM_FFTS]; // 2 * block >> i points
+    };
+
+    /* Design and decimation handed over to process() */
+    struct slot
+    {
+        const struct design    *des;
+        int                     decim;
+    };
+
     inline void cpx_mpy(int N, complex_t * m, complex_t * src, complex_t * dest);
-    void        free_memory();
+    inline void cpx_mac(int N, complex_t * m, complex_t * src, complex_t * dest);
+    void        make_window(real_t * window, int taps);
+    struct design  *make_design(void);
+    struct design  *find_design(int keep);
+    void        publish(void);
+    void        activate(const struct slot * s);
+    void        history(int end, int len, complex_t * out) const;
+    void        filter_block(complex_t * outbuf);
+    void        fold(complex_t * buf, int len);
+    void        free_design(struct design * des);
 
+    // filter parameters, only used by the thread changing the filter
     real_t      locut;
     real_t      hicut;
     real_t      offset;
     real_t      samprate;
+    int         max_block_size; // limit set by set_block_size()
+    int         max_decim;      // limit set by set_decimation()
 
-    unsigned int    inbuf_inpos;
-    real_t     *window;         // window coefficients
-    complex_t  *fftbuf;         // FFT buffer
-    complex_t  *fftovrbuf;      // FFT overlap buffer
-    complex_t  *filter_coef;    // Filter coefficients
+    struct design  *cache[FASTFIR_CACHE_SIZE];  // most recently used first
+    int         num_cached;
+
+    struct slot slots[2];
+    int         last_slot;      // slot published last
+    int         pending;        // slot for process() to pick up or -1
 
-    CuteFft     m_Fft;
+    // filter state, only used by process()
+    const struct design    *cur;
+    int         cur_block;      // block size of cur
+    int         out_decim;      // output decimation
+    FftBackend *inv_fft;        // inverse FFT for out_decim
+    int         fdl_len;        // spectra in the delay line
+    int         fdl_pos;        // newest spectrum in the delay line
+    int         hist_pos;       // write position in hist
+    int         unfiltered;     // samples in hist after the last block
+
+    complex_t  *hist;           // input history
+    complex_t  *fftbuf;         // FFT buffer
+    complex_t  *fdl;            // frequency domain delay line
 };
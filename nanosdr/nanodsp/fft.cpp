@@ -28,15 +28,15 @@
 #include <stdint.h>
 
 #include "common/datatypes.h"
-#include "common/ring_buffer_cplx.h"
-#include "kiss_fft.h"
+#include "common/ring_buffer_spsc_cplx.h"
+#include "fft_backend.h"
 
 #include "fft.h"
 
 
 CFft::CFft()
 {
-    fft_cfg = NULL;
+    fft = NULL;
     fft_size = 0;
     fft_window = NULL;
     fft_work_buffer = NULL;
@@ -50,10 +50,10 @@ CFft::~CFft()
 
 void CFft::free_memory()
 {
-    if (fft_cfg != NULL)
+    if (fft != NULL)
     {
-        kiss_fft_free(fft_cfg);
-        fft_cfg = NULL;
+        delete fft;
+        fft = NULL;
     }
 
     if (fft_window != NULL)
@@ -70,7 +70,7 @@ void CFft::free_memory()
 
     if (fft_input_buffer != NULL)
     {
-        ring_buffer_cplx_delete(fft_input_buffer);
+        ring_buffer_spsc_cplx_delete(fft_input_buffer);
         fft_input_buffer = NULL;
     }
 }
@@ -78,6 +78,7 @@ void CFft::free_memory()
 int CFft::init(uint32_t size)
 {
     unsigned int        i;
+    uint32_t            buflen;
 
     if ((size < FFT_MIN_SIZE) || (size > FFT_MAX_SIZE))
         return -1;
@@ -87,8 +88,8 @@ int CFft::init(uint32_t size)
     free_memory();
 
     fft_size = size;
-    fft_cfg = kiss_fft_alloc(fft_size, 0, NULL, NULL);
-    if (fft_cfg == NULL)
+    fft = FftBackend::create_best(fft_size);
+    if (fft == NULL)
         return -2;
 
     // FFT window
@@ -99,49 +100,81 @@ int CFft::init(uint32_t size)
 
     // FFT buffers
     fft_work_buffer = new complex_t[fft_size];
-    fft_input_buffer = ring_buffer_cplx_create();
+    fft_input_buffer = ring_buffer_spsc_cplx_create();
     if (fft_input_buffer == NULL)
         return -2;
-    ring_buffer_cplx_init(fft_input_buffer, fft_size);
+
+    // use at least one page so that we get a mirrored buffer
+    buflen = 4 * fft_size;
+    if (buflen * sizeof(complex_t) < mirror_buffer_page_size())
+        buflen = mirror_buffer_page_size() / sizeof(complex_t);
+    ring_buffer_spsc_cplx_init(fft_input_buffer, buflen);
+
+    // the display only needs the latest samples
+    ring_buffer_spsc_set_policy(fft_input_buffer, RB_SPSC_DROP_OLDEST, 0);
 
     return 0;
 }
 
 void CFft::add_input_samples(uint32_t num, complex_t * inbuf)
 {
-    // don't try to write more data than what the FFT buffer can hold
+    // only the last fft_size samples will ever be used
     if (num <= fft_size)
-        ring_buffer_cplx_write(fft_input_buffer, inbuf, num);
+        ring_buffer_spsc_cplx_push(fft_input_buffer, inbuf, num);
     else
-        ring_buffer_cplx_write(fft_input_buffer, &inbuf[num - fft_size],
-                               fft_size);
+        ring_buffer_spsc_cplx_push(fft_input_buffer, &inbuf[num - fft_size],
+                                   fft_size);
 }
 
 uint32_t CFft::get_output_samples(complex_t * outbuf)
 {
-    if (ring_buffer_cplx_count(fft_input_buffer) < (uint_fast32_t)fft_size)
-        return 0;
+    const complex_t    *input;
+    uint32_t            count;
+
+    for (;;)
+    {
+        count = ring_buffer_spsc_cplx_count(fft_input_buffer);
+        if (count < fft_size)
+            return 0;
+
+        // skip old data so that we use the most recent fft_size samples
+        ring_buffer_spsc_cplx_skip(fft_input_buffer, count - fft_size);
+
+        // window directly from the input buffer when the data is contiguous
+        input = ring_buffer_spsc_cplx_read_ptr(fft_input_buffer, &count);
+        if (count < fft_size)
+        {
+            ring_buffer_spsc_cplx_read(fft_input_buffer, fft_work_buffer,
+                                       fft_size);
+            window(fft_work_buffer, fft_work_buffer);
+            break;
+        }
+
+        window(input, fft_work_buffer);
+
+        // retry if the samples were overwritten while we used them
+        if (ring_buffer_spsc_cplx_read_advance(fft_input_buffer, fft_size))
+            break;
+    }
 
-    // get data and run FFT
-    ring_buffer_cplx_read(fft_input_buffer, fft_work_buffer, fft_size);
-    process(fft_work_buffer, outbuf);
+    fft->forward(fft_work_buffer, outbuf);
 
     return fft_size;
 }
 
 void CFft::process(complex_t * input, complex_t * output)
 {
-    unsigned int        i;
+    window(input, input);
+    fft->forward(input, output);
+}
 
-    const kiss_fft_cpx  *fin  = (kiss_fft_cpx *) input;
-    kiss_fft_cpx        *fout = (kiss_fft_cpx *) output;
+void CFft::window(const complex_t * input, complex_t * output)
+{
+    unsigned int        i;
 
-    // window the FFT data
     for (i = 0; i < fft_size; i++)
     {
-        input[i].re = fft_window[i] * input[i].re;
-        input[i].im = fft_window[i] * input[i].im;
+        output[i].re = fft_window[i] * input[i].re;
+        output[i].im = fft_window[i] * input[i].im;
     }
-
-    kiss_fft(fft_cfg, fin, fout);
 }
@@ -6,8 +6,8 @@
 #include <stdint.h>
 
 #include "common/datatypes.h"
-#include "common/ring_buffer_cplx.h"
-#include "kiss_fft.h"
+#include "common/ring_buffer_spsc_cplx.h"
+#include "fft_backend.h"
 
 #define FFT_MIN_SIZE    128
 #define FFT_MAX_SIZE    32768
@@ -29,6 +29,13 @@ public:
      */
     int         init(uint32_t size);
 
+    /*
+     * Add input samples to the FFT input buffer.
+     *
+     * The input buffer is a lock-free SPSC buffer, so add_input_samples() and
+     * get_output_samples() may be called from two different threads without
+     * locking. If the buffer is full, the oldest samples are dropped.
+     */
     void        add_input_samples(uint32_t num, complex_t * inbuf);
 
     /*
@@ -36,20 +43,22 @@ public:
      *
      * Returns the number of samples copied into data. This is always either
      * fft_size or 0 if there isn't sufficient data in the input_buffer to run
-     * an FFT.
+     * an FFT. The FFT is calculated on the most recent fft_size samples and
+     * any older samples are discarded.
      */
     uint32_t    get_output_samples(complex_t * outbuf);
 
     void        process(complex_t * input, complex_t * output);
 
 private:
-    kiss_fft_cfg    fft_cfg;
+    FftBackend     *fft;
     uint32_t        fft_size;
     real_t         *fft_window;
 
-    complex_t      *fft_work_buffer;
-    ring_buffer_t  *fft_input_buffer;
+    complex_t          *fft_work_buffer;
+    ring_buffer_spsc_t *fft_input_buffer;
 
     void            free_memory();
+    void            window(const complex_t * input, complex_t * output);
 };
 
@@ -0,0 +1,538 @@
+/*
+ * Common interface for the FFT engines used in nanodsp.
+ *
+ * Copyright 2019 Alexandru Csete OZ9AEC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <mutex>
+#include <new>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/datatypes.h"
+#include "common/library_loader.h"
+#include "common/time.h"
+#include "cute_fft.h"
+#include "kiss_fft.h"
+
+#include "fft_backend.h"
+
+// Time spent benchmarking each backend for a new size
+#define BENCH_TIME_US       2000
+#define BENCH_MIN_RUNS      4
+
+// Number of sizes create_best() remembers
+#define MAX_CHOICES         64
+
+// First line of the cache file. The choices are only valid for the CPU
+// features they were made with, so the CuteFft kernels are part of it.
+#define CACHE_HEADER        "# nanodsp fft backends v1"
+
+// FFTW flags and directions, see fftw3.h
+#define FFTW_FORWARD        (-1)
+#define FFTW_BACKWARD       (+1)
+#define FFTW_UNALIGNED      (1U << 1)
+#define FFTW_ESTIMATE       (1U << 6)
+
+#ifdef USE_DOUBLE
+#define FFTW_LIB            "fftw3"
+#define FFTW_SYM(s)         "fftw_" s
+#else
+#define FFTW_LIB            "fftw3f"
+#define FFTW_SYM(s)         "fftwf_" s
+#endif
+
+
+/* CuteFft has the opposite sign convention and works in place */
+class CuteBackend : public FftBackend
+{
+public:
+    CuteBackend(int size)
+    {
+        fft_size = size;
+        type = FFT_BACKEND_CUTE;
+        fft.setup(size);
+    }
+
+    void forward(const complex_t * in, complex_t * out)
+    {
+        if (in != out)
+            memcpy(out, in, fft_size * sizeof(complex_t));
+        fft.rev_fft(out);
+    }
+
+    void inverse(const complex_t * in, complex_t * out)
+    {
+        if (in != out)
+            memcpy(out, in, fft_size * sizeof(complex_t));
+        fft.fwd_fft(out);
+    }
+
+private:
+    CuteFft     fft;
+};
+
+/*
+ * kiss_fft allocates a temporary buffer for in place transforms, so those
+ * go through our own buffer instead.
+ */
+class KissBackend : public FftBackend
+{
+public:
+    KissBackend(int size)
+    {
+        fft_size = size;
+        type = FFT_BACKEND_KISS;
+        fwd_cfg = kiss_fft_alloc(size, 0, NULL, NULL);
+        inv_cfg = kiss_fft_alloc(size, 1, NULL, NULL);
+        buf = new complex_t[size];
+    }
+
+    ~KissBackend()
+    {
+        kiss_fft_free(fwd_cfg);
+        kiss_fft_free(inv_cfg);
+        delete[] buf;
+    }
+
+    bool ok(void) const
+    {
+        return fwd_cfg != NULL && inv_cfg != NULL;
+    }
+
+    void forward(const complex_t * in, complex_t * out)
+    {
+        transform(fwd_cfg, in, out);
+    }
+
+    void inverse(const complex_t * in, complex_t * out)
+    {
+        transform(inv_cfg, in, out);
+    }
+
+private:
+    void transform(kiss_fft_cfg cfg, const complex_t * in, complex_t * out)
+    {
+        if (in != out)
+        {
+            kiss_fft(cfg, (const kiss_fft_cpx *) in, (kiss_fft_cpx *) out);
+        }
+        else
+        {
+            kiss_fft(cfg, (const kiss_fft_cpx *) in, (kiss_fft_cpx *) buf);
+            memcpy(out, buf, fft_size * sizeof(complex_t));
+        }
+    }
+
+    kiss_fft_cfg    fwd_cfg;
+    kiss_fft_cfg    inv_cfg;
+    complex_t      *buf;
+};
+
+/*
+ * FFTW is loaded at runtime, so it is used when installed without being a
+ * build dependency. Only the execute functions are thread safe, so planning
+ * is done with fftw_mutex held. New-array execution must match the plan in
+ * being in place or not, so there are plans for both.
+ */
+typedef void   *fftw_plan_t;
+typedef fftw_plan_t (*fftw_plan_dft_1d_fn)(int n, complex_t * in,
+                                            complex_t * out, int sign,
+                                            unsigned int flags);
+typedef void    (*fftw_execute_dft_fn)(const fftw_plan_t p, complex_t * in,
+                                       complex_t * out);
+typedef void    (*fftw_destroy_plan_fn)(fftw_plan_t p);
+
+static std::mutex           fftw_mutex;
+static bool                 fftw_loaded;
+static fftw_plan_dft_1d_fn  fftw_plan_dft_1d;
+static fftw_execute_dft_fn  fftw_execute_dft;
+static fftw_destroy_plan_fn fftw_destroy_plan;
+
+/* Load FFTW once. The library stays loaded. Call with fftw_mutex held. */
+static bool fftw_load(void)
+{
+    lib_handle_t    lib;
+
+    if (fftw_loaded)
+        return fftw_plan_dft_1d != NULL;
+    fftw_loaded = true;
+
+    lib = load_library(FFTW_LIB);
+    if (lib == NULL)
+        lib = load_library_ver(FFTW_LIB, "3");
+    if (lib == NULL)
+        return false;
+
+    fftw_plan_dft_1d = (fftw_plan_dft_1d_fn)get_symbol(lib,
+                                                       FFTW_SYM("plan_dft_1d"));
+    fftw_execute_dft = (fftw_execute_dft_fn)get_symbol(lib,
+                                                       FFTW_SYM("execute_dft"));
+    fftw_destroy_plan = (fftw_destroy_plan_fn)get_symbol(lib,
+                                                     FFTW_SYM("destroy_plan"));
+    if (!fftw_plan_dft_1d || !fftw_execute_dft || !fftw_destroy_plan)
+    {
+        fprintf(stderr, "Incompatible %s library\n", FFTW_LIB);
+        fftw_plan_dft_1d = NULL;
+        close_library(lib);
+        return false;
+    }
+
+    return true;
+}
+
+class FftwBackend : public FftBackend
+{
+public:
+    FftwBackend(int size)
+    {
+        std::lock_guard<std::mutex> lock(fftw_mutex);
+        complex_t  *in, *out;
+        int         i;
+
+        fft_size = size;
+        type = FFT_BACKEND_FFTW;
+        for (i = 0; i < 4; i++)
+            plans[i] = NULL;
+        if (!fftw_load())
+            return;
+
+        // planning with FFTW_ESTIMATE does not touch the arrays
+        in = new complex_t[size];
+        out = new complex_t[size];
+        plans[0] = fftw_plan_dft_1d(size, in, out, FFTW_FORWARD,
+                                    FFTW_ESTIMATE | FFTW_UNALIGNED);
+        plans[1] = fftw_plan_dft_1d(size, in, in, FFTW_FORWARD,
+                                    FFTW_ESTIMATE | FFTW_UNALIGNED);
+        plans[2] = fftw_plan_dft_1d(size, in, out, FFTW_BACKWARD,
+                                    FFTW_ESTIMATE | FFTW_UNALIGNED);
+        plans[3] = fftw_plan_dft_1d(size, in, in, FFTW_BACKWARD,
+                                    FFTW_ESTIMATE | FFTW_UNALIGNED);
+        delete[] in;
+        delete[] out;
+    }
+
+    ~FftwBackend()
+    {
+        std::lock_guard<std::mutex> lock(fftw_mutex);
+        int     i;
+
+        for (i = 0; i < 4; i++)
+            if (plans[i])
+                fftw_destroy_plan(plans[i]);
+    }
+
+    bool ok(void) const
+    {
+        return plans[0] && plans[1] && plans[2] && plans[3];
+    }
+
+    void forward(const complex_t * in, complex_t * out)
+    {
+        fftw_execute_dft(plans[in == out], (complex_t *) in, out);
+    }
+
+    void inverse(const complex_t * in, complex_t * out)
+    {
+        fftw_execute_dft(plans[2 + (in == out)], (complex_t *) in, out);
+    }
+
+private:
+    fftw_plan_t     plans[4];   // forward, forward in place, inverse, ...
+};
+
+
+const char *FftBackend::type_name(int type)
+{
+    static const char  *names[FFT_BACKEND_NUM] = { "cute", "kiss", "fftw" };
+
+    if (type < 0 || type >= FFT_BACKEND_NUM)
+        return "unknown";
+
+    return names[type];
+}
+
+FftBackend *FftBackend::create(int type, int size)
+{
+    if (size < 1)
+        return NULL;
+
+    switch (type)
+    {
+    case FFT_BACKEND_CUTE:
+        if (!CuteFft::valid_size(size))
+            return NULL;
+        return new CuteBackend(size);
+
+    case FFT_BACKEND_KISS:
+    {
+        // kiss_fft is built for float only
+        if (sizeof(kiss_fft_cpx) != sizeof(complex_t))
+            return NULL;
+
+        KissBackend *kiss = new KissBackend(size);
+        if (kiss->ok())
+            return kiss;
+        delete kiss;
+        return NULL;
+    }
+
+    case FFT_BACKEND_FFTW:
+    {
+        FftwBackend *fftw = new FftwBackend(size);
+        if (fftw->ok())
+            return fftw;
+        delete fftw;
+        return NULL;
+    }
+
+    default:
+        return NULL;
+    }
+}
+
+
+/*
+ * Choices made by create_best(). The table is loaded from the cache file
+ * the first time it is needed and saved after each new choice.
+ */
+struct choice
+{
+    int     size;
+    int     type;
+};
+
+static std::mutex       choice_mutex;
+static struct choice    choices[MAX_CHOICES];
+static int              num_choices;
+static bool             cache_loaded;
+static char            *cache_file;
+
+static struct choice *find_choice(int size)
+{
+    int     i;
+
+    for (i = 0; i < num_choices; i++)
+        if (choices[i].size == size)
+            return &choices[i];
+
+    return NULL;
+}
+
+/* Header of the cache file for this host */
+static void cache_header(char * buf, size_t len)
+{
+    CuteFft     fft;
+
+    snprintf(buf, len, "%s %s %d\n", CACHE_HEADER, fft.simd_name(),
+             (int)sizeof(real_t));
+}
+
+static void load_choices(void)
+{
+    FILE   *file;
+    char    header[128];
+    char    line[128];
+    char    name[32];
+    int     size, type;
+
+    cache_loaded = true;
+    if (cache_file == NULL)
+        return;
+
+    file = fopen(cache_file, "r");
+    if (file == NULL)
+        return;
+
+    // choices made on another CPU or for another precision are dropped
+    cache_header(header, sizeof(header));
+    if (fgets(line, sizeof(line), file) == NULL || strcmp(line, header))
+    {
+        fclose(file);
+        return;
+    }
+
+    while (num_choices < MAX_CHOICES && fgets(line, sizeof(line), file))
+    {
+        if (sscanf(line, "%d %31s", &size, name) != 2 || find_choice(size))
+            continue;
+        for (type = 0; type < FFT_BACKEND_NUM; type++)
+        {
+            if (strcmp(name, FftBackend::type_name(type)) == 0)
+            {
+                choices[num_choices].size = size;
+                choices[num_choices].type = type;
+                num_choices++;
+                break;
+            }
+        }
+    }
+
+    fclose(file);
+}
+
+static void save_choices(void)
+{
+    FILE   *file;
+    char    header[128];
+    int     i;
+
+    if (cache_file == NULL)
+        return;
+
+    file = fopen(cache_file, "w");
+    if (file == NULL)
+    {
+        fprintf(stderr, "Can not write FFT cache file %s\n", cache_file);
+        return;
+    }
+
+    cache_header(header, sizeof(header));
+    fputs(header, file);
+    for (i = 0; i < num_choices; i++)
+        fprintf(file, "%d %s\n", choices[i].size,
+                FftBackend::type_name(choices[i].type));
+
+    fclose(file);
+}
+
+/* Time per forward and inverse transform pair in us */
+static double bench(FftBackend * fft)
+{
+    complex_t  *buf;
+    uint64_t    start, now;
+    int         size = fft->get_size();
+    int         i, runs = 0;
+
+    buf = new complex_t[size];
+    for (i = 0; i < size; i++)
+    {
+        buf[i].re = (real_t)rand() / RAND_MAX - 0.5;
+        buf[i].im = (real_t)rand() / RAND_MAX - 0.5;
+    }
+
+    // warm up the caches, then scale back after each pair
+    fft->forward(buf, buf);
+    fft->inverse(buf, buf);
+    start = time_us();
+    do
+    {
+        fft->forward(buf, buf);
+        fft->inverse(buf, buf);
+        for (i = 0; i < size; i++)
+        {
+            buf[i].re *= 1.0 / size;
+            buf[i].im *= 1.0 / size;
+        }
+        runs++;
+        now = time_us();
+    } while (runs < BENCH_MIN_RUNS || now - start < BENCH_TIME_US);
+
+    delete[] buf;
+
+    return (double)(now - start) / runs;
+}
+
+/* Find the fastest backend for size. Call with choice_mutex held. */
+static int choose(int size)
+{
+    FftBackend *fft;
+    double      t, best_time = 0.0;
+    int         type, best = -1;
+
+    for (type = 0; type < FFT_BACKEND_NUM; type++)
+    {
+        fft = FftBackend::create(type, size);
+        if (fft == NULL)
+            continue;
+
+        t = bench(fft);
+        delete fft;
+        if (best < 0 || t < best_time)
+        {
+            best = type;
+            best_time = t;
+        }
+    }
+
+    if (best >= 0)
+        fprintf(stderr, "FFT size %d: using %s (%.1f us)\n", size,
+                FftBackend::type_name(best), best_time);
+
+    return best;
+}
+
+FftBackend *FftBackend::create_best(int size)
+{
+    std::lock_guard<std::mutex> lock(choice_mutex);
+    struct choice  *c;
+    FftBackend     *fft;
+
+    if (!cache_loaded)
+        load_choices();
+
+    // the backend may have been removed since the choice was made
+    c = find_choice(size);
+    if (c)
+    {
+        fft = create(c->type, size);
+        if (fft)
+            return fft;
+    }
+    else
+    {
+        if (num_choices == MAX_CHOICES)
+        {
+            // forget the oldest choice
+            num_choices--;
+            memmove(choices, choices + 1, num_choices * sizeof(choices[0]));
+        }
+        c = &choices[num_choices++];
+        c->size = size;
+    }
+
+    c->type = choose(size);
+    if (c->type < 0)
+    {
+        // nothing supports the size, not worth keeping
+        *c = choices[--num_choices];
+        return NULL;
+    }
+    save_choices();
+
+    return create(c->type, size);
+}
+
+void FftBackend::set_cache_file(const char * path)
+{
+    std::lock_guard<std::mutex> lock(choice_mutex);
+
+    free(cache_file);
+    cache_file = path ? strdup(path) : NULL;
+
+    // choices made so far are kept and the file is read on the next miss
+    cache_loaded = false;
+}
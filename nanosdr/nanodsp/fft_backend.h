@@ -0,0 +1,73 @@
+/*
+ * Common interface for the FFT engines used in nanodsp.
+ */
+#pragma once
+
+#include "common/datatypes.h"
+
+// Backend types, also the order in which they are tried
+#define FFT_BACKEND_CUTE    0
+#define FFT_BACKEND_KISS    1
+#define FFT_BACKEND_FFTW    2   // loaded at runtime if installed
+#define FFT_BACKEND_NUM     3
+
+/*
+ * Complex FFT of a fixed size. forward() computes the unscaled transform
+ *
+ *   X[k] = sum x[n] * exp(-j * 2 * pi * n * k / N)
+ *
+ * and inverse() the same with exp(+j ...), so inverse(forward(x)) is N * x.
+ * in and out may be the same buffer. Neither allocates memory, so they can
+ * be used in the DSP threads.
+ */
+class FftBackend
+{
+public:
+    virtual ~FftBackend() {}
+
+    virtual void        forward(const complex_t * in, complex_t * out) = 0;
+    virtual void        inverse(const complex_t * in, complex_t * out) = 0;
+
+    int                 get_size(void) const
+    {
+        return fft_size;
+    }
+
+    int                 get_type(void) const
+    {
+        return type;
+    }
+
+    static const char  *type_name(int type);
+
+    /*
+     * Create a backend of the given type for size points.
+     *
+     * Returns NULL if the backend is not available or does not support the
+     * size, e.g. CuteFft only supports the sizes in CuteFft::valid_size().
+     */
+    static FftBackend  *create(int type, int size);
+
+    /*
+     * Create the fastest available backend for size points.
+     *
+     * The first time a size is requested, each backend is timed on a few
+     * transforms of that size and the fastest one is remembered. The
+     * choices are saved in the cache file, if one is set, and loaded from
+     * it the next time, so the benchmark only runs once per host. May be
+     * called from any thread.
+     *
+     * Returns NULL if no backend supports size.
+     */
+    static FftBackend  *create_best(int size);
+
+    /*
+     * Set the file used to keep the choices of create_best() between runs.
+     * NULL disables the cache file.
+     */
+    static void         set_cache_file(const char * path);
+
+protected:
+    int         fft_size;
+    int         type;
+};
@@ -0,0 +1,325 @@
+/*
+ * Decimate by an integer factor using a CIC filter.
+ *
+ * Copyright 2019 Alexandru Csete OZ9AEC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <math.h>
+
+#if defined(__SSE2__) && !defined(USE_DOUBLE)
+#include <emmintrin.h>
+#define CIC_SSE2
+#elif defined(__ARM_NEON) && !defined(USE_DOUBLE)
+#include <arm_neon.h>
+#define CIC_NEON
+#endif
+
+#include "cic_decim.h"
+
+
+CicDecimator::CicDecimator()
+{
+    decim = 0;
+    stages = 0;
+    count = 0;
+    out_scale = 0.0;
+}
+
+CicDecimator::~CicDecimator()
+{
+}
+
+int CicDecimator::growth(int R, int N)
+{
+    return (int)ceil(N * log2((double)R) - 1.e-9);
+}
+
+double CicDecimator::response(int R, int N, double f)
+{
+    double      num, den;
+
+    den = R * sin(K_PI * f / R);
+    if (fabs(den) < 1.e-12)
+        return 1.0;
+
+    num = sin(K_PI * f);
+
+    return fabs(pow(num / den, N));
+}
+
+/*
+ * The worst alias comes from around the first null of the response, at
+ * 1 - bw relative to the output rate.
+ */
+int CicDecimator::min_order(int R, double bw, double att)
+{
+    double      rej;
+    int         N;
+
+    if (R < 2 || bw <= 0.0 || bw >= 0.5)
+        return 0;
+
+    rej = -20.0 * log10(response(R, 1, 1.0 - bw));
+    for (N = 1; N <= CIC_MAX_ORDER; N++)
+    {
+        if (growth(R, N) > CIC_MAX_GROWTH)
+            break;
+        if (N * rej >= att)
+            return N;
+    }
+
+    return 0;
+}
+
+int CicDecimator::init(int R, int N)
+{
+    int     bits;
+
+    if (R < 2 || N < 1 || N > CIC_MAX_ORDER)
+        return 0;
+
+    bits = growth(R, N);
+    if (bits > CIC_MAX_GROWTH)
+        return 0;
+
+    decim = R;
+    stages = N;
+    out_scale = 1.0 / (ldexp(1.0, CIC_INPUT_BITS) * pow((double)R, N));
+    reset();
+
+    return decim;
+}
+
+void CicDecimator::reset(void)
+{
+    int     i;
+
+    for (i = 0; i < 2 * CIC_MAX_ORDER; i++)
+    {
+        integ[i] = 0;
+        comb[i] = 0;
+    }
+    count = 0;
+}
+
+/*
+ * Output n is written after input n * R has been read, so decimation can be
+ * done in place.
+ */
+template <int N>
+int CicDecimator::process_n(int num, const complex_t * input,
+                            complex_t * output)
+{
+    int         i, k, end;
+    int         n = 0;
+
+#if defined(CIC_SSE2)
+    const __m128    scale = _mm_set1_ps(1 << CIC_INPUT_BITS);
+    __m128i     in_reg[N], comb_reg[N];
+    __m128i     acc, tmp, sign;
+    int64_t     val[2];
+
+    for (k = 0; k < N; k++)
+    {
+        in_reg[k] = _mm_loadu_si128((const __m128i *)&integ[2 * k]);
+        comb_reg[k] = _mm_loadu_si128((const __m128i *)&comb[2 * k]);
+    }
+
+    for (i = 0; i < num; )
+    {
+        end = i + decim - count < num ? i + decim - count : num;
+        count += end - i;
+        // I and Q to 32 bit integers, sign extended to 64 bits, two samples
+        // at a time
+        for (; i + 1 < end; i += 2)
+        {
+            acc = _mm_cvttps_epi32(_mm_mul_ps(
+                        _mm_loadu_ps((const float *)&input[i]), scale));
+            sign = _mm_srai_epi32(acc, 31);
+            tmp = _mm_unpackhi_epi32(acc, sign);
+            acc = _mm_unpacklo_epi32(acc, sign);
+
+            for (k = 0; k < N; k++)
+                in_reg[k] = _mm_add_epi64(in_reg[k], k ? in_reg[k - 1] : acc);
+            for (k = 0; k < N; k++)
+                in_reg[k] = _mm_add_epi64(in_reg[k], k ? in_reg[k - 1] : tmp);
+        }
+        if (i < end)
+        {
+            acc = _mm_cvttps_epi32(_mm_mul_ps(_mm_castpd_ps(
+                        _mm_load_sd((const double *)&input[i])), scale));
+            acc = _mm_unpacklo_epi32(acc, _mm_srai_epi32(acc, 31));
+
+            for (k = 0; k < N; k++)
+                in_reg[k] = _mm_add_epi64(in_reg[k], k ? in_reg[k - 1] : acc);
+            i++;
+        }
+
+        if (count < decim)
+            break;
+        count = 0;
+
+        acc = in_reg[N - 1];
+
+        for (k = 0; k < N; k++)
+        {
+            tmp = acc;
+            acc = _mm_sub_epi64(acc, comb_reg[k]);
+            comb_reg[k] = tmp;
+        }
+        _mm_storeu_si128((__m128i *)val, acc);
+        output[n].re = val[0] * out_scale;
+        output[n].im = val[1] * out_scale;
+        n++;
+    }
+
+    for (k = 0; k < N; k++)
+    {
+        _mm_storeu_si128((__m128i *)&integ[2 * k], in_reg[k]);
+        _mm_storeu_si128((__m128i *)&comb[2 * k], comb_reg[k]);
+    }
+#elif defined(CIC_NEON)
+    int64x2_t   in_reg[N], comb_reg[N];
+    int64x2_t   acc, tmp;
+    int32x4_t   both;
+
+    for (k = 0; k < N; k++)
+    {
+        in_reg[k] = vld1q_s64((const int64_t *)&integ[2 * k]);
+        comb_reg[k] = vld1q_s64((const int64_t *)&comb[2 * k]);
+    }
+
+    for (i = 0; i < num; )
+    {
+        end = i + decim - count < num ? i + decim - count : num;
+        count += end - i;
+        for (; i + 1 < end; i += 2)
+        {
+            both = vcvtq_s32_f32(vmulq_n_f32(vld1q_f32(
+                        (const float *)&input[i]), 1 << CIC_INPUT_BITS));
+            acc = vmovl_s32(vget_low_s32(both));
+            tmp = vmovl_s32(vget_high_s32(both));
+
+            for (k = 0; k < N; k++)
+                in_reg[k] = vaddq_s64(in_reg[k], k ? in_reg[k - 1] : acc);
+            for (k = 0; k < N; k++)
+                in_reg[k] = vaddq_s64(in_reg[k], k ? in_reg[k - 1] : tmp);
+        }
+        if (i < end)
+        {
+            acc = vmovl_s32(vcvt_s32_f32(vmul_n_f32(vld1_f32(
+                        (const float *)&input[i]), 1 << CIC_INPUT_BITS)));
+
+            for (k = 0; k < N; k++)
+                in_reg[k] = vaddq_s64(in_reg[k], k ? in_reg[k - 1] : acc);
+            i++;
+        }
+
+        if (count < decim)
+            break;
+        count = 0;
+
+        acc = in_reg[N - 1];
+
+        for (k = 0; k < N; k++)
+        {
+            tmp = acc;
+            acc = vsubq_s64(acc, comb_reg[k]);
+            comb_reg[k] = tmp;
+        }
+        output[n].re = vgetq_lane_s64(acc, 0) * out_scale;
+        output[n].im = vgetq_lane_s64(acc, 1) * out_scale;
+        n++;
+    }
+
+    for (k = 0; k < N; k++)
+    {
+        vst1q_s64((int64_t *)&integ[2 * k], in_reg[k]);
+        vst1q_s64((int64_t *)&comb[2 * k], comb_reg[k]);
+    }
+#else
+    const real_t    scale = 1 << CIC_INPUT_BITS;
+    uint64_t    acc_re, acc_im, tmp;
+
+    for (i = 0; i < num; )
+    {
+        end = i + decim - count < num ? i + decim - count : num;
+        count += end - i;
+        for (; i < end; i++)
+        {
+            acc_re = (uint64_t)(int64_t)(int32_t)(input[i].re * scale);
+            acc_im = (uint64_t)(int64_t)(int32_t)(input[i].im * scale);
+            for (k = 0; k < 2 * N; k += 2)
+            {
+                acc_re = integ[k] += acc_re;
+                acc_im = integ[k + 1] += acc_im;
+            }
+        }
+
+        if (count < decim)
+            break;
+        count = 0;
+
+        acc_re = integ[2 * N - 2];
+        acc_im = integ[2 * N - 1];
+        for (k = 0; k < 2 * N; k += 2)
+        {
+            tmp = acc_re;
+            acc_re -= comb[k];
+            comb[k] = tmp;
+            tmp = acc_im;
+            acc_im -= comb[k + 1];
+            comb[k + 1] = tmp;
+        }
+        output[n].re = (int64_t)acc_re * out_scale;
+        output[n].im = (int64_t)acc_im * out_scale;
+        n++;
+    }
+#endif
+
+    return n;
+}
+
+int CicDecimator::process(int num, const complex_t * input,
+                          complex_t * output)
+{
+    switch (stages)
+    {
+    case 1:
+        return process_n<1>(num, input, output);
+    case 2:
+        return process_n<2>(num, input, output);
+    case 3:
+        return process_n<3>(num, input, output);
+    case 4:
+        return process_n<4>(num, input, output);
+    case 5:
+        return process_n<5>(num, input, output);
+    case 6:
+        return process_n<6>(num, input, output);
+    default:
+        return 0;
+    }
+}
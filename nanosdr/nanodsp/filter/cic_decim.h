@@ -0,0 +1,101 @@
+/*
+ * Decimate by an integer factor using a CIC filter.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "common/datatypes.h"
+
+#define CIC_MAX_ORDER       6
+
+// The input is converted to 32 bit integers with CIC_INPUT_BITS of fraction,
+// the registers are 64 bits wide. One bit is the sign.
+#define CIC_HEADROOM_BITS   4       // input amplitudes up to 16 are allowed
+#define CIC_INPUT_BITS      24
+#define CIC_MAX_GROWTH      (63 - CIC_HEADROOM_BITS - CIC_INPUT_BITS)
+
+/*
+ * Cascaded integrator-comb decimator with N stages and differential delay 1.
+ *
+ * The input is converted to fixed point and the integrators and combs use 64
+ * bit wrap around arithmetic, so the filter needs no multiplications and the
+ * integrators do not drift like they would in floating point. The gain R^N
+ * is removed when the output is converted back. The I and Q registers are
+ * updated together in one SIMD register when available.
+ *
+ * The pass band droops like sinc^N, which is corrected by the following
+ * FIR stage, see FirDecimator::init().
+ */
+class CicDecimator
+{
+public:
+    CicDecimator();
+    virtual    ~CicDecimator();
+
+    /*
+     * Initialize the decimator.
+     *
+     * Parameters:
+     *   R          The decimation.
+     *   N          The number of integrator and comb stages.
+     *
+     * Returns the decimation or 0 if the register growth is too large.
+     */
+    int         init(int R, int N);
+
+    /* Clear the integrators and combs. */
+    void        reset(void);
+
+    /*
+     * Decimate num samples from input into output, which may be the same
+     * buffer. Output must have space for num / R + 1 samples.
+     *
+     * Returns the number of output samples.
+     */
+    int         process(int num, const complex_t * input, complex_t * output);
+
+    int         factor(void) const
+    {
+        return decim;
+    }
+
+    int         order(void) const
+    {
+        return stages;
+    }
+
+    size_t      memory(void) const
+    {
+        return sizeof(*this);
+    }
+
+    /* Number of bits the registers grow by for the given R and N. */
+    static int      growth(int R, int N);
+
+    /* Normalized magnitude response at f relative to the output rate. */
+    static double   response(int R, int N, double f);
+
+    /*
+     * Lowest order that keeps the aliases within bw of the output pass band,
+     * relative to the output rate, att dB down.
+     *
+     * Returns 0 if there is no such order.
+     */
+    static int      min_order(int R, double bw, double att);
+
+private:
+    template <int N>
+    int         process_n(int num, const complex_t * input,
+                          complex_t * output);
+
+    int         decim;
+    int         stages;
+    int         count;          // input samples since the last output
+    double      out_scale;
+
+    // I and Q registers interleaved
+    uint64_t    integ[2 * CIC_MAX_ORDER];
+    uint64_t    comb[2 * CIC_MAX_ORDER];
+};
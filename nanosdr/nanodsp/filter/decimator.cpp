@@ -1,5 +1,5 @@
 /*
- * Decimate by power-of-2 using half band filters.
+ * Decimate using a chain of half band and FIR filters.
  * Origin: CuteSdr.
  *
  * Copyright 2010  Moe Wheatley AE4JY
@@ -30,373 +30,716 @@
  *
  */
 #include <stdio.h>
+#include <string.h>
 
-#include "common/bithacks.h"
 #include "common/datatypes.h"
 #include "decimator.h"
 #include "filtercoef_hbf_70.h"
 #include "filtercoef_hbf_100.h"
 #include "filtercoef_hbf_140.h"
+#include "half_band.h"
+
+typedef HalfBandDecimateBy2<HBF_70_11_LENGTH, HBF_70_11>    hbf_70_11_t;
+typedef HalfBandDecimateBy2<HBF_70_39_LENGTH, HBF_70_39>    hbf_70_39_t;
+typedef HalfBandDecimateBy2<HBF_100_11_LENGTH, HBF_100_11>  hbf_100_11_t;
+typedef HalfBandDecimateBy2<HBF_100_19_LENGTH, HBF_100_19>  hbf_100_19_t;
+typedef HalfBandDecimateBy2<HBF_100_59_LENGTH, HBF_100_59>  hbf_100_59_t;
+typedef HalfBandDecimateBy2<HBF_140_11_LENGTH, HBF_140_11>  hbf_140_11_t;
+typedef HalfBandDecimateBy2<HBF_140_15_LENGTH, HBF_140_15>  hbf_140_15_t;
+typedef HalfBandDecimateBy2<HBF_140_27_LENGTH, HBF_140_27>  hbf_140_27_t;
+typedef HalfBandDecimateBy2<HBF_140_87_LENGTH, HBF_140_87>  hbf_140_87_t;
 
-#define MAX_HALF_BAND_BUFSIZE 32768
+/*
+ * List of stages run one after the other. The calls are resolved at compile
+ * time so the stage kernels can be inlined into a single function per chain.
+ */
+template <class... Stages>
+class StageList;
 
-Decimator::Decimator()
+template <>
+class StageList<>
 {
-    int         i;
+public:
+    int     process(int num, complex_t *)
+    {
+        return num;
+    }
 
-    decim = 0;
-    atten = 0;
+    void    reset()
+    {
+    }
 
-    for (i = 0; i < MAX_STAGES; i++)
-        filter_table[i] = 0;
-}
+    int     get_stats(struct Decimator::stage_stats *) const
+    {
+        return 0;
+    }
 
-Decimator::~Decimator()
+    size_t  memory() const
+    {
+        return 0;
+    }
+};
+
+template <class Stage, class... Stages>
+class StageList<Stage, Stages...>
 {
-    delete_filters();
-}
+public:
+    int     process(int num, complex_t * samples)
+    {
+        return next.process(stage.DecBy2(num, samples, samples), samples);
+    }
+
+    void    reset()
+    {
+        stage.reset();
+        next.reset();
+    }
+
+    int     get_stats(struct Decimator::stage_stats * stats) const
+    {
+        stats->taps = stage.taps();
+        stats->memory = stage.memory();
+        return 1 + next.get_stats(stats + 1);
+    }
+
+    size_t  memory() const
+    {
+        return stage.memory() + next.memory();
+    }
 
-unsigned int Decimator::init(unsigned int _decim, unsigned int _att)
+private:
+    Stage                   stage;
+    StageList<Stages...>    next;
+};
+
+template <class First, class... Stages>
+class ChainImpl : public Decimator::Chain
 {
-    if (_decim == decim && _att == atten)
-        return _decim;
+public:
+    int     first(int num, const complex_t * input, complex_t * output)
+    {
+        return first_stage.DecBy2(num, input, output);
+    }
 
-    if (_decim < 2 || _decim > MAX_DECIMATION || !is_power_of_two(_decim))
-        return 1;
+    int     rest(int num, complex_t * samples)
+    {
+        return stages.process(num, samples);
+    }
 
-    delete_filters();
+    void    reset()
+    {
+        first_stage.reset();
+        stages.reset();
+    }
 
-    atten = _att;
+    int     get_stats(struct Decimator::stage_stats * stats) const
+    {
+        stats->taps = first_stage.taps();
+        stats->memory = first_stage.memory();
+        return 1 + stages.get_stats(stats + 1);
+    }
 
-    if (atten <= 70)
+    size_t  memory() const
     {
-        decim = init_filters_70(_decim);
+        return first_stage.memory() + stages.memory();
     }
-    else if (atten <= 100)
+
+private:
+    First                   first_stage;
+    StageList<Stages...>    stages;
+};
+
+/*
+ * Create the chain consisting of n instances of Stage followed by Tail.
+ * N is the largest n supported.
+ */
+template <int N, class Stage, class... Tail>
+struct repeat_chain
+{
+    static Decimator::Chain *create(int n)
     {
-        decim = init_filters_100(_decim);
+        if (n == N)
+            return repeat_chain<N - 1, Stage, Stage, Tail...>::create(n - 1);
+
+        return repeat_chain<N - 1, Stage, Tail...>::create(n);
     }
-    else
+};
+
+template <class Stage, class... Tail>
+struct repeat_chain<0, Stage, Tail...>
+{
+    static Decimator::Chain *create(int n)
     {
-        decim = init_filters_140(_decim);
+        return n == 0 ? new ChainImpl<Tail...> : 0;
     }
+};
 
-    return decim;
+// alias free bandwidth relative to the output rate
+#define PASSBAND        0.4
+
+static unsigned int gcd(unsigned int a, unsigned int b)
+{
+    unsigned int    t;
+
+    while (b)
+    {
+        t = a % b;
+        a = b;
+        b = t;
+    }
+
+    return a;
 }
 
-int Decimator::process(int num, complex_t * samples)
+Decimator::Decimator()
+{
+    decim = 0;
+    interp = 1;
+    atten = 0;
+    chain = 0;
+    fir = 0;
+    cic = 0;
+    fir_first = false;
+    cur_plan.decim = 0;
+    cur_plan.interp = 1;
+    cur_plan.num_stages = 0;
+    cur_plan.cost = 0.0;
+}
+
+Decimator::~Decimator()
 {
-    int         i = 0;
-    int         n = num;
+    delete_filters();
+}
 
-    while(filter_table[i])
-        n = filter_table[i++]->DecBy2(n, samples, samples);
+unsigned int Decimator::init(unsigned int _decim, unsigned int _att,
+                             real_t _rate)
+{
+    if (_decim == decim && interp == 1 && _att == atten)
+        return _decim;
 
-    return n;
+    if (_decim < 2 || _decim > MAX_DECIMATION)
+        return 1;
+
+    if (!make_plan(_decim, _att, &cur_plan))
+        return 1;
+
+    build(_att, _rate);
+
+    return decim;
 }
 
-void Decimator::delete_filters()
+real_t Decimator::init_rate(real_t in_rate, real_t out_rate,
+                            unsigned int _att)
 {
-    int         i;
+    unsigned int    a, b, g;
 
-    for(i = 0; i < MAX_STAGES; i++)
+    a = lrint(in_rate);
+    b = lrint(out_rate);
+    if (b > 0 && a > b)
     {
-        if (filter_table[i])
+        g = gcd(a, b);
+        a /= g;
+        b /= g;
+        if (a == decim && b == interp && _att == atten)
+            return in_rate * interp / decim;
+
+        if (a <= MAX_DECIMATION * b && make_plan(a, b, _att, &cur_plan))
         {
-            delete filter_table[i];
-            filter_table[i] = 0;
+            build(_att, in_rate);
+            return in_rate * interp / decim;
+        }
+
+        // fall back to the integer decimation closest to the requested rate
+        a /= b;
+        if (a >= 2 && a <= MAX_DECIMATION && make_plan(a, _att, &cur_plan))
+        {
+            build(_att, in_rate);
+            return in_rate / decim;
         }
     }
+
+    // pass through
+    delete_filters();
+    decim = 1;
+    interp = 1;
+    atten = _att;
+    cur_plan.decim = 1;
+    cur_plan.interp = 1;
+    cur_plan.num_stages = 0;
+    cur_plan.cost = 0.0;
+
+    return in_rate;
 }
 
-int Decimator::init_filters_70(unsigned int decimation)
+void Decimator::build(unsigned int _att, real_t _rate)
 {
-    int         n = 0;
+    const struct stage_plan *stage;
+    real_t      fpass, fstop;
+    real_t      rest;
+    int         num_hbf = 0;
+    int         i;
+
+    delete_filters();
+
+    decim = cur_plan.decim;
+    interp = cur_plan.interp;
+    atten = _att;
+    rest = (real_t)decim / interp;
 
-    while (decimation >= 2)
+    // the FIR is first unless it comes after the half band stages
+    fir_first = true;
+    for (i = 0; i < cur_plan.num_stages; i++)
     {
-/*     7-tap filters are not quite sufficient
-        if (decimation >= 8)
+        if (cur_plan.stages[i].type == STAGE_HBF)
+            num_hbf++;
+        else if (cur_plan.stages[i].type == STAGE_FIR)
+            fir_first = (num_hbf == 0);
+    }
+
+    for (i = 0; i < cur_plan.num_stages; i++)
+    {
+        stage = &cur_plan.stages[i];
+        if (stage->type == STAGE_CIC)
         {
-            filter_table[n++] = new CHalfBandDecimateBy2(HBF_70_7_LENGTH, HBF_70_7);
-            fprintf(stderr, "  DEC %d: HBF_70_7\n", n);
+            cic = new CicDecimator();
+            cic->init(stage->decim, stage->taps);
+            rest /= stage->decim;
         }
-        else
-*/
-        if (decimation >= 4)
+        else if (stage->type == STAGE_FIR && stage->interp > 1)
         {
-            filter_table[n++] = new CHalfBand11TapDecimateBy2(HBF_70_11);
-            fprintf(stderr, "  DEC %d: HBF_70_11 (unrolled)\n", n);
+            fir_spec(rest, (real_t)stage->decim / stage->interp, false,
+                     &fpass, &fstop);
+            fir = new FirDecimator();
+            fir->init_rational(stage->interp, stage->decim, fpass, fstop,
+                               atten);
         }
-        else if (decimation == 2)
+        else if (stage->type == STAGE_FIR)
         {
-            filter_table[n++] = new CHalfBandDecimateBy2(HBF_70_39_LENGTH, HBF_70_39);
-            fprintf(stderr, "  DEC %d: HBF_70_39\n", n);
+            fir_spec(rest, stage->decim, fir_first, &fpass, &fstop);
+            fir = new FirDecimator();
+            if (cic)
+                fir->init(stage->decim, fpass, fstop, atten, cic->factor(),
+                          cic->order());
+            else
+                fir->init(stage->decim, fpass, fstop, atten);
         }
+    }
+
+    if (num_hbf > 0)
+        chain = create_chain(cur_plan.att, num_hbf);
+
+    print_plan(&cur_plan, _rate);
+    fprintf(stderr, "  Decimator memory: %zu bytes\n", memory_usage());
+}
 
-        decimation /= 2;
+/*
+ * The stages run in the order CIC, FIR if fir_first, half band chain and
+ * FIR if not fir_first, skipping the ones that are not used.
+ */
+int Decimator::first_stage(int num, const complex_t * input,
+                           complex_t * output)
+{
+    if (cic)
+        return cic->process(num, input, output);
+
+    if (fir && fir_first)
+        return fir->process(num, input, output);
+
+    return chain->first(num, input, output);
+}
+
+int Decimator::other_stages(int num, complex_t * samples)
+{
+    if (cic && fir && fir_first)
+        num = fir->process(num, samples, samples);
+
+    if (chain)
+    {
+        if (cic || (fir && fir_first))
+            num = chain->first(num, samples, samples);
+        num = chain->rest(num, samples);
+    }
+
+    if (fir && !fir_first)
+        num = fir->process(num, samples, samples);
+
+    return num;
+}
+
+int Decimator::process(int num, complex_t * samples)
+{
+    if (!chain && !fir && !cic)
+        return num;
+
+    return other_stages(first_stage(num, samples, samples), samples);
+}
+
+int Decimator::process(int num, const complex_t * input, complex_t * output)
+{
+    if (!chain && !fir && !cic)
+    {
+        if (output != input)
+            memmove(output, input, num * sizeof(complex_t));
+        return num;
     }
 
-    return (1 << n);
+    // first stage reads from input, the rest run in place on output
+    return other_stages(first_stage(num, input, output), output);
 }
 
-int Decimator::init_filters_100(unsigned int decimation)
+int Decimator::process(int num, const complex_t * input, complex_t * output,
+                       Translate &nco)
 {
     int         n = 0;
+    int         chunk;
 
-    while (decimation >= 2)
+    if (!chain && !fir && !cic)
     {
-/*   7-tap filters are not quite sufficient
-        if (decimation >= 16)
-        {
-            filter_table[n++] = new CHalfBandDecimateBy2(HBF_100_7_LENGTH, HBF_100_7);
-            fprintf(stderr, "  DEC %d: HBF_100_7\n", n);
-        }
-        else
-*/
-        if (decimation >= 8)
-        {
-            filter_table[n++] = new CHalfBand11TapDecimateBy2(HBF_100_11);
-            fprintf(stderr, "  DEC %d: HBF_100_11 (unrolled)\n", n);
-        }
-        else if (decimation == 4)
-        {
-            filter_table[n++] = new CHalfBandDecimateBy2(HBF_100_19_LENGTH, HBF_100_19);
-            fprintf(stderr, "  DEC %d: HBF_100_19\n", n);
-        }
-        else if (decimation == 2)
-        {
-            filter_table[n++] = new CHalfBandDecimateBy2(HBF_100_59_LENGTH, HBF_100_59);
-            fprintf(stderr, "  DEC %d: HBF_100_59\n", n);
-        }
+        nco.process(num, input, output);
+        return num;
+    }
 
-        decimation /= 2;
+    // the last chunk takes the remainder to keep it at least MIX_CHUNK long
+    while (num > 0)
+    {
+        chunk = num < 2 * MIX_CHUNK ? num : MIX_CHUNK;
+        nco.process(chunk, input, mix_buf);
+        n += first_stage(chunk, mix_buf, &output[n]);
+        input += chunk;
+        num -= chunk;
     }
-    
-    return (1 << n);
+
+    return other_stages(n, output);
 }
 
-int Decimator::init_filters_140(unsigned int decimation)
+void Decimator::reset(void)
+{
+    if (cic)
+        cic->reset();
+    if (fir)
+        fir->reset();
+    if (chain)
+        chain->reset();
+}
+
+int Decimator::get_stats(struct stage_stats * stats) const
 {
     int         n = 0;
 
-    while (decimation >= 2)
+    if (cic)
     {
-        if (decimation >= 16)
-        {
-            filter_table[n++] = new CHalfBand11TapDecimateBy2(HBF_140_11);
-            fprintf(stderr, "  DEC %d: HBF_140_11 (unrolled)\n", n);
-        }
-        else if (decimation == 8)
-        {
-            filter_table[n++] = new CHalfBandDecimateBy2(HBF_140_15_LENGTH, HBF_140_15);
-            fprintf(stderr, "  DEC %d: HBF_140_15\n", n);
-        }
-        else if (decimation == 4)
-        {
-            filter_table[n++] = new CHalfBandDecimateBy2(HBF_140_27_LENGTH, HBF_140_27);
-            fprintf(stderr, "  DEC %d: HBF_140_27\n", n);
-        }
-        else if (decimation == 2)
-        {
-            filter_table[n++] = new CHalfBandDecimateBy2(HBF_140_87_LENGTH, HBF_140_87);
-            fprintf(stderr, "  DEC %d: HBF_140_87\n", n);
-        }
-
-        decimation /= 2;
+        stats[n].taps = cic->order();
+        stats[n++].memory = cic->memory();
+    }
+    if (fir && fir_first)
+    {
+        stats[n].taps = fir->taps();
+        stats[n++].memory = fir->memory();
+    }
+    if (chain)
+        n += chain->get_stats(&stats[n]);
+    if (fir && !fir_first)
+    {
+        stats[n].taps = fir->taps();
+        stats[n++].memory = fir->memory();
     }
 
-    return (1 << n);
+    return n;
 }
 
+size_t Decimator::memory_usage() const
+{
+    return (chain ? chain->memory() : 0) + (fir ? fir->memory() : 0) +
+            (cic ? cic->memory() : 0);
+}
 
-Decimator::CHalfBandDecimateBy2::CHalfBandDecimateBy2(int len, const real_t * pCoef)
-    : m_FirLength(len), m_pCoef(pCoef)
+void Decimator::delete_filters()
 {
-    complex_t   CPXZERO = {0.0, 0.0};
-    int i;
+    delete chain;
+    delete fir;
+    delete cic;
+    chain = 0;
+    fir = 0;
+    cic = 0;
+    fir_first = false;
+}
+
+/*
+ * Get the filter lengths of the num stage half band chain for the given
+ * attenuation. This must match the chains created by create_chain().
+ *
+ * Returns the attenuation of the filters.
+ */
+int Decimator::hbf_chain_taps(unsigned int _att, int num, int * taps)
+{
+    static const int    tail_70[] = { HBF_70_39_LENGTH };
+    static const int    tail_100[] = { HBF_100_19_LENGTH, HBF_100_59_LENGTH };
+    static const int    tail_140[] = { HBF_140_15_LENGTH, HBF_140_27_LENGTH,
+                                       HBF_140_87_LENGTH };
+    const int  *tail;
+    int         tail_len, first_len;
+    int         i, t;
+
+    if (_att <= 70)
+    {
+        _att = 70;
+        tail = tail_70;
+        tail_len = 1;
+        first_len = HBF_70_11_LENGTH;
+    }
+    else if (_att <= 100)
+    {
+        _att = 100;
+        tail = tail_100;
+        tail_len = 2;
+        first_len = HBF_100_11_LENGTH;
+    }
+    else
+    {
+        _att = 140;
+        tail = tail_140;
+        tail_len = 3;
+        first_len = HBF_140_11_LENGTH;
+    }
 
-    // create buffer for FIR implementation
-    m_pHBFirBuf = new complex_t[MAX_HALF_BAND_BUFSIZE];
-    for (i = 0; i < MAX_HALF_BAND_BUFSIZE; i++)
-        m_pHBFirBuf[i] = CPXZERO;
+    // the last stages use the tail, all others the 11 tap filter
+    for (i = 0; i < num; i++)
+    {
+        t = tail_len - (num - i);
+        taps[i] = t >= 0 ? tail[t] : first_len;
+    }
+
+    return _att;
 }
 
-int Decimator::CHalfBandDecimateBy2::DecBy2(int InLength, complex_t* pInData, complex_t* pOutData)
+/*
+ * Pass and stop band edges of an FIR decimating by ratio relative to its
+ * input rate. total is the decimation from the FIR input to the final
+ * output. When the FIR runs first it only has to protect the final pass
+ * band, when it runs last it sees the output of the half band stages.
+ */
+void Decimator::fir_spec(real_t total, real_t ratio, bool first,
+                         real_t * fpass, real_t * fstop)
 {
-    int     numoutsamples = 0;
-    int     i;
-    int     j;
+    if (first)
+    {
+        *fpass = PASSBAND / total;
+        *fstop = 1.0 / ratio - PASSBAND / total;
+    }
+    else
+    {
+        *fpass = PASSBAND / ratio;
+        *fstop = (1.0 - PASSBAND) / ratio;
+    }
+}
 
-    // input length must be even and greater than or equal the number of taps
-    if (InLength < m_FirLength)
-        return InLength / 2;     // FIXME: What to do?
+static void add_stage(struct Decimator::plan * p, int type, int decim,
+                      int interp, int taps, float cost)
+{
+    p->stages[p->num_stages].type = type;
+    p->stages[p->num_stages].decim = decim;
+    p->stages[p->num_stages].interp = interp;
+    p->stages[p->num_stages].taps = taps;
+    p->stages[p->num_stages].cost = cost;
+    p->num_stages++;
+    p->cost += cost;
+}
 
-    // copy input samples into buffer starting at position m_FirLength-1
-    for (i = 0, j = m_FirLength - 1; i < InLength; i++)
-        m_pHBFirBuf[j++] = pInData[i];
+bool Decimator::make_plan(unsigned int _decim, unsigned int _att,
+                          struct plan * p)
+{
+    return make_plan(_decim, 1, _att, p);
+}
 
-    // perform decimation FIR filter on even samples
-    for (i = 0; i < InLength; i += 2)
+bool Decimator::make_plan(unsigned int _decim, unsigned int _interp,
+                          unsigned int _att, struct plan * p)
+{
+    static const unsigned int   classes[] = { 70, 100, 140 };
+    struct plan     cand;
+    real_t          fpass, fstop, rate;
+    int             taps[MAX_HBF_STAGES];
+    int             fir_taps;
+    int             c, k, i, pos, M, L, R, N;
+    unsigned int    rest, g;
+    bool            found = false;
+
+    g = gcd(_decim, _interp);
+    if (g == 0)
+        return false;
+    _decim /= g;
+    _interp /= g;
+    if (_decim <= _interp || _decim < 2)
+        return false;
+
+    // R is the decimation of the CIC stage, 1 means no CIC stage. The droop
+    // equalizer is only designed for integer decimation.
+    for (R = 1; R <= (int)_decim / 2; R++)
     {
-        complex_t   acc;
+        if (_decim % R || (R > 1 && _interp > 1))
+            continue;
 
-        acc.re = (m_pHBFirBuf[i].re * m_pCoef[0]);
-        acc.im = (m_pHBFirBuf[i].im * m_pCoef[0]);
-        for (j = 0; j < m_FirLength; j += 2)
+        rest = _decim / R;
+        N = 0;
+        if (R > 1)
         {
-            acc.re += (m_pHBFirBuf[i+j].re * m_pCoef[j]);
-            acc.im += (m_pHBFirBuf[i+j].im * m_pCoef[j]);
+            N = CicDecimator::min_order(R, PASSBAND / rest, _att);
+            if (N == 0)
+                continue;
         }
 
-        // center coefficient
-        acc.re += (m_pHBFirBuf[i+(m_FirLength-1)/2].re * m_pCoef[(m_FirLength-1)/2]);
-        acc.im += (m_pHBFirBuf[i+(m_FirLength-1)/2].im * m_pCoef[(m_FirLength-1)/2]);
-        pOutData[numoutsamples++] = acc;
-
+        for (c = 0; c < 3; c++)
+        {
+            // filters with less attenuation than requested are not good enough
+            if (classes[c] < _att && classes[c] != 140)
+                continue;
+
+            for (k = 0; k <= MAX_HBF_STAGES; k++)
+            {
+                // the FIR resamples by L / M after the other stages
+                g = gcd(rest, _interp << k);
+                M = rest / g;
+                L = (_interp << k) / g;
+
+                // integer decimations only use half band stages that divide
+                if (_interp == 1 && L > 1)
+                    break;
+                if (L > 1 && (M <= L || L > FIR_MAX_INTERP))
+                    break;
+
+                // the droop of a CIC stage is equalized by the FIR
+                if (R > 1 && M == 1)
+                    break;
+
+                // pos 0: FIR first, pos 1: FIR last
+                for (pos = 0; pos < 2; pos++)
+                {
+                    if (pos == 1 && (M == 1 || k == 0 || R > 1))
+                        break;
+
+                    // a rational FIR runs at the lowest rate
+                    if (pos == 0 && L > 1 && k > 0)
+                        continue;
+
+                    fir_taps = 0;
+                    if (M > 1)
+                    {
+                        fir_spec(rest, (real_t)M / L, pos == 0 && L == 1,
+                                 &fpass, &fstop);
+                        fir_taps = FirDecimator::estimate_taps(fpass / L,
+                                                               fstop / L,
+                                                               _att);
+                        if (fir_taps == 0 || fir_taps > L * MAX_FIR_TAPS)
+                            break;
+                    }
+
+                    cand.decim = _decim;
+                    cand.interp = _interp;
+                    cand.att = hbf_chain_taps(classes[c], k, taps);
+                    cand.num_stages = 0;
+                    cand.cost = 0.0;
+                    rate = 1.0;
+
+                    // the input conversion costs about as much as four
+                    // multiplications and each integrator about one, the
+                    // combs and output conversion are cheaper
+                    if (R > 1)
+                    {
+                        add_stage(&cand, STAGE_CIC, R, 1, N,
+                                  4.0 + N + (2.0 + N) / R);
+                        rate /= R;
+                    }
+
+                    // a polyphase FIR computes taps / L products per output
+                    if (M > 1 && pos == 0)
+                    {
+                        add_stage(&cand, STAGE_FIR, M, L, fir_taps,
+                                  rate * 2.0 * fir_taps / M);
+                        rate = rate * L / M;
+                    }
+
+                    // folded half band: (len + 1) / 4 + 1 coefficients per
+                    // output
+                    for (i = 0; i < k; i++)
+                    {
+                        add_stage(&cand, STAGE_HBF, 2, 1, taps[i],
+                                  rate * ((taps[i] + 1) / 4 + 1));
+                        rate /= 2;
+                    }
+
+                    if (M > 1 && pos == 1)
+                        add_stage(&cand, STAGE_FIR, M, L, fir_taps,
+                                  rate * 2.0 * fir_taps / M);
+
+                    if (!found || cand.cost < p->cost)
+                    {
+                        *p = cand;
+                        found = true;
+                    }
+                }
+            }
+        }
     }
 
-    // need to copy last m_FirLength-1 input samples in buffer to beginning of
-    // buffer for FIR wrap around management
-    for (i = 0,j = InLength - m_FirLength + 1; i < m_FirLength - 1; i++)
-        m_pHBFirBuf[i] = pInData[j++];
-
-    return numoutsamples;
+    return found;
 }
 
-
-Decimator::CHalfBand11TapDecimateBy2::CHalfBand11TapDecimateBy2(const real_t * coef)
+void Decimator::print_plan(const struct plan * p, real_t _rate)
 {
-    complex_t   CPXZERO = {0.0,0.0};
-
-    H0 = coef[0];
-    H2 = coef[2];
-    H4 = coef[4];
-    H5 = coef[5];
-    H6 = coef[6];
-    H8 = coef[8];
-    H10 = coef[10];
-
-    d0 = CPXZERO;
-    d1 = CPXZERO;
-    d2 = CPXZERO;
-    d3 = CPXZERO;
-    d4 = CPXZERO;
-    d5 = CPXZERO;
-    d6 = CPXZERO;
-    d7 = CPXZERO;
-    d8 = CPXZERO;
-    d9 = CPXZERO;
+    int         i;
+
+    for (i = 0; i < p->num_stages; i++)
+    {
+        if (p->stages[i].type == STAGE_HBF)
+            fprintf(stderr, "  DEC %d: HBF_%u_%d\n", i + 1, p->att,
+                    p->stages[i].taps);
+        else if (p->stages[i].type == STAGE_CIC)
+            fprintf(stderr, "  DEC %d: CIC order %d, decim %d\n", i + 1,
+                    p->stages[i].taps, p->stages[i].decim);
+        else if (p->stages[i].interp > 1)
+            fprintf(stderr, "  DEC %d: FIR %d taps, resample %d/%d\n", i + 1,
+                    p->stages[i].taps, p->stages[i].interp,
+                    p->stages[i].decim);
+        else
+            fprintf(stderr, "  DEC %d: FIR %d taps, decim %d\n", i + 1,
+                    p->stages[i].taps, p->stages[i].decim);
+    }
+
+    if (p->interp > 1)
+        fprintf(stderr, "  Decimation %u/%u:", p->decim, p->interp);
+    else
+        fprintf(stderr, "  Decimation %u:", p->decim);
+
+    if (_rate > 0.0)
+        fprintf(stderr, " %.1f mul/sample, %.1f Mmul/s\n", p->cost,
+                1.e-6 * p->cost * _rate);
+    else
+        fprintf(stderr, " %.1f mul/sample\n", p->cost);
 }
 
-//////////////////////////////////////////////////////////////////////
-//Decimate by 2 Fixed 11 Tap Halfband filter class implementation
-// Two restrictions on this routine:
-// InLength must be larger or equal to the Number of Halfband Taps(11)
-// InLength must be an even number
-// Loop unrolled for speed ~15nS/samp
-//////////////////////////////////////////////////////////////////////
-int Decimator::CHalfBand11TapDecimateBy2::DecBy2(int InLength,
-                                                 complex_t * pInData,
-                                                 complex_t * pOutData)
+/*
+ * The 7-tap filters are not quite sufficient, so 11-tap filters are used for
+ * all but the last stages.
+ */
+Decimator::Chain *Decimator::create_chain(unsigned int _att, int num)
 {
-    int i;
-
-    complex_t   tmpout[9]; // allows using the same buffer for oIn and pOut
-
-    tmpout[0].re = H0 * d0.re + H2 * d2.re + H4 * d4.re + H5 * d5.re
-                + H6 * d6.re + H8 * d8.re + H10 * pInData[0].re;
-    tmpout[0].im = H0 * d0.im + H2 * d2.im + H4 * d4.im + H5 * d5.im
-                + H6 * d6.im + H8 * d8.im + H10 * pInData[0].im;
-
-    tmpout[1].re = H0 * d2.re + H2 * d4.re + H4 * d6.re + H5 * d7.re
-                + H6 * d8.re + H8 * pInData[0].re + H10 * pInData[2].re;
-    tmpout[1].im = H0 * d2.im + H2 * d4.im + H4 * d6.im + H5 * d7.im
-                + H6 * d8.im + H8 * pInData[0].im + H10 * pInData[2].im;
-
-    tmpout[2].re = H0 * d4.re + H2 * d6.re + H4 * d8.re + H5 * d9.re
-                + H6 * pInData[0].re + H8 * pInData[2].re + H10 * pInData[4].re;
-    tmpout[2].im = H0 * d4.im + H2 * d6.im + H4 * d8.im + H5 * d9.im
-                + H6 * pInData[0].im + H8 * pInData[2].im + H10 * pInData[4].im;
-
-    tmpout[3].re = H0 * d6.re + H2 * d8.re + H4 * pInData[0].re
-                + H5 * pInData[1].re + H6 * pInData[2].re + H8 * pInData[4].re
-                + H10 * pInData[6].re;
-    tmpout[3].im = H0 * d6.im + H2 * d8.im + H4 * pInData[0].im
-                + H5 * pInData[1].im + H6 * pInData[2].im + H8 * pInData[4].im
-                + H10*pInData[6].im;
-
-    tmpout[4].re = H0 * d8.re + H2 * pInData[0].re + H4 * pInData[2].re
-                + H5 * pInData[3].re + H6 * pInData[4].re + H8 * pInData[6].re
-                + H10 * pInData[8].re;
-    tmpout[4].im = H0 * d8.im + H2 * pInData[0].im + H4 * pInData[2].im
-                + H5 * pInData[3].im + H6 * pInData[4].im + H8 * pInData[6].im
-                + H10 * pInData[8].im;
-
-    tmpout[5].re = H0 * pInData[0].re + H2 * pInData[2].re + H4 * pInData[4].re
-                + H5 * pInData[5].re + H6 * pInData[6].re + H8 * pInData[8].re
-                + H10 * pInData[10].re;
-    tmpout[5].im = H0 * pInData[0].im + H2 * pInData[2].im + H4 * pInData[4].im
-                + H5 * pInData[5].im + H6 * pInData[6].im + H8 * pInData[8].im
-                + H10 * pInData[10].im;
-
-    tmpout[6].re = H0 * pInData[2].re + H2 * pInData[4].re + H4 * pInData[6].re
-                + H5 * pInData[7].re + H6 * pInData[8].re + H8 * pInData[10].re
-                + H10 * pInData[12].re;
-    tmpout[6].im = H0 * pInData[2].im + H2 * pInData[4].im + H4 * pInData[6].im
-                + H5 * pInData[7].im + H6 * pInData[8].im + H8 * pInData[10].im
-                + H10 * pInData[12].im;
-
-    tmpout[7].re = H0 * pInData[4].re + H2 * pInData[6].re + H4 * pInData[8].re
-                + H5 * pInData[9].re + H6 * pInData[10].re + H8 * pInData[12].re
-                + H10 * pInData[14].re;
-    tmpout[7].im = H0 * pInData[4].im + H2 * pInData[6].im + H4 * pInData[8].im
-                + H5 * pInData[9].im + H6 * pInData[10].im + H8 * pInData[12].im
-                + H10 * pInData[14].im;
-
-    tmpout[8].re = H0 * pInData[6].re + H2 * pInData[8].re + H4 * pInData[10].re
-                + H5 * pInData[11].re + H6 * pInData[12].re
-                + H8 * pInData[14].re + H10 * pInData[16].re;
-    tmpout[8].im = H0 * pInData[6].im + H2 * pInData[8].im + H4 * pInData[10].im
-                + H5 * pInData[11].im + H6 * pInData[12].im
-                + H8 * pInData[14].im + H10 * pInData[16].im;
-
-    // remaining input samples
-    complex_t   *pIn = &pInData[8];
-    complex_t   *pOut = &pOutData[9];
-    for (i = 0; i < (InLength-11-6 )/2; i++)
-    {
-        (*pOut).re = H0 * pIn[0].re + H2 * pIn[2].re + H4 * pIn[4].re
-                + H5 * pIn[5].re + H6 * pIn[6].re + H8 * pIn[8].re
-                + H10 * pIn[10].re;
-        (*pOut++).im = H0 * pIn[0].im + H2 * pIn[2].im + H4 * pIn[4].im
-                + H5 * pIn[5].im + H6 * pIn[6].im + H8 * pIn[8].im
-                + H10 * pIn[10].im;
-        pIn += 2;
-    }
-
-    pOutData[0] = tmpout[0];
-    pOutData[1] = tmpout[1];
-    pOutData[2] = tmpout[2];
-    pOutData[3] = tmpout[3];
-    pOutData[4] = tmpout[4];
-    pOutData[5] = tmpout[5];
-    pOutData[6] = tmpout[6];
-    pOutData[7] = tmpout[7];
-    pOutData[8] = tmpout[8];
-
-    // update delay buffer
-    pIn = &pInData[InLength-1];
-    d9 = *pIn--;
-    d8 = *pIn--;
-    d7 = *pIn--;
-    d6 = *pIn--;
-    d5 = *pIn--;
-    d4 = *pIn--;
-    d3 = *pIn--;
-    d2 = *pIn--;
-    d1 = *pIn--;
-    d0 = *pIn;
-
-    return InLength / 2;
+    if (_att <= 70)
+        return repeat_chain<MAX_HBF_STAGES - 1, hbf_70_11_t,
+                            hbf_70_39_t>::create(num - 1);
+
+    if (_att <= 100)
+    {
+        if (num == 1)
+            return new ChainImpl<hbf_100_59_t>;
+
+        return repeat_chain<MAX_HBF_STAGES - 2, hbf_100_11_t,
+                            hbf_100_19_t, hbf_100_59_t>::create(num - 2);
+    }
+
+    if (num == 1)
+        return new ChainImpl<hbf_140_87_t>;
+    if (num == 2)
+        return new ChainImpl<hbf_140_27_t, hbf_140_87_t>;
+
+    return repeat_chain<MAX_HBF_STAGES - 3, hbf_140_11_t, hbf_140_15_t,
+                        hbf_140_27_t, hbf_140_87_t>::create(num - 3);
 }
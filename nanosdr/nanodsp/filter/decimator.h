@@ -1,83 +1,207 @@
 /*
- * Decimate by power-of-2 using half band filters.
+ * Decimate using a chain of CIC, half band and FIR filters.
  */
 #pragma once
 
-#define MAX_DECIMATION          512
-#define MAX_STAGES              9
+#include <stddef.h>
+
+#define MAX_DECIMATION          4096
+#define MAX_HBF_STAGES          9
+#define MAX_STAGES              (MAX_HBF_STAGES + 2)
+
+// Largest FIR filter considered by the planner
+#define MAX_FIR_TAPS            2048
 
 #include "common/datatypes.h"
+#include "nanodsp/translate.h"
+#include "cic_decim.h"
+#include "fir_decim.h"
+
+// Number of input samples mixed at a time by the fused process()
+#define MIX_CHUNK               1024
 
 class Decimator
 {
 public:
+    /* Statistics for one stage */
+    struct stage_stats
+    {
+        int         taps;       // filter length or CIC order
+        size_t      memory;     // bytes used for state and buffers
+    };
+
+    /* Stage types used in a plan */
+    enum stage_type
+    {
+        STAGE_HBF,              // half band decimate-by-2
+        STAGE_FIR,              // polyphase FIR decimate-by-M
+        STAGE_CIC               // CIC decimate-by-R
+    };
+
+    /* One stage of a plan */
+    struct stage_plan
+    {
+        int         type;       // stage_type
+        int         decim;      // decimation of this stage
+        int         interp;     // interpolation of a rational FIR, else 1
+        int         taps;       // filter length or CIC order
+        float       cost;       // multiplications per decimator input sample
+    };
+
+    /* Decimation plan, see make_plan() */
+    struct plan
+    {
+        unsigned int        decim;
+        unsigned int        interp;     // output rate is interp / decim
+        unsigned int        att;        // attenuation of the half band stages
+        int                 num_stages;
+        struct stage_plan   stages[MAX_STAGES];
+        float               cost;       // multiplications per input sample
+    };
+
     Decimator();
     virtual    ~Decimator();
 
     /*
      * Initialise the decimator.
-     * _decim is the decimation factor. Must be power of 2 and less than 512.
+     * _decim is the decimation factor. Must be less than or equal to
+     * MAX_DECIMATION.
      * _att is the desired stop band attenuation in dB.
+     * _rate is the input sample rate, only used for reporting the cost.
      *
      * Returns The actual decimation.
      *
      * Given the decimation and desired stop band attenuation, this function
-     * will construct a chain of half band filters that will be used for
-     * decimation.
+     * will construct the filter chain chosen by make_plan().
      */
-    unsigned int    init(unsigned int _decim, unsigned int _att);
-    int             process(int num, complex_t * samples);
+    unsigned int    init(unsigned int _decim, unsigned int _att,
+                         real_t _rate = 0.0);
 
-private:
+    /*
+     * Initialise the decimator for the output rate closest to out_rate.
+     * The rates are rounded to integer Hz and the ratio between them is
+     * used if make_plan() finds a plan for it, otherwise the closest
+     * integer decimation giving at least out_rate is used. Samples pass
+     * through unchanged when out_rate is not below in_rate.
+     *
+     * Returns the actual output rate.
+     */
+    real_t          init_rate(real_t in_rate, real_t out_rate,
+                              unsigned int _att);
 
-    /* Abstract base class for decimate-by-2 stages */
-    class CDec2
-    {
-    public:
-        virtual ~CDec2() {}
-        virtual int DecBy2(int InLength, complex_t* pInData, complex_t* pOutData) = 0;
-    };
+    /*
+     * Find the cheapest chain of stages for the given decimation and stop
+     * band attenuation. The output is alias free up to 0.4 times the output
+     * rate.
+     *
+     * The candidates are all splits of the decimation into 2^k half band
+     * stages and an FIR decimating by the rest, with the FIR either before
+     * or after the half band stages, using each set of half band filters
+     * that is good enough. Each split may also be preceded by a CIC stage
+     * of the lowest order that keeps the aliases down, followed by the FIR
+     * equalizing its droop. The cost is the number of real multiplications
+     * per input sample.
+     *
+     * The second version resamples by _interp / _decim. The FIR becomes a
+     * polyphase L/M resampler taking whatever is left after the half band
+     * stages and runs at the lowest rate.
+     *
+     * Returns false if no plan was found.
+     */
+    static bool     make_plan(unsigned int _decim, unsigned int _att,
+                              struct plan * p);
+    static bool     make_plan(unsigned int _decim, unsigned int _interp,
+                              unsigned int _att, struct plan * p);
+
+    /* Print the plan and its cost at the given input rate. */
+    static void     print_plan(const struct plan * p, real_t _rate);
 
-    /* Generic decimate-by-2 implementation using half band filters */
-    class CHalfBandDecimateBy2 : public CDec2
+    /* Get the plan used by the decimator. */
+    const struct plan * get_plan(void) const
     {
-    public:
-        CHalfBandDecimateBy2(int len, const real_t* pCoef);
-        ~CHalfBandDecimateBy2()
-        {
-            if (m_pHBFirBuf)
-                delete m_pHBFirBuf;
-        }
-
-        int     DecBy2(int InLength, complex_t * pInData, complex_t * pOutData);
-
-        complex_t      *m_pHBFirBuf;
-        int             m_FirLength;
-        const real_t   *m_pCoef;
-    };
+        return &cur_plan;
+    }
+
+    /*
+     * Decimate num samples. The first version decimates in place, the second
+     * one reads from input and writes to output, which allows decimating
+     * directly from a read-only device buffer. Output must have space for
+     * num / 2 + 1 samples, or num samples when resampling by less than 2.
+     *
+     * Returns the number of output samples.
+     */
+    int             process(int num, complex_t * samples);
+    int             process(int num, const complex_t * input,
+                            complex_t * output);
+
+    /*
+     * Frequency translate using nco and decimate in one pass.
+     *
+     * The input is mixed in chunks of MIX_CHUNK samples into a small buffer
+     * that stays in cache and is decimated by the first stage from there, so
+     * the full rate data is only read once and only the decimated samples
+     * are written back. Input and output may be the same buffer.
+     *
+     * Returns the number of output samples.
+     */
+    int             process(int num, const complex_t * input,
+                            complex_t * output, Translate &nco);
+
+    /* Clear the filter history, e.g. after a gap in the input. */
+    void            reset(void);
+
+    /*
+     * Get statistics for the current filter chain.
+     * stats must have space for MAX_STAGES entries.
+     *
+     * Returns the number of stages.
+     */
+    int             get_stats(struct stage_stats * stats) const;
+
+    /* Total memory used by the filter chain in bytes. */
+    size_t          memory_usage() const;
 
-    /* Decimate-by-2 implementation using 11-tap half band filter */
-    class CHalfBand11TapDecimateBy2 : public CDec2
+    /*
+     * Chain of decimate-by-2 stages. The stages are composed at compile time
+     * for each decimation and attenuation, see decimator.cpp.
+     */
+    class Chain
     {
     public:
-        CHalfBand11TapDecimateBy2(const real_t * coef);
-        ~CHalfBand11TapDecimateBy2() {}
-        int DecBy2(int InLength, complex_t * pInData, complex_t * pOutData);
-
-        // coefficients
-        real_t      H0, H2, H4, H5, H6, H8, H10;
+        virtual ~Chain() {}
 
-        // delay buffer
-        complex_t   d0, d1, d2, d3, d4, d5, d6, d7, d8, d9;
+        // run the first stage
+        virtual int first(int num, const complex_t * input,
+                          complex_t * output) = 0;
+        // run the remaining stages in place
+        virtual int rest(int num, complex_t * samples) = 0;
+        // clear the history of all stages
+        virtual void reset() = 0;
+        virtual int get_stats(struct stage_stats * stats) const = 0;
+        virtual size_t memory() const = 0;
     };
 
 private:
-    int         init_filters_70(unsigned int decimation);
-    int         init_filters_100(unsigned int decimation);
-    int         init_filters_140(unsigned int decimation);
+    static int  hbf_chain_taps(unsigned int _att, int num, int * taps);
+    static void fir_spec(real_t total, real_t ratio, bool first,
+                         real_t * fpass, real_t * fstop);
+
+    void        build(unsigned int _att, real_t _rate);
+    Chain      *create_chain(unsigned int _att, int num);
+    int         first_stage(int num, const complex_t * input,
+                            complex_t * output);
+    int         other_stages(int num, complex_t * samples);
     void        delete_filters();
-    CDec2      *filter_table[MAX_STAGES];
+    Chain      *chain;
+    FirDecimator   *fir;
+    CicDecimator   *cic;
+    bool        fir_first;      // FIR runs before the half band stages
+
+    struct plan         cur_plan;
 
     unsigned int        atten;
     unsigned int        decim;
+    unsigned int        interp;
+
+    complex_t           mix_buf[2 * MIX_CHUNK];
 };
@@ -48,7 +48,7 @@
  * Stop band         : -106 dB
  */
 #define HBF_100_11_LENGTH        11
-const real_t HBF_100_11[HBF_100_11_LENGTH] =
+constexpr real_t HBF_100_11[HBF_100_11_LENGTH] =
 {
     0.006633419280515,
     0.0,
@@ -75,7 +75,7 @@ const real_t HBF_100_11[HBF_100_11_LENGTH] =
  * Stop band         : -110 dB
  */
 #define HBF_100_19_LENGTH    19
-const real_t HBF_100_19[HBF_100_19_LENGTH] =
+constexpr real_t HBF_100_19[HBF_100_19_LENGTH] =
 {
     0.0006617102188732,
     0.0,
@@ -110,7 +110,7 @@ const real_t HBF_100_19[HBF_100_19_LENGTH] =
  * Stop band         : -99 dB
  */
 #define HBF_100_59_LENGTH    59
-const real_t HBF_100_59[HBF_100_59_LENGTH] =
+constexpr real_t HBF_100_59[HBF_100_59_LENGTH] =
 {
     3.501888525991e-005,
     0.0,
@@ -60,7 +60,7 @@
  * Stop band         : -140 dB
  */
 #define HBF_140_7_LENGTH     7
-const real_t HBF_140_7[HBF_140_7_LENGTH] =
+constexpr real_t HBF_140_7[HBF_140_7_LENGTH] =
 {
     -0.0312891214414,
     0.0,
@@ -83,7 +83,7 @@ const real_t HBF_140_7[HBF_140_7_LENGTH] =
  * Stop band         : -140 dB
  */
 #define HBF_140_11_LENGTH   11
-const real_t HBF_140_11[HBF_140_11_LENGTH] =
+constexpr real_t HBF_140_11[HBF_140_11_LENGTH] =
 {
    0.0060431029837374152,
    0.0,
@@ -110,7 +110,7 @@ const real_t HBF_140_11[HBF_140_11_LENGTH] =
  * Stop band         : -140 dB
  */
 #define HBF_140_15_LENGTH   15
-const real_t HBF_140_15[HBF_140_15_LENGTH] =
+constexpr real_t HBF_140_15[HBF_140_15_LENGTH] =
 {
     -0.001442203300285281,
     0.0,
@@ -141,7 +141,7 @@ const real_t HBF_140_15[HBF_140_15_LENGTH] =
  * Stop band         : -140 dB
  */
 #define HBF_140_19_LENGTH   19
-const real_t HBF_140_19[HBF_140_19_LENGTH] =
+constexpr real_t HBF_140_19[HBF_140_19_LENGTH] =
 {
     0.00042366527106480427,
     0.0,
@@ -176,7 +176,7 @@ const real_t HBF_140_19[HBF_140_19_LENGTH] =
  * Stop band         : -140 dB
  */
 #define HBF_140_23_LENGTH    23
-const real_t HBF_140_23[HBF_140_23_LENGTH] =
+constexpr real_t HBF_140_23[HBF_140_23_LENGTH] =
 {
     -0.00014987651418332164,
     0.0,
@@ -215,7 +215,7 @@ const real_t HBF_140_23[HBF_140_23_LENGTH] =
  * Stop band         : -140 dB
  */
 #define HBF_140_27_LENGTH    27
-const real_t HBF_140_27[HBF_140_27_LENGTH] =
+constexpr real_t HBF_140_27[HBF_140_27_LENGTH] =
 {
     0.000063730426952664685,
     0.0,
@@ -258,7 +258,7 @@ const real_t HBF_140_27[HBF_140_27_LENGTH] =
  * Stop band         : -140 dB
  */
 #define HBF_140_31_LENGTH    31
-const real_t HBF_140_31[HBF_140_31_LENGTH] =
+constexpr real_t HBF_140_31[HBF_140_31_LENGTH] =
 {
     -0.000030957335326552226,
     0.0,
@@ -305,7 +305,7 @@ const real_t HBF_140_31[HBF_140_31_LENGTH] =
  * Stop band         : -140 dB
  */
 #define HBF_140_35_LENGTH    35
-const real_t HBF_140_35[HBF_140_35_LENGTH] =
+constexpr real_t HBF_140_35[HBF_140_35_LENGTH] =
 {
     0.000017017718072971716,
     0.0,
@@ -356,7 +356,7 @@ const real_t HBF_140_35[HBF_140_35_LENGTH] =
  * Stop band         : -140 dB
  */
 #define HBF_140_39_LENGTH    39
-const real_t HBF_140_39[HBF_140_39_LENGTH] =
+constexpr real_t HBF_140_39[HBF_140_39_LENGTH] =
 {
     -0.000010175082832074367,
     0.0,
@@ -411,7 +411,7 @@ const real_t HBF_140_39[HBF_140_39_LENGTH] =
  * Stop band         : -139 dB
  */
 #define HBF_140_43_LENGTH    43
-const real_t HBF_140_43[HBF_140_43_LENGTH] =
+constexpr real_t HBF_140_43[HBF_140_43_LENGTH] =
 {
     0.0000067666739082756387,
     0.0,
@@ -470,7 +470,7 @@ const real_t HBF_140_43[HBF_140_43_LENGTH] =
  * Stop band         : -140 dB
  */
 #define HBF_140_47_LENGTH    47
-const real_t HBF_140_47[HBF_140_47_LENGTH] =
+constexpr real_t HBF_140_47[HBF_140_47_LENGTH] =
 {
     -0.0000045298314172004251,
     0.0,
@@ -533,7 +533,7 @@ const real_t HBF_140_47[HBF_140_47_LENGTH] =
  * Stop band         : -139 dB
  */
 #define HBF_140_51_LENGTH    51
-const real_t HBF_140_51[HBF_140_51_LENGTH] =
+constexpr real_t HBF_140_51[HBF_140_51_LENGTH] =
 {
     0.0000033359253688981639,
     0.0,
@@ -600,7 +600,7 @@ const real_t HBF_140_51[HBF_140_51_LENGTH] =
  * Stop band         : -139 dB
  */
 #define HBF_140_87_LENGTH    87
-const real_t HBF_140_87[HBF_140_87_LENGTH] = {
+constexpr real_t HBF_140_87[HBF_140_87_LENGTH] = {
     -6.662792202e-007,
     0.0,
     3.182105957e-006,
@@ -47,7 +47,7 @@
  * Stop band         : -70 dB
  */
 #define HBF_70_11_LENGTH     11
-const real_t HBF_70_11[HBF_70_11_LENGTH] =
+constexpr real_t HBF_70_11[HBF_70_11_LENGTH] =
 {
 	0.009707733567516,
 	0.0,
@@ -74,7 +74,7 @@ const real_t HBF_70_11[HBF_70_11_LENGTH] =
  * Stop band         : -70 dB
  */
 #define HBF_70_39_LENGTH     39
-const real_t HBF_70_39[HBF_70_39_LENGTH] =
+constexpr real_t HBF_70_39[HBF_70_39_LENGTH] =
 {
     -0.0006388614035059,
     0.0,
@@ -0,0 +1,324 @@
+/*
+ * Decimate by an integer factor using a polyphase FIR filter.
+ *
+ * Copyright 2019 Alexandru Csete OZ9AEC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE__) && !defined(USE_DOUBLE)
+#include <xmmintrin.h>
+#define FIR_SSE
+#elif defined(__ARM_NEON) && !defined(USE_DOUBLE)
+#include <arm_neon.h>
+#define FIR_NEON
+#endif
+
+#include "cic_decim.h"
+#include "fir_decim.h"
+
+
+// zeroth order modified Bessel function of the first kind
+static double izero(double x)
+{
+    double  x2 = x / 2.0;
+    double  sum = 1.0;
+    double  ds = 1.0;
+    double  di = 1.0;
+    double  tmp;
+
+    do
+    {
+        tmp = x2 / di;
+        tmp *= tmp;
+        ds *= tmp;
+        sum += ds;
+        di += 1.0;
+    } while (ds >= 1.e-9 * sum);
+
+    return sum;
+}
+
+/*
+ * Impulse response at x of an ideal low pass filter with cutoff fcut whose
+ * pass band inverts the response of the CIC filter. The inverse is continued
+ * into the transition band to keep it smooth, which makes the windowed
+ * filter follow it closely. The integral is evaluated with Simpson's rule
+ * using steps short enough to resolve the oscillation at x.
+ */
+static double cic_comp_ideal(double x, double fcut, int cic_decim,
+                             int cic_order)
+{
+    double  f, df, g, sum;
+    int     i, steps;
+
+    steps = 2 * (int)(8.0 * fcut * (fabs(x) + 1.0) + 32.0);
+    df = fcut / steps;
+    sum = 0.0;
+    for (i = 0; i <= steps; i++)
+    {
+        f = i * df;
+        g = cos(K_2PI * f * x) /
+                CicDecimator::response(cic_decim, cic_order, f);
+        if (i == 0 || i == steps)
+            sum += g;
+        else
+            sum += (i & 1) ? 4.0 * g : 2.0 * g;
+    }
+
+    return 2.0 * sum * df / 3.0;
+}
+
+FirDecimator::FirDecimator()
+{
+    decim = 0;
+    interp = 1;
+    num_taps = 0;
+    padded_taps = 0;
+    coef = 0;
+    buf = 0;
+    skip = 0;
+    phase = 0;
+}
+
+FirDecimator::~FirDecimator()
+{
+    delete[] coef;
+    delete[] buf;
+}
+
+int FirDecimator::estimate_taps(real_t fpass, real_t fstop, real_t att)
+{
+    int     ntaps;
+
+    if (fstop <= fpass)
+        return 0;
+
+    ntaps = (att - 8.0) / (2.285 * K_2PI * (fstop - fpass)) + 1;
+
+    return ntaps < 3 ? 3 : ntaps;
+}
+
+int FirDecimator::init(int M, real_t fpass, real_t fstop, real_t att,
+                       int cic_decim, int cic_order)
+{
+    if (M < 2)
+        return 0;
+
+    return design(1, M, fpass, fstop, att, cic_decim, cic_order);
+}
+
+int FirDecimator::init_rational(int L, int M, real_t fpass, real_t fstop,
+                                real_t att)
+{
+    if (L < 1 || L > FIR_MAX_INTERP || M <= L)
+        return 0;
+
+    return design(L, M, fpass / L, fstop / L, att, 0, 0);
+}
+
+/*
+ * Design the prototype filter at L times the input rate and split it into
+ * L phases. Phase p holds taps p, p + L, p + 2L, ... which are applied to
+ * consecutive input samples.
+ */
+int FirDecimator::design(int L, int M, real_t fpass, real_t fstop,
+                         real_t att, int cic_decim, int cic_order)
+{
+    double      beta, fcut, center, x, c, sum;
+    double     *h;
+    int         i, k, n, ph;
+
+    n = estimate_taps(fpass, fstop, att);
+    if (n == 0)
+        return 0;
+
+    delete[] coef;
+    delete[] buf;
+
+    decim = M;
+    interp = L;
+    num_taps = n;
+    padded_taps = ((n + L - 1) / L + 3) & ~3;
+
+    // Kaiser-Bessel window shape factor from stop band attenuation
+    if (att < 20.96)
+        beta = 0.0;
+    else if (att >= 50.0)
+        beta = 0.1102 * (att - 8.71);
+    else
+        beta = 0.5842 * pow(att - 20.96, 0.4) + 0.07886 * (att - 20.96);
+
+    fcut = 0.5 * (fpass + fstop);
+    center = 0.5 * (n - 1);
+    h = new double[n];
+    sum = 0.0;
+    for (i = 0; i < n; i++)
+    {
+        x = i - center;
+        if (cic_order > 0)
+            c = cic_comp_ideal(x, fcut, cic_decim, cic_order);
+        else if (x == 0.0)
+            c = 2.0 * fcut;
+        else
+            c = sin(K_2PI * x * fcut) / (K_PI * x);
+
+        x /= center;
+        h[i] = c * izero(beta * sqrt(1.0 - x * x)) / izero(beta);
+        sum += h[i];
+    }
+
+    // reverse each phase and pad at the old end, normalize to unity gain
+    // at DC
+    coef = new real_t[2 * L * padded_taps];
+    for (ph = 0; ph < L; ph++)
+    {
+        for (i = 0; i < padded_taps; i++)
+        {
+            k = ph + L * (padded_taps - 1 - i);
+            c = k < n ? L * h[k] / sum : 0.0;
+            coef[2 * (ph * padded_taps + i)] = c;
+            coef[2 * (ph * padded_taps + i) + 1] = c;
+        }
+    }
+    delete[] h;
+
+    buf = new complex_t[padded_taps - 1 + FIR_DECIM_CHUNK];
+    reset();
+
+    return num_taps;
+}
+
+void FirDecimator::reset(void)
+{
+    int     i;
+
+    for (i = 0; i < padded_taps - 1; i++)
+    {
+        buf[i].re = 0.0;
+        buf[i].im = 0.0;
+    }
+    skip = decim - 1;
+    phase = 0;
+}
+
+size_t FirDecimator::memory(void) const
+{
+    return sizeof(*this) + 2 * interp * padded_taps * sizeof(real_t)
+            + (padded_taps - 1 + FIR_DECIM_CHUNK) * sizeof(complex_t);
+}
+
+/*
+ * Output k is taken at k * M in the input upsampled by L. The next output is
+ * phase + M steps of 1 / L input samples further, which gives both the
+ * input sample and the filter phase to use.
+ *
+ * The outputs of a chunk are written before the start of the next chunk in
+ * the input when M > L. This is what makes in place decimation work.
+ */
+int FirDecimator::process(int num, const complex_t * input,
+                          complex_t * output)
+{
+    int     hist = padded_taps - 1;
+    int     n = 0;
+    int     chunk;
+    int     p;
+
+    if (!decim)
+        return 0;
+
+    while (num > 0)
+    {
+        chunk = num < FIR_DECIM_CHUNK ? num : FIR_DECIM_CHUNK;
+        memcpy(&buf[hist], input, chunk * sizeof(complex_t));
+
+        // buf[hist + p] is the newest sample of the output
+        for (p = skip; p < chunk; )
+        {
+            filter(&buf[p], &coef[2 * phase * padded_taps], &output[n++]);
+            phase += decim;
+            p += phase / interp;
+            phase %= interp;
+        }
+        skip = p - chunk;
+
+        memmove(buf, &buf[chunk], hist * sizeof(complex_t));
+        input += chunk;
+        num -= chunk;
+    }
+
+    return n;
+}
+
+/* Filter padded_taps samples starting at in using the coefficients h. */
+void FirDecimator::filter(const complex_t * in, const real_t * h,
+                          complex_t * out)
+{
+    const real_t   *x = (const real_t *)in;
+    int             i;
+
+#if defined(FIR_SSE)
+    __m128      acc0 = _mm_setzero_ps();
+    __m128      acc1 = _mm_setzero_ps();
+    float       sum[4];
+
+    for (i = 0; i < 2 * padded_taps; i += 8)
+    {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(&h[i]),
+                                           _mm_loadu_ps(&x[i])));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(&h[i + 4]),
+                                           _mm_loadu_ps(&x[i + 4])));
+    }
+    _mm_storeu_ps(sum, _mm_add_ps(acc0, acc1));
+    out->re = sum[0] + sum[2];
+    out->im = sum[1] + sum[3];
+#elif defined(FIR_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    float32x2_t sum;
+
+    for (i = 0; i < 2 * padded_taps; i += 8)
+    {
+        acc0 = vmlaq_f32(acc0, vld1q_f32(&h[i]), vld1q_f32(&x[i]));
+        acc1 = vmlaq_f32(acc1, vld1q_f32(&h[i + 4]), vld1q_f32(&x[i + 4]));
+    }
+    acc0 = vaddq_f32(acc0, acc1);
+    sum = vadd_f32(vget_low_f32(acc0), vget_high_f32(acc0));
+    out->re = vget_lane_f32(sum, 0);
+    out->im = vget_lane_f32(sum, 1);
+#else
+    real_t      re = 0.0;
+    real_t      im = 0.0;
+
+    for (i = 0; i < 2 * padded_taps; i += 2)
+    {
+        re += h[i] * x[i];
+        im += h[i + 1] * x[i + 1];
+    }
+    out->re = re;
+    out->im = im;
+#endif
+}
@@ -0,0 +1,112 @@
+/*
+ * Decimate by an integer factor using a polyphase FIR filter.
+ */
+#pragma once
+
+#include <stddef.h>
+
+#include "common/datatypes.h"
+
+/* Number of input samples filtered from the work buffer at a time */
+#define FIR_DECIM_CHUNK     2048
+
+/* Largest interpolation of a rational resampler */
+#define FIR_MAX_INTERP      256
+
+/*
+ * Class for decimating complex samples by M, or resampling by L/M, using a
+ * Kaiser windowed sinc low pass filter.
+ *
+ * Only every M-th output of the filter is calculated. For L/M resampling the
+ * filter is split into L phases, so the zeros of the upsampled input are
+ * never multiplied. The input is copied in chunks of FIR_DECIM_CHUNK samples
+ * into a work buffer after the last taps - 1 samples of the previous chunk,
+ * so the block length does not have to be a multiple of M and decimation
+ * can be done in place.
+ */
+class FirDecimator
+{
+public:
+    FirDecimator();
+    virtual    ~FirDecimator();
+
+    /*
+     * Design the filter and initialize the decimator.
+     *
+     * Parameters:
+     *   M          The decimation.
+     *   fpass      Pass band edge relative to the input rate.
+     *   fstop      Stop band edge relative to the input rate.
+     *   att        Stop band attenuation in dB.
+     *   cic_decim  Decimation of a CIC filter feeding this one.
+     *   cic_order  Order of the CIC filter, 0 if there is none.
+     *
+     * With a CIC filter in front the pass band is shaped to equalize the
+     * droop of the CIC filter.
+     *
+     * Returns the number of taps.
+     */
+    int         init(int M, real_t fpass, real_t fstop, real_t att,
+                     int cic_decim = 0, int cic_order = 0);
+
+    /*
+     * Initialize a rational resampler with output rate L / M times the
+     * input rate. M must be larger than L and L at most FIR_MAX_INTERP.
+     * fpass and fstop are relative to the input rate.
+     *
+     * Returns the number of taps of the prototype filter.
+     */
+    int         init_rational(int L, int M, real_t fpass, real_t fstop,
+                              real_t att);
+
+    /* Number of taps needed for the given filter specification. */
+    static int  estimate_taps(real_t fpass, real_t fstop, real_t att);
+
+    /* Clear the filter history. */
+    void        reset(void);
+
+    /*
+     * Decimate num samples from input into output, which may be the same
+     * buffer. Output must have space for num * L / M + 1 samples.
+     *
+     * Returns the number of output samples.
+     */
+    int         process(int num, const complex_t * input, complex_t * output);
+
+    int         factor(void) const
+    {
+        return decim;
+    }
+
+    int         interpolation(void) const
+    {
+        return interp;
+    }
+
+    int         taps(void) const
+    {
+        return num_taps;
+    }
+
+    size_t      memory(void) const;
+
+private:
+    int         design(int L, int M, real_t fpass, real_t fstop, real_t att,
+                       int cic_decim, int cic_order);
+    void        filter(const complex_t * in, const real_t * h,
+                       complex_t * out);
+
+    int         decim;
+    int         interp;
+    int         num_taps;       // length of the prototype filter
+    int         padded_taps;    // taps per phase rounded up to a multiple of 4
+
+    // reversed coefficients of each phase, each one twice for the I and Q
+    // samples
+    real_t     *coef;
+    // padded_taps - 1 samples of history followed by the current chunk
+    complex_t  *buf;
+
+    int         skip;           // input samples until the next output
+    int         phase;          // filter phase of the next output
+};
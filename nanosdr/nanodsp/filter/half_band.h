@@ -0,0 +1,393 @@
+/*
+ * Decimate-by-2 using half band filters specialized at compile time.
+ *
+ * Copyright 2019 Alexandru Csete OZ9AEC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <stddef.h>
+
+#if defined(__SSE__) && !defined(USE_DOUBLE)
+#include <xmmintrin.h>
+#define HBF_SSE
+#if defined(__AVX__)
+#include <immintrin.h>
+#define HBF_AVX
+#endif
+#elif defined(__ARM_NEON) && !defined(USE_DOUBLE)
+#include <arm_neon.h>
+#define HBF_NEON
+#endif
+
+#include "common/datatypes.h"
+
+#define HBF_INLINE      inline __attribute__((always_inline))
+
+/*
+ * Check that coef is a half band filter of length len = 4n + 3: symmetric
+ * and with all odd taps except the center one being zero.
+ */
+constexpr bool hbf_check(const real_t * coef, int len, int i = 0)
+{
+    return (len & 3) == 3 && (i > len / 2 ||
+            (coef[i] == coef[len - 1 - i] &&
+             (i % 2 == 0 || i == len / 2 || coef[i] == 0.0) &&
+             hbf_check(coef, len, i + 1)));
+}
+
+/* Call f(0), f(1), ..., f(N - 1) unrolled at compile time. */
+template <int N>
+struct hbf_unroll
+{
+    template <class F>
+    static HBF_INLINE void run(F &f)
+    {
+        hbf_unroll<N - 1>::run(f);
+        f(N - 1);
+    }
+};
+
+template <>
+struct hbf_unroll<0>
+{
+    template <class F>
+    static HBF_INLINE void run(F &) {}
+};
+
+#if defined(HBF_SSE)
+// in[0] and in[2] packed into one register
+static HBF_INLINE __m128 hbf_load_even_sse(const float * in)
+{
+    return _mm_shuffle_ps(_mm_loadu_ps(in), _mm_loadu_ps(in + 4),
+                          _MM_SHUFFLE(1, 0, 1, 0));
+}
+#endif
+
+#if defined(HBF_AVX)
+// in[0], in[4], in[2] and in[6] packed into one register
+static HBF_INLINE __m256 hbf_load_even_avx(const float * in)
+{
+    return _mm256_shuffle_ps(_mm256_loadu_ps(in), _mm256_loadu_ps(in + 8),
+                             _MM_SHUFFLE(1, 0, 1, 0));
+}
+
+// store the four samples from hbf_load_even_avx() in order
+static HBF_INLINE void hbf_store_even_avx(float * out, __m256 v)
+{
+    __m256d     a = _mm256_castps_pd(v);
+    __m256d     b = _mm256_permute2f128_pd(a, a, 1);
+
+    a = _mm256_blend_pd(_mm256_unpacklo_pd(a, b), _mm256_unpackhi_pd(b, a),
+                        0xC);
+    _mm256_storeu_ps(out, _mm256_castpd_ps(a));
+}
+#endif
+
+#if defined(HBF_NEON)
+// in[0] and in[2] packed into one register
+static HBF_INLINE float32x4_t hbf_load_even_neon(const float * in)
+{
+    return vcombine_f32(vld1_f32(in), vld1_f32(in + 4));
+}
+#endif
+
+/*
+ * Decimate-by-2 stage using the LEN tap half band filter COEF.
+ *
+ * Only the even taps and the center tap of a half band filter are non-zero
+ * and the filter is symmetric, so the input samples sharing a coefficient
+ * are added before multiplying. The tap loop is unrolled at compile time
+ * with the coefficients as constants, and several output samples are
+ * calculated in parallel using SSE, AVX or NEON.
+ *
+ * Only the last LEN - 1 input samples are kept between calls. Output samples
+ * that need them are calculated from a small buffer holding the history and
+ * the beginning of the new block, the rest are filtered directly from the
+ * input block.
+ */
+template <int LEN, const real_t * COEF>
+class HalfBandDecimateBy2
+{
+    static_assert(hbf_check(COEF, LEN), "Not a 4n + 3 tap half band filter");
+
+public:
+    HalfBandDecimateBy2()
+    {
+        reset();
+    }
+
+    void    reset(void)
+    {
+        int     i;
+
+        for (i = 0; i < 2 * HIST; i++)
+        {
+            hist[i].re = 0.0;
+            hist[i].im = 0.0;
+        }
+        phase = 0;
+    }
+
+    int     taps(void) const
+    {
+        return LEN;
+    }
+
+    size_t  memory(void) const
+    {
+        return sizeof(*this);
+    }
+
+    /*
+     * Decimate InLength samples from pInData into pOutData, which may be the
+     * same buffer. InLength may be odd, in which case the next block starts
+     * half way between two output samples.
+     *
+     * Returns the number of output samples.
+     */
+    int     DecBy2(int InLength, const complex_t * pInData,
+                   complex_t * pOutData);
+
+private:
+    enum
+    {
+        HIST = LEN - 1,             // history length
+        CENTER = (LEN - 1) / 2,     // index of the center tap
+        FOLD = (LEN + 1) / 4        // number of symmetric tap pairs
+    };
+
+    static void     filter(int num, const complex_t * in, complex_t * out);
+
+    // HIST history samples followed by HIST new samples
+    complex_t   hist[2 * HIST];
+    // output samples depending on data that may be overwritten
+    complex_t   tmp[HIST];
+    // index of the newest input sample of the next output, 0 or 1
+    int         phase;
+};
+
+/*
+ * The output samples have their newest input sample at phase, phase + 2,
+ * phase + 4 and so on. The first (LEN - 1) / 2 output samples need history
+ * and are calculated from hist, the rest directly from the input block.
+ *
+ * When filtering in place the output samples written by the first
+ * (LEN - 1) / 2 steps from the input block would overwrite input that is
+ * still needed. These go to tmp together with the ones using history and
+ * are copied to the output at the end.
+ */
+template <int LEN, const real_t * COEF>
+int HalfBandDecimateBy2<LEN, COEF>::DecBy2(int InLength,
+                                           const complex_t * pInData,
+                                           complex_t * pOutData)
+{
+    int     numoutsamples = (InLength - phase + 1) / 2;
+    int     numtmp;
+    int     i;
+
+    if (numoutsamples < 0)
+        numoutsamples = 0;
+
+    // short blocks are filtered from hist only
+    if (InLength < HIST)
+    {
+        for (i = 0; i < InLength; i++)
+            hist[HIST + i] = pInData[i];
+        filter(numoutsamples, &hist[phase], tmp);
+        for (i = 0; i < HIST; i++)
+            hist[i] = hist[InLength + i];
+        for (i = 0; i < numoutsamples; i++)
+            pOutData[i] = tmp[i];
+
+        phase += 2 * numoutsamples - InLength;
+        return numoutsamples;
+    }
+
+    numtmp = numoutsamples < HIST ? numoutsamples : HIST;
+
+    // history followed by the beginning of the new block
+    for (i = 0; i < HIST; i++)
+        hist[HIST + i] = pInData[i];
+    filter(HIST / 2, &hist[phase], tmp);
+    filter(numtmp - HIST / 2, &pInData[phase], &tmp[HIST / 2]);
+
+    // save the last LEN - 1 input samples before they are overwritten
+    for (i = 0; i < HIST; i++)
+        hist[i] = pInData[InLength - HIST + i];
+
+    if (numoutsamples > numtmp)
+        filter(numoutsamples - numtmp, &pInData[HIST + phase],
+               &pOutData[HIST]);
+
+    for (i = 0; i < numtmp; i++)
+        pOutData[i] = tmp[i];
+
+    phase += 2 * numoutsamples - InLength;
+    return numoutsamples;
+}
+
+/*
+ * Calculate num output samples from the 2 * num + LEN - 2 samples starting
+ * at in:
+ *
+ *   out[m] = sum(COEF[2t] * (in[2m + 2t] + in[2m + LEN - 1 - 2t]))
+ *            + COEF[CENTER] * in[2m + CENTER]
+ *
+ * The vector loops read the samples between the ones they use and one past
+ * the last one of each group, so the last output sample is always
+ * calculated by the scalar loop to stay inside the block.
+ */
+template <int LEN, const real_t * COEF>
+void HalfBandDecimateBy2<LEN, COEF>::filter(int num, const complex_t * in,
+                                            complex_t * out)
+{
+    int     m = 0;
+
+#if defined(HBF_AVX)
+    struct avx_tap
+    {
+        const float    *x;
+        __m256          acc0, acc1;
+
+        HBF_INLINE void operator()(int t)
+        {
+            const float    *f = x + 4 * t;
+            const float    *r = x + 2 * (LEN - 1 - 2 * t);
+            __m256          h = _mm256_set1_ps(COEF[2 * t]);
+
+            acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(h,
+                    _mm256_add_ps(hbf_load_even_avx(f),
+                                  hbf_load_even_avx(r))));
+            acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(h,
+                    _mm256_add_ps(hbf_load_even_avx(f + 16),
+                                  hbf_load_even_avx(r + 16))));
+        }
+    };
+
+    for (; m + 8 < num; m += 8)
+    {
+        avx_tap     k;
+        __m256      h = _mm256_set1_ps(COEF[CENTER]);
+
+        k.x = (const float *)&in[2 * m];
+        k.acc0 = _mm256_mul_ps(h, hbf_load_even_avx(k.x + 2 * CENTER));
+        k.acc1 = _mm256_mul_ps(h, hbf_load_even_avx(k.x + 2 * CENTER + 16));
+        hbf_unroll<FOLD>::run(k);
+        hbf_store_even_avx((float *)&out[m], k.acc0);
+        hbf_store_even_avx((float *)&out[m + 4], k.acc1);
+    }
+#endif
+
+#if defined(HBF_SSE)
+    struct sse_tap
+    {
+        const float    *x;
+        __m128          acc0, acc1;
+
+        HBF_INLINE void operator()(int t)
+        {
+            const float    *f = x + 4 * t;
+            const float    *r = x + 2 * (LEN - 1 - 2 * t);
+            __m128          h = _mm_set1_ps(COEF[2 * t]);
+
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(h,
+                    _mm_add_ps(hbf_load_even_sse(f), hbf_load_even_sse(r))));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(h,
+                    _mm_add_ps(hbf_load_even_sse(f + 8),
+                               hbf_load_even_sse(r + 8))));
+        }
+    };
+
+    for (; m + 4 < num; m += 4)
+    {
+        sse_tap     k;
+        __m128      h = _mm_set1_ps(COEF[CENTER]);
+
+        k.x = (const float *)&in[2 * m];
+        k.acc0 = _mm_mul_ps(h, hbf_load_even_sse(k.x + 2 * CENTER));
+        k.acc1 = _mm_mul_ps(h, hbf_load_even_sse(k.x + 2 * CENTER + 8));
+        hbf_unroll<FOLD>::run(k);
+        _mm_storeu_ps((float *)&out[m], k.acc0);
+        _mm_storeu_ps((float *)&out[m + 2], k.acc1);
+    }
+#elif defined(HBF_NEON)
+    struct neon_tap
+    {
+        const float    *x;
+        float32x4_t     acc0, acc1;
+
+        HBF_INLINE void operator()(int t)
+        {
+            const float    *f = x + 4 * t;
+            const float    *r = x + 2 * (LEN - 1 - 2 * t);
+
+            acc0 = vmlaq_n_f32(acc0, vaddq_f32(hbf_load_even_neon(f),
+                                               hbf_load_even_neon(r)),
+                               COEF[2 * t]);
+            acc1 = vmlaq_n_f32(acc1, vaddq_f32(hbf_load_even_neon(f + 8),
+                                               hbf_load_even_neon(r + 8)),
+                               COEF[2 * t]);
+        }
+    };
+
+    for (; m + 4 < num; m += 4)
+    {
+        neon_tap    k;
+
+        k.x = (const float *)&in[2 * m];
+        k.acc0 = vmulq_n_f32(hbf_load_even_neon(k.x + 2 * CENTER),
+                             COEF[CENTER]);
+        k.acc1 = vmulq_n_f32(hbf_load_even_neon(k.x + 2 * CENTER + 8),
+                             COEF[CENTER]);
+        hbf_unroll<FOLD>::run(k);
+        vst1q_f32((float *)&out[m], k.acc0);
+        vst1q_f32((float *)&out[m + 2], k.acc1);
+    }
+#endif
+
+    struct scalar_tap
+    {
+        const complex_t    *x;
+        complex_t           acc;
+
+        HBF_INLINE void operator()(int t)
+        {
+            acc.re += COEF[2 * t] * (x[2 * t].re + x[LEN - 1 - 2 * t].re);
+            acc.im += COEF[2 * t] * (x[2 * t].im + x[LEN - 1 - 2 * t].im);
+        }
+    };
+
+    for (; m < num; m++)
+    {
+        scalar_tap  k;
+
+        k.x = &in[2 * m];
+        k.acc.re = COEF[CENTER] * k.x[CENTER].re;
+        k.acc.im = COEF[CENTER] * k.x[CENTER].im;
+        hbf_unroll<FOLD>::run(k);
+        out[m] = k.acc;
+    }
+}
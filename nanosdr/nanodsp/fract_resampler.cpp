@@ -29,6 +29,17 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 #include <assert.h>
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE__) && !defined(USE_DOUBLE)
+#include <xmmintrin.h>
+#define FRACT_SSE
+#elif defined(__ARM_NEON) && !defined(USE_DOUBLE)
+#include <arm_neon.h>
+#define FRACT_NEON
+#endif
+
 #include "fract_resampler.h"
 
 
@@ -36,42 +47,85 @@
 // Lower value reduces alias free bandwidth
 #define SINC_PERIODS 28
 
-// Number of points in sinc table in each sample period
+// Number of filter phases in each sample period. The coefficients between
+// two phases are interpolated linearly.
 // Lower value increases noise floor
-#define SINC_PERIOD_PTS 10000   
+#define SINC_PHASES     256
+
+// Limits of the rational resampler. The filter is stretched by the
+// decimation, so FRACT_MAX_TAPS limits the decimation to about 18. Input
+// samples kept between calls, enough for either filter.
+#define FRACT_MAX_INTERP    512
+#define FRACT_MAX_TAPS      512
+#define FRACT_MAX_COEFS     32768
+#define FRACT_HIST          FRACT_MAX_TAPS
 
-#define SINC_LENGTH     ((SINC_PERIODS) * SINC_PERIOD_PTS + 1)
+// Relative error of the ratio of the rates accepted as exact
+#define FRACT_RATIO_TOL     2.5e-7
+
+#if SINC_PERIODS % 4
+#error "SINC_PERIODS must be a multiple of 4"
+#endif
 
 FractResampler::FractResampler()
 {
     sinc_table = 0;
     input_buffer = 0;
     max_input_length = 0;
+    rate = 1.0;
+    interp = 0;
+    decim = 0;
+    num_taps = SINC_PERIODS;
+    poly_coef = 0;
+    poly_size = 0;
+    phase = 0;
+    in_pos = 0;
 }
 
 FractResampler::~FractResampler()
 {
-    if (sinc_table)
-        delete sinc_table;
-    if (input_buffer)
-        delete input_buffer;
+    delete[] sinc_table;
+    delete[] input_buffer;
+    delete[] poly_coef;
+}
+
+/*
+ * Blackman-Harris windowed sinc of length taps at x, stretched by the factor
+ * stretch. The sinc is centered at taps / 2.
+ */
+static double windowed_sinc(double x, int taps, double stretch)
+{
+    double  window, fi;
+
+    window = (0.35875 -
+              0.48829 * cos(K_2PI * x / taps) +
+              0.14128 * cos(2.0 * K_2PI * x / taps) -
+              0.01168 * cos(3.0 * K_2PI * x / taps));
+
+    fi = K_PI * (x - taps / 2) / stretch;
+
+    return fi != 0.0 ? window * sin(fi) / fi : window;
 }
 
+/*
+ * Phase p of the table holds the windowed sinc at i + 1 - p / SINC_PHASES
+ * for taps i = 0 .. SINC_PERIODS - 1, which are applied to the input samples
+ * up to the output time. The extra last phase is the first one shifted by a
+ * tap, so every phase has a next one to interpolate towards.
+ */
 void FractResampler::init(int max_input)
 {
-    real_t  fi;
-    real_t  window;
-    int     i;
+    int     i, p;
 
     max_input_length = max_input;
 
     // ensure buffer has room for FIR wrap around
-    max_input += SINC_PERIODS;
+    max_input += FRACT_HIST;
 
     if (sinc_table == 0)
-        sinc_table = new real_t[SINC_LENGTH];
+        sinc_table = new real_t[(SINC_PHASES + 1) * SINC_PERIODS];
     if (input_buffer)
-        delete input_buffer;
+        delete[] input_buffer;
 
     input_buffer = new complex_t[max_input];
     for (i = 0; i < max_input; i++)
@@ -80,55 +134,302 @@ void FractResampler::init(int max_input)
         input_buffer[i].im = 0.0;
     }
 
-    for (i = 0; i < SINC_LENGTH; i++)
+    for (p = 0; p <= SINC_PHASES; p++)
+        for (i = 0; i < SINC_PERIODS; i++)
+            sinc_table[p * SINC_PERIODS + i] =
+                windowed_sinc(i + 1 - (double)p / SINC_PHASES, SINC_PERIODS,
+                              1.0);
+
+    float_time = 0.0;
+    phase = 0;
+    in_pos = 0;
+}
+
+void FractResampler::reset(void)
+{
+    int     i;
+
+    for (i = 0; i < FRACT_HIST; i++)
     {
-        // Blackman-Harris window
-        window = (0.35875 -
-                  0.48829 * MCOS((K_2PI * i) / (SINC_LENGTH - 1)) +
-                  0.14128 * MCOS((2.0 * K_2PI * i) / (SINC_LENGTH - 1)) -
-                  0.01168 * MCOS((3.0 * K_2PI * i) / (SINC_LENGTH - 1)));
-
-        fi = K_PI * (real_t)(i - SINC_LENGTH / 2) / (real_t) SINC_PERIOD_PTS;
-        if (i != SINC_LENGTH / 2)
-            sinc_table[i] = window * MSIN(fi) / fi;
-        else
-            sinc_table[i] = 1.0;
+        input_buffer[i].re = 0.0;
+        input_buffer[i].im = 0.0;
     }
 
     float_time = 0.0;
+    phase = 0;
+    in_pos = 0;
 }
 
-int FractResampler::resample(int input_length, real_t rate, complex_t * inbuf,
-                             complex_t * outbuf)
+/*
+ * Find L / M = ratio with L at most FRACT_MAX_INTERP from the continued
+ * fraction of ratio. Returns false if there is no such fraction.
+ */
+static bool find_ratio(double ratio, int * L, int * M)
+{
+    double  x = ratio;
+    double  a;
+    long    l0 = 0, l1 = 1;     // numerators of the last two convergents
+    long    m0 = 1, m1 = 0;     // denominators
+    long    l, m;
+
+    while (1)
+    {
+        a = floor(x);
+        l = (long)a * l1 + l0;
+        m = (long)a * m1 + m0;
+        if (l > FRACT_MAX_INTERP || m > FRACT_MAX_INTERP * FRACT_MAX_TAPS)
+            return false;
+
+        if (fabs((double)l / m - ratio) <= FRACT_RATIO_TOL * ratio)
+        {
+            *L = l;
+            *M = m;
+            return true;
+        }
+
+        l0 = l1;
+        l1 = l;
+        m0 = m1;
+        m1 = m;
+        if (x - a < 1.e-12)
+            return false;
+        x = 1.0 / (x - a);
+    }
+}
+
+/*
+ * The rational filter has L phases of num_taps taps. It is the sinc of
+ * SINC_PERIODS zero crossings stretched by M / L when decimating, so the
+ * cutoff is at the lower of the two Nyquist frequencies. Each phase is
+ * normalized to unity gain at DC.
+ */
+bool FractResampler::set_rates(real_t input_rate, real_t output_rate)
+{
+    double  stretch, sum;
+    int     L, M, taps;
+    int     i, p;
+
+    rate = input_rate / output_rate;
+    interp = 0;
+    decim = 0;
+    num_taps = SINC_PERIODS;
+    float_time = 0.0;
+    phase = 0;
+    in_pos = 0;
+
+    if (!find_ratio((double)output_rate / (double)input_rate, &L, &M))
+        return false;
+
+    stretch = M > L ? (double)M / L : 1.0;
+    taps = ((int)ceil(SINC_PERIODS * stretch) + 3) & ~3;
+    if (taps > FRACT_MAX_TAPS || L * taps > FRACT_MAX_COEFS)
+        return false;
+
+    if (L * taps > poly_size)
+    {
+        delete[] poly_coef;
+        poly_size = L * taps;
+        poly_coef = new real_t[poly_size];
+    }
+
+    for (p = 0; p < L; p++)
+    {
+        sum = 0.0;
+        for (i = 0; i < taps; i++)
+            sum += windowed_sinc(i + 1 - (double)p / L, taps, stretch);
+        for (i = 0; i < taps; i++)
+            poly_coef[p * taps + i] =
+                windowed_sinc(i + 1 - (double)p / L, taps, stretch) / sum;
+    }
+
+    interp = L;
+    decim = M;
+    num_taps = taps;
+
+    return true;
+}
+
+/*
+ * Filter SINC_PERIODS samples starting at in with the coefficients
+ * interpolated between the phases h0 and h1 by a.
+ */
+static inline void filter(const complex_t * in, const real_t * h0,
+                          const real_t * h1, real_t a, complex_t * out)
+{
+    const real_t   *x = (const real_t *)in;
+    int             i;
+
+#if defined(FRACT_SSE)
+    __m128      va = _mm_set1_ps(a);
+    __m128      acc0 = _mm_setzero_ps();
+    __m128      acc1 = _mm_setzero_ps();
+    __m128      h;
+    float       sum[4];
+
+    for (i = 0; i < SINC_PERIODS; i += 4)
+    {
+        h = _mm_loadu_ps(&h0[i]);
+        h = _mm_add_ps(h, _mm_mul_ps(va, _mm_sub_ps(_mm_loadu_ps(&h1[i]),
+                                                     h)));
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_unpacklo_ps(h, h),
+                                           _mm_loadu_ps(&x[2 * i])));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_unpackhi_ps(h, h),
+                                           _mm_loadu_ps(&x[2 * i + 4])));
+    }
+    _mm_storeu_ps(sum, _mm_add_ps(acc0, acc1));
+    out->re = sum[0] + sum[2];
+    out->im = sum[1] + sum[3];
+#elif defined(FRACT_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    float32x4_t h;
+    float32x4x2_t hh;
+    float32x2_t sum;
+
+    for (i = 0; i < SINC_PERIODS; i += 4)
+    {
+        h = vld1q_f32(&h0[i]);
+        h = vmlaq_n_f32(h, vsubq_f32(vld1q_f32(&h1[i]), h), a);
+        hh = vzipq_f32(h, h);
+        acc0 = vmlaq_f32(acc0, hh.val[0], vld1q_f32(&x[2 * i]));
+        acc1 = vmlaq_f32(acc1, hh.val[1], vld1q_f32(&x[2 * i + 4]));
+    }
+    acc0 = vaddq_f32(acc0, acc1);
+    sum = vadd_f32(vget_low_f32(acc0), vget_high_f32(acc0));
+    out->re = vget_lane_f32(sum, 0);
+    out->im = vget_lane_f32(sum, 1);
+#else
+    real_t      re = 0.0;
+    real_t      im = 0.0;
+    real_t      h;
+
+    for (i = 0; i < SINC_PERIODS; i++)
+    {
+        h = h0[i] + a * (h1[i] - h0[i]);
+        re += h * x[2 * i];
+        im += h * x[2 * i + 1];
+    }
+    out->re = re;
+    out->im = im;
+#endif
+}
+
+/* Filter taps samples starting at in with the coefficients h. */
+static inline void filter(const complex_t * in, const real_t * h, int taps,
+                          complex_t * out)
+{
+    const real_t   *x = (const real_t *)in;
+    int             i;
+
+#if defined(FRACT_SSE)
+    __m128      acc0 = _mm_setzero_ps();
+    __m128      acc1 = _mm_setzero_ps();
+    __m128      hv;
+    float       sum[4];
+
+    for (i = 0; i < taps; i += 4)
+    {
+        hv = _mm_loadu_ps(&h[i]);
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_unpacklo_ps(hv, hv),
+                                           _mm_loadu_ps(&x[2 * i])));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_unpackhi_ps(hv, hv),
+                                           _mm_loadu_ps(&x[2 * i + 4])));
+    }
+    _mm_storeu_ps(sum, _mm_add_ps(acc0, acc1));
+    out->re = sum[0] + sum[2];
+    out->im = sum[1] + sum[3];
+#elif defined(FRACT_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    float32x4x2_t hh;
+    float32x2_t sum;
+
+    for (i = 0; i < taps; i += 4)
+    {
+        hh = vzipq_f32(vld1q_f32(&h[i]), vld1q_f32(&h[i]));
+        acc0 = vmlaq_f32(acc0, hh.val[0], vld1q_f32(&x[2 * i]));
+        acc1 = vmlaq_f32(acc1, hh.val[1], vld1q_f32(&x[2 * i + 4]));
+    }
+    acc0 = vaddq_f32(acc0, acc1);
+    sum = vadd_f32(vget_low_f32(acc0), vget_high_f32(acc0));
+    out->re = vget_lane_f32(sum, 0);
+    out->im = vget_lane_f32(sum, 1);
+#else
+    real_t      re = 0.0;
+    real_t      im = 0.0;
+
+    for (i = 0; i < taps; i++)
+    {
+        re += h[i] * x[2 * i];
+        im += h[i] * x[2 * i + 1];
+    }
+    out->re = re;
+    out->im = im;
+#endif
+}
+
+/*
+ * Output k is taken at k * M / L input samples. The phase counts the
+ * fraction in steps of 1 / L, so the output times are exact and the
+ * sequence of phases repeats after L outputs.
+ *
+ * The output goes to cplx_out, or the I part of it to real_out if cplx_out
+ * is NULL.
+ */
+int FractResampler::rational(int input_length, complex_t * cplx_out,
+                             real_t * real_out)
 {
+    const complex_t    *in = &input_buffer[FRACT_HIST - num_taps + 1];
     complex_t   acc;
-    int     i, j;
-    int     integer_time;
     int     output_samples = 0;
 
-    assert(input_length <= max_input_length);
+    while (in_pos < input_length)
+    {
+        filter(&in[in_pos], &poly_coef[phase * num_taps], num_taps, &acc);
+        if (cplx_out)
+            cplx_out[output_samples++] = acc;
+        else
+            real_out[output_samples++] = acc.re;
 
-    j = SINC_PERIODS;
-    for (i = 0; i < input_length; i++)
-        input_buffer[j++] = inbuf[i];
+        phase += decim;
+        in_pos += phase / interp;
+        phase %= interp;
+    }
+    in_pos -= input_length;
+
+    return output_samples;
+}
+
+/* Fractional resampling with the interpolated sinc table, see rational() */
+int FractResampler::fractional(int input_length, real_t rate,
+                               complex_t * cplx_out, real_t * real_out)
+{
+    const complex_t    *in = &input_buffer[FRACT_HIST - SINC_PERIODS + 1];
+    complex_t   acc;
+    real_t  pos, a;
+    int     integer_time;
+    int     output_samples = 0;
+    int     p;
 
     // calculate output samples by looping until end of input buffer is reached;
     // the output position is incremented in fractional time of input sample time
     integer_time = (int)float_time;
     while (integer_time < input_length)
     {
-        // convolution of sinc with input samples;
-        // sinc function is centered at the output fractional time position
-        acc.re = 0.0;
-        acc.im = 0.0;
-        for (i = 1; i <= SINC_PERIODS; i++)
-        {
-            j = integer_time + i;
-            int sindx = (int)(((real_t)j - float_time) * (real_t)SINC_PERIOD_PTS);
-            acc.re += (input_buffer[j].re * sinc_table[sindx]);
-            acc.im += (input_buffer[j].im * sinc_table[sindx]);
-        }
-        outbuf[output_samples++] = acc;
+        // the sinc function is centered at the output fractional time
+        // position, which is between two phases of the table
+        pos = (float_time - (real_t)integer_time) * (real_t)SINC_PHASES;
+        p = (int)pos;
+        if (p >= SINC_PHASES)
+            p = SINC_PHASES - 1;
+        a = pos - (real_t)p;
+
+        filter(&in[integer_time], &sinc_table[p * SINC_PERIODS],
+               &sinc_table[(p + 1) * SINC_PERIODS], a, &acc);
+        if (cplx_out)
+            cplx_out[output_samples++] = acc;
+        else
+            real_out[output_samples++] = acc.re;
 
         // time increment is the resampling rate
         float_time += rate;
@@ -136,54 +437,90 @@ int FractResampler::resample(int input_length, real_t rate, complex_t * inbuf,
     }
     float_time -= (real_t)input_length;
 
-    // keep last SINC_PERIODS input samples (FIR wrap)
-    j = input_length;
-    for (i = 0; i < SINC_PERIODS; i++)
-        input_buffer[i] = input_buffer[j++];
+    return output_samples;
+}
+
+int FractResampler::resample(int input_length, real_t rate, complex_t * inbuf,
+                             complex_t * outbuf)
+{
+    int     output_samples;
+
+    assert(input_length <= max_input_length);
+
+    memcpy(&input_buffer[FRACT_HIST], inbuf, input_length * sizeof(complex_t));
+    output_samples = fractional(input_length, rate, outbuf, NULL);
+
+    // keep last FRACT_HIST input samples (FIR wrap)
+    memmove(input_buffer, &input_buffer[input_length],
+            FRACT_HIST * sizeof(complex_t));
 
     return output_samples;
 }
 
+/*
+ * The real samples are filtered as the I part of complex samples. The Q
+ * part costs nothing extra in the vector code and is ignored.
+ */
 int FractResampler::resample(int input_length, real_t rate, real_t * inbuf,
                              real_t * outbuf)
 {
-    real_t  acc;
-    int     i, j;
-    int     integer_time;       // integer input time accumulator
-    int     output_samples = 0;
+    int     output_samples;
+    int     i;
 
     assert(input_length <= max_input_length);
 
-    j = SINC_PERIODS;
     for (i = 0; i < input_length; i++)
-        input_buffer[j++].re = inbuf[i];
+        input_buffer[FRACT_HIST + i].re = inbuf[i];
 
-    // calculate output samples by looping until end of input buffer is reached;
-    // the output position is incremented in fractional time of input sample time
-    integer_time = (int)float_time;
-    while (integer_time < input_length)
-    {
-        // convolution of sinc with input samples;
-        // sinc function is centered at the output fractional time position
-        acc = 0.0;
-        for (i = 1; i <= SINC_PERIODS; i++)
-        {
-            j = integer_time + i;
-            int sindx = (int)(((real_t)j - float_time) * (real_t)SINC_PERIOD_PTS);
-            acc += (input_buffer[j].re * sinc_table[sindx]);
-        }
-        outbuf[output_samples++] = acc;
+    output_samples = fractional(input_length, rate, NULL, outbuf);
 
-        // time increment is the resampling rate
-        float_time += rate;
-        integer_time = (int)float_time;
-    }
-    float_time -= (real_t)input_length;
+    // keep last FRACT_HIST input samples (FIR wrap)
+    for (i = 0; i < FRACT_HIST; i++)
+        input_buffer[i].re = input_buffer[input_length + i].re;
 
-    // keep last SINC_PERIODS input samples (FIR wrap)
-    j = input_length;
-    for (i = 0; i < SINC_PERIODS; i++)
-        input_buffer[i].re = input_buffer[j++].re;
+    return output_samples;
+}
+
+int FractResampler::resample(int input_length, complex_t * inbuf,
+                             complex_t * outbuf)
+{
+    int     output_samples;
+
+    if (!interp)
+        return resample(input_length, rate, inbuf, outbuf);
+
+    assert(input_length <= max_input_length);
+
+    memcpy(&input_buffer[FRACT_HIST], inbuf, input_length * sizeof(complex_t));
+    output_samples = rational(input_length, outbuf, NULL);
+    memmove(input_buffer, &input_buffer[input_length],
+            FRACT_HIST * sizeof(complex_t));
+
+    return output_samples;
+}
+
+int FractResampler::resample(int input_length, real_t * inbuf,
+                             real_t * outbuf)
+{
+    int     output_samples;
+    int     i;
+
+    if (!interp)
+        return resample(input_length, rate, inbuf, outbuf);
+
+    assert(input_length <= max_input_length);
+
+    for (i = 0; i < input_length; i++)
+        input_buffer[FRACT_HIST + i].re = inbuf[i];
+
+    output_samples = rational(input_length, NULL, outbuf);
+    for (i = 0; i < FRACT_HIST; i++)
+        input_buffer[i].re = input_buffer[input_length + i].re;
 
     return output_samples;
 }
+
+real_t FractResampler::delay(void) const
+{
+    return 0.5 * num_taps;
+}
@@ -17,10 +17,43 @@ public:
 	int     resample(int input_length, real_t rate, real_t * inbuf, real_t * outbuf);
 	int     resample(int input_length, real_t rate, complex_t * inbuf, complex_t * outbuf);
 
+	/*
+	 * Set the rates used by the resample() functions without a rate. When
+	 * the output rate is L / M times the input rate with L up to 512, the
+	 * output is calculated with an L phase filter at exact output times.
+	 * When decimating, the filter is widened to cut off at the output
+	 * Nyquist frequency. Other ratios use the fractional resampler.
+	 *
+	 * Returns true if the rational resampler is used.
+	 */
+	bool    set_rates(real_t input_rate, real_t output_rate);
+	int     resample(int input_length, real_t * inbuf, real_t * outbuf);
+	int     resample(int input_length, complex_t * inbuf, complex_t * outbuf);
+
+	/* Delay of the current filter in input samples */
+	real_t  delay(void) const;
+
+	/* Clear the input history and restart the output timing */
+	void    reset(void);
+
 private:
+	int     rational(int input_length, complex_t * cplx_out, real_t * real_out);
+	int     fractional(int input_length, real_t rate, complex_t * cplx_out,
+	                   real_t * real_out);
+
 	real_t      float_time;     // output time accumulator
-	real_t     *sinc_table;     // pointer to sinc table
+	real_t     *sinc_table;     // SINC_PERIODS taps for each phase
 	complex_t  *input_buffer;   // sample buffer
 
     int         max_input_length;
+
+    // rational resampler, interp is 0 when not in use
+    real_t      rate;           // input_rate / output_rate of set_rates()
+    int         interp;         // L
+    int         decim;          // M
+    int         num_taps;       // taps of each phase
+    real_t     *poly_coef;      // num_taps coefficients for each phase
+    int         poly_size;      // allocated size of poly_coef
+    int         phase;          // phase of the next output
+    int         in_pos;         // input sample of the next output
 };
@@ -0,0 +1,159 @@
+/*
+ * Digital down converter for real input sampled at 4x the IF.
+ *
+ * Copyright 2019  Alexandru Csete OZ9AEC
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdint.h>
+#include <string.h>
+
+#include "common/datatypes.h"
+#include "real_ddc.h"
+
+// number of output samples processed per chunk
+#define DDC_CHUNK       4096
+
+// DC blocker time constant in chunks
+#define DC_ALPHA        0.05f
+
+RealDdc::RealDdc()
+{
+    q_taps = 0;
+    num_taps = 0;
+    i_delay = 0;
+    i_buf = 0;
+    q_buf = 0;
+    scale = 1.0;
+    dc = 0.0;
+    sign = 1.0;
+}
+
+RealDdc::~RealDdc()
+{
+    free_buffers();
+}
+
+void RealDdc::free_buffers(void)
+{
+    delete[] q_taps;
+    delete[] i_buf;
+    delete[] q_buf;
+    q_taps = 0;
+    i_buf = 0;
+    q_buf = 0;
+    num_taps = 0;
+}
+
+int RealDdc::init(int len, const real_t * coef, real_t _scale)
+{
+    int         i;
+
+    if (len < 3 || (len + 1) % 4 != 0)
+        return -1;
+
+    free_buffers();
+
+    num_taps = (len + 1) / 2;
+    i_delay = num_taps / 2 - 1;
+    scale = _scale;
+
+    // odd taps are coef[0], coef[2], ...; the 2x gain compensates for the
+    // image removed by the filter so that a real tone and the resulting
+    // complex tone have the same amplitude
+    q_taps = new real_t[num_taps];
+    for (i = 0; i < num_taps; i++)
+        q_taps[i] = 2.0 * coef[2 * i];
+
+    i_buf = new real_t[i_delay + DDC_CHUNK];
+    q_buf = new real_t[num_taps - 1 + DDC_CHUNK];
+
+    reset();
+
+    return 0;
+}
+
+void RealDdc::reset(void)
+{
+    if (i_buf)
+        memset(i_buf, 0, i_delay * sizeof(real_t));
+    if (q_buf)
+        memset(q_buf, 0, (num_taps - 1) * sizeof(real_t));
+
+    dc = 0.0;
+    sign = 1.0;
+}
+
+int RealDdc::process(int num, const int16_t * input, complex_t * output)
+{
+    real_t     *in_i, *in_q;
+    real_t      acc;
+    real_t      sum;
+    int         num_out = num / 2;
+    int         done;
+    int         n;
+    int         i, j;
+
+    if (!q_taps)
+        return 0;
+
+    for (done = 0; done < num_out; done += n)
+    {
+        n = num_out - done;
+        if (n > DDC_CHUNK)
+            n = DDC_CHUNK;
+
+        // translate by fs/4: even samples go to I, odd samples to Q and
+        // every other pair is negated
+        in_i = &i_buf[i_delay];
+        in_q = &q_buf[num_taps - 1];
+        sum = 0.0;
+        for (i = 0; i < n; i++)
+        {
+            real_t  x0 = input[2 * (done + i)];
+            real_t  x1 = input[2 * (done + i) + 1];
+
+            sum += x0 + x1;
+            in_i[i] = sign * (x0 - dc) * scale;
+            in_q[i] = sign * (x1 - dc) * scale;
+            sign = -sign;
+        }
+        dc += DC_ALPHA * (sum / (2 * n) - dc);
+
+        // I is the delayed center tap, Q the odd taps
+        for (i = 0; i < n; i++)
+        {
+            acc = 0.0;
+            for (j = 0; j < num_taps; j++)
+                acc += q_taps[j] * in_q[i - j];
+
+            output[done + i].re = i_buf[i];
+            output[done + i].im = acc;
+        }
+
+        memmove(i_buf, &i_buf[n], i_delay * sizeof(real_t));
+        memmove(q_buf, &q_buf[n], (num_taps - 1) * sizeof(real_t));
+    }
+
+    return num_out;
+}
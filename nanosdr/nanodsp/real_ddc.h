@@ -0,0 +1,65 @@
+/*
+ * Digital down converter for real input sampled at 4x the IF.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include "common/datatypes.h"
+
+/*
+ * Class for converting real samples to complex baseband.
+ *
+ * The input is a real signal with the band of interest centered at fs/4,
+ * e.g. the IF output of the Airspy ADC. The signal is translated by fs/4,
+ * low pass filtered with a half band filter and decimated by 2, giving
+ * complex samples at fs/2.
+ *
+ * Because the mixer sequence is 1, j, -1, -j the even input samples only
+ * contribute to I and the odd samples only to Q. The center tap is the
+ * only non-zero even tap of a half band filter, so I is a plain delay and
+ * Q is a FIR filter using the odd taps. This costs (len + 1) / 4 MACs per
+ * input sample.
+ *
+ * The mixer translates -fs/4 to DC, i.e. the spectrum is inverted the same
+ * way as in libairspy. A slow DC blocker removes the ADC offset, which
+ * would otherwise appear at the band edge.
+ */
+class RealDdc
+{
+public:
+    RealDdc();
+    virtual    ~RealDdc();
+
+    /*
+     * Initialize the DDC with a half band filter. The filter length must be
+     * of the form 4 * n - 1, e.g. the filters in filter/filtercoef_hbf_*.h.
+     * scale is applied to the input samples, e.g. 1 / 32768.
+     *
+     * Returns 0 on success, -1 if the filter is not usable.
+     */
+    int         init(int len, const real_t * coef, real_t scale);
+
+    /* Clear the filter state and the DC estimate. */
+    void        reset(void);
+
+    /*
+     * Process num real input samples and write num / 2 complex samples to
+     * output. num should be even; an odd last sample is ignored.
+     *
+     * Returns the number of output samples.
+     */
+    int         process(int num, const int16_t * input, complex_t * output);
+
+private:
+    void        free_buffers(void);
+
+    real_t     *q_taps;     // odd half band taps scaled by 2
+    int         num_taps;   // number of odd taps
+    int         i_delay;    // delay of the I path
+    real_t     *i_buf;      // I history followed by new samples
+    real_t     *q_buf;      // Q history followed by new samples
+    real_t      scale;
+    real_t      dc;         // DC estimate in input units
+    real_t      sign;       // mixer sign for the next sample pair
+};
@@ -0,0 +1,7 @@
+g++ -Wall -Wextra -O3 -I../.. -o test_real_ddc test_real_ddc.cpp ../real_ddc.cpp
+g++ -Wall -Wextra -O3 -I../.. -o test_translate test_translate.cpp ../translate.cpp
+g++ -Wall -Wextra -O3 -I../.. -o test_decimator test_decimator.cpp ../filter/cic_decim.cpp ../filter/decimator.cpp ../filter/fir_decim.cpp ../translate.cpp
+g++ -Wall -Wextra -O3 -I../.. -o test_fastfir test_fastfir.cpp ../cute_fft.cpp ../fastfir.cpp ../fft_backend.cpp ../kiss_fft.c -ldl
+g++ -Wall -Wextra -O3 -I../.. -o test_cute_fft test_cute_fft.cpp ../cute_fft.cpp
+g++ -Wall -Wextra -O3 -I../.. -o test_fft_backend test_fft_backend.cpp ../cute_fft.cpp ../fft_backend.cpp ../kiss_fft.c -ldl
+g++ -Wall -Wextra -O3 -I../.. -o test_fract_resampler test_fract_resampler.cpp ../fract_resampler.cpp
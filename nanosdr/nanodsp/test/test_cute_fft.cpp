@@ -0,0 +1,260 @@
+/*
+ * CuteFft test
+ *
+ * Compares the forward and reverse transforms with a direct DFT for power of
+ * 2 and mixed radix sizes with and without the SIMD kernels, and checks the
+ * supported sizes. Prints the time per transform for both.
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../cute_fft.h"
+
+#ifdef USE_DOUBLE
+#define MAX_ERR         1.e-9
+#else
+#define MAX_ERR         1.e-4
+#endif
+
+static int failed = 0;
+static int passed = 0;
+
+
+static void test_int(const char *string, int var, int value)
+{
+    fprintf(stderr, "%s %d (exp: %d) ... ", string, var, value);
+
+    if (var == value)
+    {
+        passed++;
+        fprintf(stderr, "PASSED\n");
+    }
+    else
+    {
+        failed++;
+        fprintf(stderr, "FAILED\n");
+    }
+}
+
+static double time_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1.e-9 * ts.tv_nsec;
+}
+
+/*
+ * Transform noise of the given size in both directions and compare with a
+ * direct DFT. fwd_fft() uses exp(+j...) and rev_fft() exp(-j...), neither
+ * is scaled. Returns the number of bins off by more than MAX_ERR relative
+ * to the size.
+ */
+static int test_size(int size, bool simd)
+{
+    CuteFft     fft;
+    complex_t  *in, *out;
+    double      re, im, arg;
+    int         dir, i, k;
+    int         errors = 0;
+
+    fft.set_simd(simd);
+    fft.setup(size);
+    if (fft.get_size() != size)
+        return size;
+
+    in = new complex_t[size];
+    out = new complex_t[size];
+
+    for (dir = 1; dir >= -1; dir -= 2)
+    {
+        for (i = 0; i < size; i++)
+        {
+            in[i].re = out[i].re = rand() / (real_t)RAND_MAX - 0.5;
+            in[i].im = out[i].im = rand() / (real_t)RAND_MAX - 0.5;
+        }
+
+        if (dir > 0)
+            fft.fwd_fft(out);
+        else
+            fft.rev_fft(out);
+
+        for (k = 0; k < size; k++)
+        {
+            re = im = 0.0;
+            for (i = 0; i < size; i++)
+            {
+                arg = dir * 2.0 * M_PI * (double)((int64_t)i * k % size) /
+                      size;
+                re += in[i].re * cos(arg) - in[i].im * sin(arg);
+                im += in[i].re * sin(arg) + in[i].im * cos(arg);
+            }
+            if (fabs(re - out[k].re) > MAX_ERR * sqrt(size) ||
+                fabs(im - out[k].im) > MAX_ERR * sqrt(size))
+                errors++;
+        }
+    }
+
+    delete[] in;
+    delete[] out;
+
+    return errors;
+}
+
+/*
+ * Compare the SIMD kernels with the scalar code for sizes too large for the
+ * DFT. Returns the number of bins off by more than MAX_ERR relative to the
+ * size.
+ */
+static int test_simd(int size)
+{
+    CuteFft     simd, scalar;
+    complex_t  *a, *b;
+    double      tol = MAX_ERR * sqrt(size);
+    int         dir, i;
+    int         errors = 0;
+
+    simd.setup(size);
+    scalar.set_simd(false);
+    scalar.setup(size);
+
+    a = new complex_t[size];
+    b = new complex_t[size];
+
+    for (dir = 1; dir >= -1; dir -= 2)
+    {
+        for (i = 0; i < size; i++)
+        {
+            a[i].re = b[i].re = rand() / (real_t)RAND_MAX - 0.5;
+            a[i].im = b[i].im = rand() / (real_t)RAND_MAX - 0.5;
+        }
+
+        if (dir > 0)
+        {
+            simd.fwd_fft(a);
+            scalar.fwd_fft(b);
+        }
+        else
+        {
+            simd.rev_fft(a);
+            scalar.rev_fft(b);
+        }
+
+        for (i = 0; i < size; i++)
+            if (fabs(a[i].re - b[i].re) > tol ||
+                fabs(a[i].im - b[i].im) > tol)
+                errors++;
+    }
+
+    delete[] a;
+    delete[] b;
+
+    return errors;
+}
+
+/* Time per transform in ns */
+static double bench(int size, bool simd)
+{
+    CuteFft     fft;
+    complex_t  *buf;
+    double      start;
+    int         i, k, n;
+
+    fft.set_simd(simd);
+    fft.setup(size);
+    buf = new complex_t[size];
+    for (i = 0; i < size; i++)
+    {
+        buf[i].re = rand() / (real_t)RAND_MAX - 0.5;
+        buf[i].im = rand() / (real_t)RAND_MAX - 0.5;
+    }
+
+    // scaling after each pair keeps the data from overflowing
+    n = 1 + 10000000 / size;
+    start = time_now();
+    for (i = 0; i < n; i++)
+    {
+        fft.fwd_fft(buf);
+        fft.rev_fft(buf);
+        for (k = 0; k < size; k++)
+        {
+            buf[k].re *= 1.0 / size;
+            buf[k].im *= 1.0 / size;
+        }
+    }
+
+    delete[] buf;
+
+    return 1.e9 * (time_now() - start) / (2 * n);
+}
+
+int main(void)
+{
+    static const int pow2[] = { 16, 32, 64, 128, 256, 1024, 2048, 8192 };
+    static const int mixed[] = { 18, 20, 45, 60, 120, 240, 480, 960, 1920,
+                                 3840, 1000, 1536, 2025 };
+    CuteFft     fft;
+    char        str[64];
+    unsigned int    i;
+
+    srand(1);
+
+    /* test 1 */
+    fprintf(stderr, "\nTEST 1 - Power of 2 sizes match the DFT\n");
+    for (i = 0; i < sizeof(pow2) / sizeof(pow2[0]); i++)
+    {
+        snprintf(str, sizeof(str), "    Errors (size %d):", pow2[i]);
+        test_int(str, test_size(pow2[i], true), 0);
+        snprintf(str, sizeof(str), "    Errors (size %d, scalar):",
+                 pow2[i]);
+        test_int(str, test_size(pow2[i], false), 0);
+    }
+
+    /* test 2 */
+    fprintf(stderr, "\nTEST 2 - Mixed radix sizes match the DFT\n");
+    for (i = 0; i < sizeof(mixed) / sizeof(mixed[0]); i++)
+    {
+        snprintf(str, sizeof(str), "    Errors (size %d):", mixed[i]);
+        test_int(str, test_size(mixed[i], true), 0);
+        snprintf(str, sizeof(str), "    Errors (size %d, scalar):",
+                 mixed[i]);
+        test_int(str, test_size(mixed[i], false), 0);
+    }
+
+    /* test 3 */
+    fprintf(stderr, "\nTEST 3 - Supported sizes\n");
+    test_int("    Size 960 valid:", CuteFft::valid_size(960), 1);
+    test_int("    Size 1022 valid:", CuteFft::valid_size(1022), 0);
+    test_int("    Size 8 valid:", CuteFft::valid_size(8), 0);
+    test_int("    Next size from 7:", CuteFft::next_size(7), MIN_FFT_SIZE);
+    test_int("    Next size from 961:", CuteFft::next_size(961), 972);
+    test_int("    Next size from 1021:", CuteFft::next_size(1021), 1024);
+    test_int("    Next size above max:", CuteFft::next_size(MAX_FFT_SIZE + 1),
+             MAX_FFT_SIZE);
+
+    /* test 4 */
+    fprintf(stderr, "\nTEST 4 - SIMD kernels match the scalar code\n");
+    for (i = 512; i <= MAX_FFT_SIZE; i *= 2)
+    {
+        snprintf(str, sizeof(str), "    Errors (size %d):", i);
+        test_int(str, test_simd(i), 0);
+    }
+
+    fprintf(stderr, "\n  Size     scalar ns  %9s ns\n", fft.simd_name());
+    for (i = 512; i <= MAX_FFT_SIZE; i *= 2)
+        fprintf(stderr, "  %5d  %12.0f  %12.0f\n", i, bench(i, false),
+                bench(i, true));
+    for (i = 0; i < sizeof(mixed) / sizeof(mixed[0]); i++)
+        if (mixed[i] >= 960 && mixed[i] <= 3840)
+            fprintf(stderr, "  %5d  %12.0f  %12.0f\n", mixed[i],
+                    bench(mixed[i], false), bench(mixed[i], true));
+
+    fprintf(stderr, "\nTest summary:\n");
+    fprintf(stderr, "    Passed: %d\n", passed);
+    fprintf(stderr, "    Failed: %d\n\n", failed);
+
+    return failed ? 1 : 0;
+}
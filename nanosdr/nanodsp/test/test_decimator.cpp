@@ -0,0 +1,502 @@
+/*
+ * Decimator test
+ *
+ * Compares the half band decimators with a direct form FIR reference and the
+ * fused translate + decimate path with running Translate and Decimator as
+ * separate passes.
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../filter/decimator.h"
+#include "../filter/filtercoef_hbf_70.h"
+#include "../filter/filtercoef_hbf_100.h"
+#include "../filter/filtercoef_hbf_140.h"
+#include "../filter/half_band.h"
+#include "../translate.h"
+
+#define SAMPLE_RATE     10.e6
+#define NCO_FREQ        -1234567.0
+#define BLOCK_SIZE      16384
+#define NUM_BLOCKS      50
+#define TONE_SAMPLES    2000000
+
+static int failed = 0;
+static int passed = 0;
+
+
+static void test_int(const char *string, int var, int value)
+{
+    fprintf(stderr, "%s %d (exp: %d) ... ", string, var, value);
+
+    if (var == value)
+    {
+        passed++;
+        fprintf(stderr, "PASSED\n");
+    }
+    else
+    {
+        failed++;
+        fprintf(stderr, "FAILED\n");
+    }
+}
+
+static double time_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1.e-9 * ts.tv_nsec;
+}
+
+static void make_noise(complex_t *buf, int num)
+{
+    int     i;
+
+    for (i = 0; i < num; i++)
+    {
+        buf[i].re = (real_t)rand() / RAND_MAX - 0.5;
+        buf[i].im = (real_t)rand() / RAND_MAX - 0.5;
+    }
+}
+
+/* number of samples differing by more than tol */
+static int compare(const complex_t *a, const complex_t *b, int num, real_t tol)
+{
+    int     errors = 0;
+    int     i;
+
+    for (i = 0; i < num; i++)
+        if (fabs(a[i].re - b[i].re) > tol || fabs(a[i].im - b[i].im) > tol)
+            errors++;
+
+    return errors;
+}
+
+/*
+ * Decimate noise, reset and decimate a block. Returns the number of output
+ * samples differing from a new decimator given the same block.
+ */
+static int test_reset(unsigned int decimation, unsigned int att,
+                      unsigned int interp = 1)
+{
+    Decimator   dec, ref;
+    complex_t  *in = new complex_t[2 * BLOCK_SIZE];
+    complex_t  *out = new complex_t[BLOCK_SIZE];
+    complex_t  *ref_out = new complex_t[BLOCK_SIZE];
+    int         n, errors;
+
+    if (interp > 1)
+    {
+        dec.init_rate(decimation, interp, att);
+        ref.init_rate(decimation, interp, att);
+    }
+    else
+    {
+        dec.init(decimation, att);
+        ref.init(decimation, att);
+    }
+
+    make_noise(in, 2 * BLOCK_SIZE);
+    dec.process(BLOCK_SIZE, in, out);
+    dec.reset();
+    n = dec.process(BLOCK_SIZE, &in[BLOCK_SIZE], out);
+    errors = abs(n - ref.process(BLOCK_SIZE, &in[BLOCK_SIZE], ref_out));
+    errors += compare(out, ref_out, n, 0.0);
+
+    delete[] in;
+    delete[] out;
+    delete[] ref_out;
+
+    return errors;
+}
+
+/* decimate-by-2 Decimator with the same interface as the stages */
+class Decimator2
+{
+public:
+    Decimator2(unsigned int att)
+    {
+        dec.init(2, att);
+    }
+
+    int DecBy2(int num, const complex_t *input, complex_t *output)
+    {
+        return dec.process(num, input, output);
+    }
+
+private:
+    Decimator   dec;
+};
+
+/*
+ * Compare a decimate by 2 stage with a direct form FIR using all taps of
+ * coef. Blocks of different lengths are used to exercise the vector loops
+ * and the scalar tail, every other block is decimated in place.
+ */
+template <class Dec>
+static int test_half_band(Dec &dec, const real_t *coef, int len)
+{
+    complex_t  *in, *out;
+    complex_t   acc;
+    int         total = 0;
+    int         errors = 0;
+    int         block, b, i, k, n, m;
+
+    in = new complex_t[NUM_BLOCKS * BLOCK_SIZE];
+    out = new complex_t[BLOCK_SIZE];
+    make_noise(in, NUM_BLOCKS * BLOCK_SIZE);
+
+    for (b = 0; b < NUM_BLOCKS; b++)
+    {
+        block = (b % 3) ? BLOCK_SIZE - 2 * (b % 7) : len + 1;
+        if (b % 2)
+        {
+            n = dec.DecBy2(block, &in[total], out);
+        }
+        else
+        {
+            memcpy(out, &in[total], block * sizeof(complex_t));
+            n = dec.DecBy2(block, out, out);
+        }
+        if (n != block / 2)
+            errors++;
+
+        for (m = 0; m < n; m++)
+        {
+            acc.re = 0.0;
+            acc.im = 0.0;
+            for (k = 0; k < len; k++)
+            {
+                i = total + 2 * m + k - (len - 1);
+                if (i < 0)
+                    continue;
+                acc.re += coef[k] * in[i].re;
+                acc.im += coef[k] * in[i].im;
+            }
+            if (fabs(acc.re - out[m].re) > 1.e-6 ||
+                fabs(acc.im - out[m].im) > 1.e-6)
+                errors++;
+        }
+        total += block;
+    }
+
+    delete[] in;
+    delete[] out;
+
+    return errors;
+}
+
+/*
+ * Resample a complex tone at freq (relative to the input rate) by
+ * interp / decimation in blocks of varying length and return the output
+ * level in dB. The first quarter of the output is skipped to let the
+ * filters settle.
+ */
+static double tone_level(unsigned int decimation, unsigned int interp,
+                         unsigned int att, double freq)
+{
+    Decimator   dec;
+    complex_t  *buf;
+    double      phase = 0.0;
+    double      power = 0.0;
+    int         total = 0;
+    int         num_in = 0;
+    int         block, i, n, m;
+    int         num_out = 0;
+    unsigned int    seed = 1;
+
+    buf = new complex_t[8192];
+    if (interp > 1)
+        dec.init_rate(decimation, interp, att);
+    else
+        dec.init(decimation, att);
+
+    while (num_in < TONE_SAMPLES)
+    {
+        block = 1 + rand_r(&seed) % 8000;
+        for (i = 0; i < block; i++)
+        {
+            buf[i].re = cos(phase);
+            buf[i].im = sin(phase);
+            phase += K_2PI * freq;
+            if (phase > K_2PI)
+                phase -= K_2PI;
+        }
+        num_in += block;
+
+        n = dec.process(block, buf);
+        for (m = 0; m < n; m++, total++)
+        {
+            if (total < (int)(TONE_SAMPLES / 4 * interp / decimation))
+                continue;
+            power += buf[m].re * buf[m].re + buf[m].im * buf[m].im;
+            num_out++;
+        }
+    }
+
+    delete[] buf;
+
+    return 10.0 * log10(power / num_out + 1.e-30);
+}
+
+/* check pass band gain and alias rejection for the given decimation */
+static int test_tones(unsigned int decimation, unsigned int att,
+                      unsigned int interp = 1)
+{
+    double      ratio = (double)interp / decimation;
+    double      pass, alias;
+    int         errors = 0;
+
+    // the alias tone must be below the input Nyquist frequency
+    pass = tone_level(decimation, interp, att, 0.3 * ratio);
+    alias = tone_level(decimation, interp, att,
+                       1.3 * ratio < 0.5 ? 1.3 * ratio : 0.7 * ratio);
+    fprintf(stderr, "  Decimation %u/%u: pass band %.4f dB, alias %.1f dB\n",
+            decimation, interp, pass, alias);
+
+    if (fabs(pass) > 0.01)
+        errors++;
+    if (alias > -(double)att + 10.0)
+        errors++;
+
+    return errors;
+}
+
+/* compare fused and separate processing for the given decimation */
+static int test_fused(unsigned int decimation, unsigned int att)
+{
+    Decimator   dec1, dec2;
+    Translate   nco1, nco2;
+    complex_t  *in, *ref, *out;
+    int         errors = 0;
+    int         n1, n2, b;
+
+    in = new complex_t[BLOCK_SIZE];
+    ref = new complex_t[BLOCK_SIZE];
+    out = new complex_t[BLOCK_SIZE];
+
+    dec1.init(decimation, att);
+    dec2.init(decimation, att);
+    nco1.set_sample_rate(SAMPLE_RATE);
+    nco1.set_nco_frequency(NCO_FREQ);
+    nco2.set_sample_rate(SAMPLE_RATE);
+    nco2.set_nco_frequency(NCO_FREQ);
+
+    for (b = 0; b < NUM_BLOCKS; b++)
+    {
+        make_noise(in, BLOCK_SIZE);
+
+        memcpy(ref, in, BLOCK_SIZE * sizeof(complex_t));
+        nco1.process(BLOCK_SIZE, ref);
+        n1 = dec1.process(BLOCK_SIZE, ref);
+
+        // fused, in place
+        memcpy(out, in, BLOCK_SIZE * sizeof(complex_t));
+        n2 = dec2.process(BLOCK_SIZE, out, out, nco2);
+
+        if (n1 != n2)
+            errors++;
+        else
+            errors += compare(ref, out, n1, 1.e-6);
+    }
+
+    delete[] in;
+    delete[] ref;
+    delete[] out;
+
+    return errors;
+}
+
+static double bench(unsigned int decimation, unsigned int att, bool fused)
+{
+    Decimator   dec;
+    Translate   nco;
+    complex_t  *buf = new complex_t[BLOCK_SIZE];
+    double      t0, t1;
+    int         i;
+
+    make_noise(buf, BLOCK_SIZE);
+    dec.init(decimation, att);
+    nco.set_sample_rate(SAMPLE_RATE);
+    nco.set_nco_frequency(NCO_FREQ);
+
+    t0 = time_now();
+    for (i = 0; i < 1000; i++)
+    {
+        if (fused)
+        {
+            dec.process(BLOCK_SIZE, buf, buf, nco);
+        }
+        else
+        {
+            nco.process(BLOCK_SIZE, buf);
+            dec.process(BLOCK_SIZE, buf);
+        }
+    }
+    t1 = time_now();
+
+    delete[] buf;
+
+    return 1.e-6 * 1000 * BLOCK_SIZE / (t1 - t0);
+}
+
+int main(void)
+{
+    /* test 1 */
+    fprintf(stderr, "\nTEST 1 - Fused translate and decimate\n");
+    test_int("    Errors (2, 70 dB):", test_fused(2, 70), 0);
+    test_int("    Errors (8, 100 dB):", test_fused(8, 100), 0);
+    test_int("    Errors (64, 140 dB):", test_fused(64, 140), 0);
+
+    fprintf(stderr, "  Decim 2 separate: %8.1f Msps\n", bench(2, 100, false));
+    fprintf(stderr, "  Decim 2 fused:    %8.1f Msps\n", bench(2, 100, true));
+    fprintf(stderr, "  Decim 16 separate:%8.1f Msps\n", bench(16, 100, false));
+    fprintf(stderr, "  Decim 16 fused:   %8.1f Msps\n", bench(16, 100, true));
+
+    /* test 2 */
+    fprintf(stderr, "\nTEST 2 - Half band filters match direct form FIR\n");
+    {
+        Decimator2  d70(70), d100(100), d140(140);
+
+        test_int("    Errors HBF_70_39:",
+                 test_half_band(d70, HBF_70_39, HBF_70_39_LENGTH), 0);
+        test_int("    Errors HBF_100_59:",
+                 test_half_band(d100, HBF_100_59, HBF_100_59_LENGTH), 0);
+        test_int("    Errors HBF_140_87:",
+                 test_half_band(d140, HBF_140_87, HBF_140_87_LENGTH), 0);
+    }
+    {
+        HalfBandDecimateBy2<HBF_70_11_LENGTH, HBF_70_11>    s70_11;
+        HalfBandDecimateBy2<HBF_100_19_LENGTH, HBF_100_19>  s100_19;
+        HalfBandDecimateBy2<HBF_140_15_LENGTH, HBF_140_15>  s140_15;
+        HalfBandDecimateBy2<HBF_140_27_LENGTH, HBF_140_27>  s140_27;
+
+        test_int("    Errors HBF_70_11:",
+                 test_half_band(s70_11, HBF_70_11, HBF_70_11_LENGTH), 0);
+        test_int("    Errors HBF_100_19:",
+                 test_half_band(s100_19, HBF_100_19, HBF_100_19_LENGTH), 0);
+        test_int("    Errors HBF_140_15:",
+                 test_half_band(s140_15, HBF_140_15, HBF_140_15_LENGTH), 0);
+        test_int("    Errors HBF_140_27:",
+                 test_half_band(s140_27, HBF_140_27, HBF_140_27_LENGTH), 0);
+    }
+
+    fprintf(stderr, "  HBF_70_39:        %8.1f Msps\n", bench(2, 70, false));
+    fprintf(stderr, "  HBF_100_59:       %8.1f Msps\n", bench(2, 100, false));
+    fprintf(stderr, "  HBF_140_87:       %8.1f Msps\n", bench(2, 140, false));
+
+    /* test 3 */
+    fprintf(stderr, "\nTEST 3 - Memory statistics\n");
+    {
+        Decimator::stage_stats  stats[MAX_STAGES];
+        Decimator               dec;
+        int                     i, n;
+
+        dec.init(64, 140);
+        n = dec.get_stats(stats);
+        test_int("    Number of stages:", n, 6);
+        test_int("    Last stage taps:", stats[n - 1].taps, HBF_140_87_LENGTH);
+        for (i = 0; i < n; i++)
+            fprintf(stderr, "  Stage %d: %2d taps, %5zu bytes\n", i,
+                    stats[i].taps, stats[i].memory);
+        test_int("    Total below 8 kB:", dec.memory_usage() < 8192, 1);
+    }
+
+    /* test 4 */
+    fprintf(stderr, "\nTEST 4 - Decimation plans\n");
+    {
+        Decimator::plan     p;
+        int                 i, hbf = 0;
+
+        test_int("    Plan 512, 140 dB:", Decimator::make_plan(512, 140, &p), 1);
+        for (i = 0; i < p.num_stages; i++)
+            hbf += p.stages[i].type == Decimator::STAGE_HBF;
+        test_int("    Half band stages:", hbf, 9);
+
+        test_int("    Plan 10, 100 dB:", Decimator::make_plan(10, 100, &p), 1);
+        Decimator::print_plan(&p, 10.e6);
+        test_int("    FIR first:", p.stages[0].type, Decimator::STAGE_FIR);
+        test_int("    FIR decimation:", p.stages[0].decim, 5);
+
+        test_int("    Plan 48, 100 dB:", Decimator::make_plan(48, 100, &p), 1);
+        Decimator::print_plan(&p, 2.4e6);
+        test_int("    Plan 1, 100 dB:", Decimator::make_plan(1, 100, &p), 0);
+    }
+
+    test_int("    Tones 10, 100 dB:", test_tones(10, 100), 0);
+    test_int("    Tones 48, 100 dB:", test_tones(48, 100), 0);
+    test_int("    Tones 6, 70 dB:", test_tones(6, 70), 0);
+    test_int("    Tones 64, 140 dB:", test_tones(64, 140), 0);
+
+    /* test 5 */
+    fprintf(stderr, "\nTEST 5 - CIC front end\n");
+    {
+        Decimator::plan     p;
+        Decimator           dec;
+
+        test_int("    Plan 4000, 100 dB:", Decimator::make_plan(4000, 100, &p),
+                 1);
+        Decimator::print_plan(&p, 20.e6);
+        test_int("    CIC first:", p.stages[0].type, Decimator::STAGE_CIC);
+        test_int("    Plan 4096, 140 dB:", Decimator::make_plan(4096, 140, &p),
+                 1);
+        test_int("    Init 8192, 100 dB:", dec.init(8192, 100), 1);
+    }
+
+    test_int("    Tones 1000, 100 dB:", test_tones(1000, 100), 0);
+    test_int("    Tones 4000, 100 dB:", test_tones(4000, 100), 0);
+    test_int("    Tones 4096, 140 dB:", test_tones(4096, 140), 0);
+
+    fprintf(stderr, "  Decim 1000 fused: %8.1f Msps\n", bench(1000, 100, true));
+    fprintf(stderr, "  Decim 4096 fused: %8.1f Msps\n", bench(4096, 100, true));
+
+    /* test 6 */
+    fprintf(stderr, "\nTEST 6 - Rational resampling\n");
+    {
+        Decimator::plan     p;
+        Decimator           dec;
+
+        test_int("    Plan 625/12, 100 dB:",
+                 Decimator::make_plan(625, 12, 100, &p), 1);
+        test_int("    Last stage interpolation:",
+                 p.stages[p.num_stages - 1].interp, 192);
+        test_int("    Plan 1/2, 100 dB:", Decimator::make_plan(1, 2, 100, &p),
+                 0);
+        test_int("    10 MHz to 192 kHz:",
+                 lrint(dec.init_rate(10.e6, 192.e3, 100)), 192000);
+        test_int("    2.4 MHz to 96 kHz:",
+                 lrint(dec.init_rate(2.4e6, 96.e3, 100)), 96000);
+    }
+    {
+        Decimator           dec;
+        complex_t           in[4] = { {1, 2}, {3, 4}, {5, 6}, {7, 8} };
+        complex_t           out[4] = { };
+
+        test_int("    96 kHz to 96 kHz:",
+                 lrint(dec.init_rate(96.e3, 96.e3, 100)), 96000);
+        test_int("    Pass through samples:", dec.process(4, in, out), 4);
+        test_int("    Pass through copies:", out[3].im == 8, 1);
+    }
+
+    test_int("    Tones 625/12, 100 dB:", test_tones(625, 100, 12), 0);
+    test_int("    Tones 64/3, 100 dB:", test_tones(64, 100, 3), 0);
+    test_int("    Tones 5/3, 70 dB:", test_tones(5, 70, 3), 0);
+
+    /* test 7 */
+    fprintf(stderr, "\nTEST 7 - Reset clears the history\n");
+    test_int("    Errors (8, 100 dB):", test_reset(8, 100), 0);
+    test_int("    Errors (12, 70 dB):", test_reset(12, 70), 0);
+    test_int("    Errors (1000, 100 dB):", test_reset(1000, 100), 0);
+    test_int("    Errors (625/12, 100 dB):", test_reset(625, 100, 12), 0);
+
+    fprintf(stderr, "\nTest summary:\n");
+    fprintf(stderr, "    Passed: %d\n", passed);
+    fprintf(stderr, "    Failed: %d\n\n", failed);
+
+    return failed ? 1 : 0;
+}
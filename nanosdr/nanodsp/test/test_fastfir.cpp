@@ -0,0 +1,406 @@
+/*
+ * FastFIR test
+ *
+ * Compares the output of the partitioned filter at each block size with a
+ * direct form convolution using the impulse response of the filter, and
+ * checks the latency and the response to a few tones.
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../fastfir.h"
+
+#define SAMPLE_RATE     48000.0
+#define IMPULSE_LEN     2048
+#define NUM_SAMPLES     20000
+#define MAX_CHUNK       700
+#define MAX_ERR         1.e-4
+
+static int failed = 0;
+static int passed = 0;
+
+
+static void test_int(const char *string, int var, int value)
+{
+    fprintf(stderr, "%s %d (exp: %d) ... ", string, var, value);
+
+    if (var == value)
+    {
+        passed++;
+        fprintf(stderr, "PASSED\n");
+    }
+    else
+    {
+        failed++;
+        fprintf(stderr, "FAILED\n");
+    }
+}
+
+static double time_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1.e-9 * ts.tv_nsec;
+}
+
+/*
+ * Run num samples through the filter in chunks of random size.
+ * Returns the number of output samples.
+ */
+static int run_filter(FastFIR &filter, int num, complex_t *in, complex_t *out)
+{
+    int     i = 0;
+    int     len;
+    int     n = 0;
+
+    while (i < num)
+    {
+        len = 1 + rand() % MAX_CHUNK;
+        if (len > num - i)
+            len = num - i;
+        n += filter.process(len, in + i, out + n);
+        i += len;
+    }
+
+    return n;
+}
+
+/*
+ * Filter noise with the given block size and compare with the direct form
+ * convolution. Returns the number of samples off by more than MAX_ERR.
+ */
+static int test_block(int block, real_t lo, real_t hi)
+{
+    FastFIR     filter;
+    complex_t  *imp, *in, *out;
+    double      acc_re, acc_im, err, max_err = 0.0;
+    int         i, k, n;
+    int         errors = 0;
+
+    imp = new complex_t[IMPULSE_LEN + FASTFIR_MAX_BLOCK];
+    in = new complex_t[NUM_SAMPLES];
+    out = new complex_t[NUM_SAMPLES + FASTFIR_MAX_BLOCK];
+
+    test_int("    Block size:", filter.set_block_size(block), block);
+    filter.setup(lo, hi, 0.0, SAMPLE_RATE);
+
+    // impulse response, which has passed through the filter at the end
+    n = (IMPULSE_LEN + block - 1) / block * block;
+    memset(in, 0, n * sizeof(complex_t));
+    in[0].re = 1.0;
+    test_int("    Impulse response length:", filter.process(n, in, imp), n);
+
+    srand(block);
+    for (i = 0; i < NUM_SAMPLES; i++)
+    {
+        in[i].re = (real_t)rand() / RAND_MAX - 0.5;
+        in[i].im = (real_t)rand() / RAND_MAX - 0.5;
+    }
+    n = run_filter(filter, NUM_SAMPLES, in, out);
+    test_int("    Output samples:", n, NUM_SAMPLES - NUM_SAMPLES % block);
+
+    for (i = 0; i < n; i++)
+    {
+        acc_re = 0.0;
+        acc_im = 0.0;
+        for (k = 0; k < IMPULSE_LEN && k <= i; k++)
+        {
+            acc_re += imp[k].re * in[i - k].re - imp[k].im * in[i - k].im;
+            acc_im += imp[k].re * in[i - k].im + imp[k].im * in[i - k].re;
+        }
+        err = fmax(fabs(acc_re - out[i].re), fabs(acc_im - out[i].im));
+        if (err > max_err)
+            max_err = err;
+        if (err > MAX_ERR)
+            errors++;
+    }
+    fprintf(stderr, "  Block %4d max error: %.2e\n", block, max_err);
+
+    delete[] imp;
+    delete[] in;
+    delete[] out;
+
+    return errors;
+}
+
+/* Level of a tone at freq in dB after the filter has settled. */
+static double tone_level(int block, real_t lo, real_t hi, real_t freq)
+{
+    FastFIR     filter;
+    complex_t  *in, *out;
+    double      pwr = 0.0;
+    int         i, n;
+
+    in = new complex_t[NUM_SAMPLES];
+    out = new complex_t[NUM_SAMPLES + FASTFIR_MAX_BLOCK];
+
+    filter.set_block_size(block);
+    filter.setup(lo, hi, 0.0, SAMPLE_RATE);
+    for (i = 0; i < NUM_SAMPLES; i++)
+    {
+        in[i].re = cos(2.0 * M_PI * freq * i / SAMPLE_RATE);
+        in[i].im = sin(2.0 * M_PI * freq * i / SAMPLE_RATE);
+    }
+    n = run_filter(filter, NUM_SAMPLES, in, out);
+    for (i = FASTFIR_MAX_TAPS; i < n; i++)
+        pwr += out[i].re * out[i].re + out[i].im * out[i].im;
+
+    delete[] in;
+    delete[] out;
+
+    return 10.0 * log10(pwr / (n - FASTFIR_MAX_TAPS));
+}
+
+/*
+ * Filter noise with and without decimation and compare with every decim'th
+ * sample of the full rate output. Returns the number of errors.
+ */
+static int test_decim(int block, int decim)
+{
+    FastFIR     full, dec;
+    complex_t  *in, *out_full, *out_dec;
+    double      err;
+    int         i, n_full, n_dec;
+    int         errors = 0;
+
+    in = new complex_t[NUM_SAMPLES];
+    out_full = new complex_t[NUM_SAMPLES + FASTFIR_MAX_BLOCK];
+    out_dec = new complex_t[NUM_SAMPLES + FASTFIR_MAX_BLOCK];
+
+    full.set_block_size(block);
+    full.setup(300.0, 2700.0, 0.0, SAMPLE_RATE);
+    dec.set_block_size(block);
+    dec.setup(300.0, 2700.0, 0.0, SAMPLE_RATE);
+    test_int("    Decimation:", dec.set_decimation(decim), decim);
+
+    srand(decim);
+    for (i = 0; i < NUM_SAMPLES; i++)
+    {
+        in[i].re = (real_t)rand() / RAND_MAX - 0.5;
+        in[i].im = (real_t)rand() / RAND_MAX - 0.5;
+    }
+    n_full = run_filter(full, NUM_SAMPLES, in, out_full);
+    n_dec = run_filter(dec, NUM_SAMPLES, in, out_dec);
+    test_int("    Output samples:", n_dec, n_full / decim);
+
+    for (i = 0; i < n_dec; i++)
+    {
+        err = fmax(fabs(out_dec[i].re - out_full[i * decim].re),
+                   fabs(out_dec[i].im - out_full[i * decim].im));
+        if (err > MAX_ERR)
+            errors++;
+    }
+
+    delete[] in;
+    delete[] out_full;
+    delete[] out_dec;
+
+    return errors;
+}
+
+/*
+ * Change the filter in the middle of a noise stream and compare the output
+ * after the change with the direct form convolution of the new filter with
+ * all of the input. Returns the number of errors.
+ */
+static int test_change(int block1, int block2, real_t lo, real_t hi)
+{
+    FastFIR     filter, ref;
+    complex_t  *imp, *in, *out;
+    double      acc_re, acc_im, err;
+    int         i, k, n, n1;
+    int         errors = 0;
+
+    imp = new complex_t[IMPULSE_LEN + FASTFIR_MAX_BLOCK];
+    in = new complex_t[NUM_SAMPLES];
+    out = new complex_t[NUM_SAMPLES + FASTFIR_MAX_BLOCK];
+
+    // impulse response of the second filter
+    ref.setup(lo, hi, 0.0, SAMPLE_RATE);
+    memset(in, 0, IMPULSE_LEN * sizeof(complex_t));
+    in[0].re = 1.0;
+    ref.process(IMPULSE_LEN, in, imp);
+
+    srand(block1 + block2);
+    for (i = 0; i < NUM_SAMPLES; i++)
+    {
+        in[i].re = (real_t)rand() / RAND_MAX - 0.5;
+        in[i].im = (real_t)rand() / RAND_MAX - 0.5;
+    }
+
+    filter.set_block_size(block1);
+    filter.setup(300.0, 2700.0, 0.0, SAMPLE_RATE);
+    n1 = run_filter(filter, NUM_SAMPLES / 2, in, out);
+    filter.set_block_size(block2);
+    filter.setup(lo, hi, 0.0, SAMPLE_RATE);
+    n = n1 + run_filter(filter, NUM_SAMPLES - NUM_SAMPLES / 2,
+                        in + NUM_SAMPLES / 2, out + n1);
+
+    for (i = n1; i < n; i++)
+    {
+        acc_re = 0.0;
+        acc_im = 0.0;
+        for (k = 0; k < IMPULSE_LEN && k <= i; k++)
+        {
+            acc_re += imp[k].re * in[i - k].re - imp[k].im * in[i - k].im;
+            acc_im += imp[k].re * in[i - k].im + imp[k].im * in[i - k].re;
+        }
+        err = fmax(fabs(acc_re - out[i].re), fabs(acc_im - out[i].im));
+        if (err > MAX_ERR)
+            errors++;
+    }
+
+    delete[] imp;
+    delete[] in;
+    delete[] out;
+
+    return errors;
+}
+
+static double bench(int block)
+{
+    FastFIR     filter;
+    complex_t  *in, *out;
+    double      t;
+    int         i;
+
+    in = new complex_t[NUM_SAMPLES];
+    out = new complex_t[NUM_SAMPLES + FASTFIR_MAX_BLOCK];
+    memset(in, 0, NUM_SAMPLES * sizeof(complex_t));
+
+    filter.set_block_size(block);
+    filter.setup(-1000.0, 1000.0, 0.0, SAMPLE_RATE);
+    t = time_now();
+    for (i = 0; i < 100; i++)
+        filter.process(NUM_SAMPLES, in, out);
+    t = time_now() - t;
+
+    delete[] in;
+    delete[] out;
+
+    return 100.0 * NUM_SAMPLES / t * 1.e-6;
+}
+
+int main(void)
+{
+    int     block;
+
+    /* test 1 */
+    fprintf(stderr, "\nTEST 1 - Partitioned filter matches direct form FIR\n");
+    for (block = FASTFIR_MIN_BLOCK; block <= FASTFIR_MAX_BLOCK; block *= 2)
+        test_int("    Errors:", test_block(block, 300.0, 2700.0), 0);
+    test_int("    Errors:", test_block(960, 300.0, 2700.0), 0);
+
+    /* test 2 */
+    fprintf(stderr, "\nTEST 2 - Block size and latency\n");
+    {
+        FastFIR     filter;
+        complex_t   in[FASTFIR_MIN_BLOCK], out[2 * FASTFIR_MIN_BLOCK];
+
+        memset(in, 0, sizeof(in));
+        test_int("    Default block size:", filter.get_block_size(),
+                 FASTFIR_MAX_BLOCK);
+        test_int("    Rounded block size:", filter.set_block_size(199), 192);
+        test_int("    Frame aligned block size:", filter.set_block_size(960),
+                 960);
+        filter.setup(-3000.0, 3000.0, 0.0, SAMPLE_RATE);
+        test_int("    Short filter block size:", filter.get_block_size(), 480);
+        filter.setup(-250.0, 250.0, 0.0, SAMPLE_RATE);
+        test_int("    Smallest block size:", filter.set_block_size(1),
+                 FASTFIR_MIN_BLOCK);
+        test_int("    Largest block size:", filter.set_block_size(100000),
+                 FASTFIR_MAX_BLOCK);
+        filter.set_block_size(FASTFIR_MIN_BLOCK);
+        test_int("    Output after one block:",
+                 filter.process(FASTFIR_MIN_BLOCK - 1, in, out) +
+                 filter.process(1, in, out), FASTFIR_MIN_BLOCK);
+    }
+
+    /* test 3 */
+    fprintf(stderr, "\nTEST 3 - Tone response\n");
+    for (block = FASTFIR_MIN_BLOCK; block <= FASTFIR_MAX_BLOCK; block *= 4)
+    {
+        test_int("    Pass band within 0.1 dB:",
+                 fabs(tone_level(block, -2000.0, 2000.0, 1000.0)) < 0.1, 1);
+        test_int("    Stop band below -100 dB:",
+                 tone_level(block, -2000.0, 2000.0, 3000.0) < -100.0, 1);
+        test_int("    Image below -100 dB:",
+                 tone_level(block, 300.0, 2700.0, -1500.0) < -100.0, 1);
+    }
+
+    /* test 4 */
+    fprintf(stderr, "\nTEST 4 - Filter length follows the bandwidth\n");
+    {
+        FastFIR     filter;
+
+        filter.setup(300.0, 2700.0, 0.0, SAMPLE_RATE);
+        test_int("    SSB taps at 48k:", filter.get_taps(), 1025);
+        test_int("    SSB block size at 48k:", filter.get_block_size(), 1024);
+        filter.setup(-5000.0, 5000.0, 0.0, SAMPLE_RATE);
+        test_int("    AM taps at 48k:", filter.get_taps(), 257);
+        test_int("    AM block size at 48k:", filter.get_block_size(), 256);
+        filter.setup(600.0, 800.0, 0.0, 4 * SAMPLE_RATE);
+        test_int("    CW taps at 192k:", filter.get_taps(), FASTFIR_MAX_TAPS);
+        test_int("    CW block size at 192k:", filter.get_block_size(),
+                 FASTFIR_MAX_BLOCK);
+    }
+    test_int("    AM stop band below -90 dB:",
+             tone_level(FASTFIR_MAX_BLOCK, -5000.0, 5000.0, 6600.0) < -90.0, 1);
+    test_int("    CW pass band within 0.1 dB:",
+             fabs(tone_level(FASTFIR_MAX_BLOCK, 600.0, 800.0, 700.0)) < 0.1, 1);
+    test_int("    CW stop band below -90 dB:",
+             tone_level(FASTFIR_MAX_BLOCK, 600.0, 800.0, 950.0) < -90.0, 1);
+
+    /* test 5 */
+    fprintf(stderr, "\nTEST 5 - Frequency domain decimation\n");
+    test_int("    Errors (block 1024, decim 8):", test_decim(1024, 8), 0);
+    test_int("    Errors (block 64, decim 4):", test_decim(64, 4), 0);
+    test_int("    Errors (block 960, decim 8):", test_decim(960, 8), 0);
+    {
+        FastFIR     filter;
+
+        filter.setup(300.0, 2700.0, 0.0, SAMPLE_RATE);
+        test_int("    SSB max decimation at 48k:", filter.max_decimation(), 8);
+        filter.setup(-5000.0, 5000.0, 0.0, SAMPLE_RATE);
+        test_int("    AM max decimation at 48k:", filter.max_decimation(), 4);
+        filter.setup(600.0, 800.0, 0.0, 4 * SAMPLE_RATE);
+        test_int("    CW max decimation at 192k:", filter.max_decimation(),
+                 FASTFIR_MAX_DECIM);
+        filter.set_block_size(FASTFIR_MIN_BLOCK);
+        test_int("    Decimation with small blocks:",
+                 filter.set_decimation(FASTFIR_MAX_DECIM),
+                 2 * FASTFIR_MIN_BLOCK / MIN_FFT_SIZE);
+        filter.set_block_size(120);
+        test_int("    Decimation with odd block factors:",
+                 filter.set_decimation(FASTFIR_MAX_DECIM), 8);
+        filter.set_block_size(675);
+        test_int("    Decimation with an odd block:",
+                 filter.set_decimation(2), 1);
+    }
+
+    /* test 6 */
+    fprintf(stderr, "\nTEST 6 - Filter changes keep the history\n");
+    test_int("    Errors (new cutoffs):",
+             test_change(1024, 1024, 200.0, 2500.0), 0);
+    test_int("    Errors (new block size):",
+             test_change(1024, 64, 300.0, 2700.0), 0);
+    test_int("    Errors (new length and block size):",
+             test_change(64, 1024, -3000.0, 3000.0), 0);
+    test_int("    Errors (frame aligned block size):",
+             test_change(1024, 960, -2000.0, 2000.0), 0);
+
+    for (block = FASTFIR_MIN_BLOCK; block <= FASTFIR_MAX_BLOCK; block *= 2)
+        fprintf(stderr, "  Block %4d: %8.1f Msps\n", block, bench(block));
+    fprintf(stderr, "  Block %4d: %8.1f Msps\n", 960, bench(960));
+
+    fprintf(stderr, "\nTest summary:\n");
+    fprintf(stderr, "    Passed: %d\n", passed);
+    fprintf(stderr, "    Failed: %d\n\n", failed);
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,198 @@
+/*
+ * FftBackend test
+ *
+ * Compares each available backend with a direct DFT, in place and out of
+ * place, and checks the choices made by create_best() and the cache file.
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../cute_fft.h"
+#include "../fft_backend.h"
+
+#ifdef USE_DOUBLE
+#define MAX_ERR         1.e-9
+#define CACHED_TYPE     FFT_BACKEND_CUTE    // kiss_fft is float only
+#else
+#define MAX_ERR         1.e-4
+#define CACHED_TYPE     FFT_BACKEND_KISS
+#endif
+
+#define CACHE_FILE      "/tmp/test_fft_backend.cache"
+
+static int failed = 0;
+static int passed = 0;
+
+
+static void test_int(const char *string, int var, int value)
+{
+    fprintf(stderr, "%s %d (exp: %d) ... ", string, var, value);
+
+    if (var == value)
+    {
+        passed++;
+        fprintf(stderr, "PASSED\n");
+    }
+    else
+    {
+        failed++;
+        fprintf(stderr, "FAILED\n");
+    }
+}
+
+/*
+ * Transform noise in both directions, in place and out of place, and compare
+ * with a direct DFT. Returns the number of bins off by more than MAX_ERR
+ * relative to the size.
+ */
+static int test_backend(FftBackend * fft)
+{
+    complex_t  *in, *out;
+    double      re, im, arg;
+    int         size = fft->get_size();
+    int         dir, inplace, i, k;
+    int         errors = 0;
+
+    in = new complex_t[size];
+    out = new complex_t[size];
+
+    for (dir = -1; dir <= 1; dir += 2)
+    {
+        for (inplace = 0; inplace < 2; inplace++)
+        {
+            for (i = 0; i < size; i++)
+            {
+                in[i].re = out[i].re = rand() / (real_t)RAND_MAX - 0.5;
+                in[i].im = out[i].im = rand() / (real_t)RAND_MAX - 0.5;
+            }
+
+            if (dir < 0)
+                fft->forward(inplace ? out : in, out);
+            else
+                fft->inverse(inplace ? out : in, out);
+
+            for (k = 0; k < size; k++)
+            {
+                re = im = 0.0;
+                for (i = 0; i < size; i++)
+                {
+                    arg = dir * 2.0 * M_PI *
+                          (double)((int64_t)i * k % size) / size;
+                    re += in[i].re * cos(arg) - in[i].im * sin(arg);
+                    im += in[i].re * sin(arg) + in[i].im * cos(arg);
+                }
+                if (fabs(re - out[k].re) > MAX_ERR * sqrt(size) ||
+                    fabs(im - out[k].im) > MAX_ERR * sqrt(size))
+                    errors++;
+            }
+        }
+    }
+
+    delete[] in;
+    delete[] out;
+
+    return errors;
+}
+
+/* Returns 1 if the cache file has a line for size */
+static int cache_has(int size)
+{
+    FILE   *file;
+    char    line[128];
+    char    name[32];
+    int     n, found = 0;
+
+    file = fopen(CACHE_FILE, "r");
+    if (file == NULL)
+        return 0;
+
+    while (fgets(line, sizeof(line), file))
+        if (sscanf(line, "%d %31s", &n, name) == 2 && n == size)
+            found = 1;
+    fclose(file);
+
+    return found;
+}
+
+int main(void)
+{
+    static const int sizes[] = { 16, 60, 128, 960, 1000, 1024 };
+    FftBackend *fft;
+    CuteFft     cute;
+    FILE       *file;
+    char        str[64];
+    unsigned int    i;
+    int         type;
+
+    srand(1);
+
+    /* test 1 */
+    fprintf(stderr, "\nTEST 1 - Backends match the DFT\n");
+    for (type = 0; type < FFT_BACKEND_NUM; type++)
+    {
+        for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+        {
+            fft = FftBackend::create(type, sizes[i]);
+            if (fft == NULL)
+            {
+                fprintf(stderr, "    %s: size %d not available\n",
+                        FftBackend::type_name(type), sizes[i]);
+                continue;
+            }
+            snprintf(str, sizeof(str), "    Errors (%s, size %d):",
+                     FftBackend::type_name(type), sizes[i]);
+            test_int(str, test_backend(fft), 0);
+            delete fft;
+        }
+    }
+
+    /* test 2 */
+    fprintf(stderr, "\nTEST 2 - Supported sizes\n");
+    fft = FftBackend::create(FFT_BACKEND_CUTE, 1022);
+    test_int("    Cute backend for 1022:", fft != NULL, 0);
+    delete fft;
+    fft = FftBackend::create(FFT_BACKEND_CUTE, 960);
+    test_int("    Cute backend for 960:", fft != NULL, 1);
+    delete fft;
+    test_int("    Unknown backend:",
+             FftBackend::create(FFT_BACKEND_NUM, 1024) != NULL, 0);
+
+    /* test 3 */
+    fprintf(stderr, "\nTEST 3 - Best backend\n");
+    remove(CACHE_FILE);
+    FftBackend::set_cache_file(CACHE_FILE);
+    fft = FftBackend::create_best(960);
+    test_int("    Best backend for 960:", fft != NULL, 1);
+    test_int("    Size:", fft ? fft->get_size() : 0, 960);
+    if (fft)
+        test_int("    Errors:", test_backend(fft), 0);
+    delete fft;
+    test_int("    Choice saved:", cache_has(960), 1);
+
+    /* test 4 */
+    fprintf(stderr, "\nTEST 4 - Choices are loaded from the cache file\n");
+    file = fopen(CACHE_FILE, "w");
+    if (file)
+    {
+        fprintf(file, "# nanodsp fft backends v1 %s %d\n", cute.simd_name(),
+                (int)sizeof(real_t));
+        fprintf(file, "2000 %s\n", FftBackend::type_name(CACHED_TYPE));
+        fclose(file);
+    }
+    FftBackend::set_cache_file(CACHE_FILE);
+    fft = FftBackend::create_best(2000);
+    test_int("    Cached type for 2000:", fft ? fft->get_type() : -1,
+             CACHED_TYPE);
+    delete fft;
+    FftBackend::set_cache_file(NULL);
+    remove(CACHE_FILE);
+
+    fprintf(stderr, "\nTest summary:\n");
+    fprintf(stderr, "    Passed: %d\n", passed);
+    fprintf(stderr, "    Failed: %d\n\n", failed);
+
+    return failed ? 1 : 0;
+}
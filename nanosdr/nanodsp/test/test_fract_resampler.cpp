@@ -0,0 +1,316 @@
+/*
+ * FractResampler test
+ *
+ * Resamples a tone at a few rates and compares the output with the ideal
+ * tone, which is delayed by half the sinc length. The output times are
+ * tracked with the same arithmetic as the resampler, so only the
+ * interpolation error is measured. The rational resampler is checked the
+ * same way against exact output times, and for aliasing when decimating.
+ * Prints the time per output sample.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../fract_resampler.h"
+
+#define BLOCK_LEN       1000
+#define NUM_BLOCKS      40
+#define DELAY           14      // SINC_PERIODS / 2
+
+static int failed = 0;
+static int passed = 0;
+
+
+static void test_int(const char *string, int var, int value)
+{
+    fprintf(stderr, "%s %d (exp: %d) ... ", string, var, value);
+
+    if (var == value)
+    {
+        passed++;
+        fprintf(stderr, "PASSED\n");
+    }
+    else
+    {
+        failed++;
+        fprintf(stderr, "FAILED\n");
+    }
+}
+
+static double time_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1.e-9 * ts.tv_nsec;
+}
+
+/*
+ * Resample a complex tone at freq relative to the input rate and return the
+ * error relative to the ideal output in dB. The output count is returned in
+ * num_out.
+ */
+static double test_complex(double rate, double freq, int * num_out)
+{
+    FractResampler  rs;
+    complex_t   in[BLOCK_LEN];
+    complex_t   out[2 * BLOCK_LEN];
+    double      err = 0.0, sig = 0.0;
+    double      t, re, im;
+    real_t      ft = 0.0;
+    int         b, i, n;
+    int         k = 0;
+
+    rs.init(BLOCK_LEN);
+    for (b = 0; b < NUM_BLOCKS; b++)
+    {
+        for (i = 0; i < BLOCK_LEN; i++)
+        {
+            t = K_2PI * freq * (b * BLOCK_LEN + i);
+            in[i].re = cos(t);
+            in[i].im = sin(t);
+        }
+
+        n = rs.resample(BLOCK_LEN, rate, in, out);
+        for (i = 0; i < n; i++, k++)
+        {
+            t = b * BLOCK_LEN + ft - DELAY;
+            ft += (real_t)rate;
+
+            // skip the start up transient
+            if (t < DELAY)
+                continue;
+            re = cos(K_2PI * freq * t);
+            im = sin(K_2PI * freq * t);
+            err += (out[i].re - re) * (out[i].re - re) +
+                   (out[i].im - im) * (out[i].im - im);
+            sig += re * re + im * im;
+        }
+        ft -= BLOCK_LEN;
+    }
+    *num_out = k;
+
+    return 10.0 * log10(err / sig);
+}
+
+/* Same as test_complex() for a real tone */
+static double test_real(double rate, double freq, int * num_out)
+{
+    FractResampler  rs;
+    real_t      in[BLOCK_LEN];
+    real_t      out[2 * BLOCK_LEN];
+    double      err = 0.0, sig = 0.0;
+    double      t, re;
+    real_t      ft = 0.0;
+    int         b, i, n;
+    int         k = 0;
+
+    rs.init(BLOCK_LEN);
+    for (b = 0; b < NUM_BLOCKS; b++)
+    {
+        for (i = 0; i < BLOCK_LEN; i++)
+            in[i] = cos(K_2PI * freq * (b * BLOCK_LEN + i));
+
+        n = rs.resample(BLOCK_LEN, rate, in, out);
+        for (i = 0; i < n; i++, k++)
+        {
+            t = b * BLOCK_LEN + ft - DELAY;
+            ft += (real_t)rate;
+            if (t < DELAY)
+                continue;
+            re = cos(K_2PI * freq * t);
+            err += (out[i] - re) * (out[i] - re);
+            sig += re * re;
+        }
+        ft -= BLOCK_LEN;
+    }
+    *num_out = k;
+
+    return 10.0 * log10(err / sig);
+}
+
+/*
+ * Resample a complex tone at freq Hz with set_rates() and return the error
+ * relative to the ideal output in dB, or the output power in dB if
+ * aliased is set.
+ */
+static double test_rational(real_t in_rate, real_t out_rate, double freq,
+                            bool aliased, int * num_out)
+{
+    FractResampler  rs;
+    complex_t   in[BLOCK_LEN];
+    complex_t   out[8 * BLOCK_LEN];
+    double      err = 0.0, sig = 0.0, pwr = 0.0;
+    double      t, re, im;
+    int         b, i, n;
+    int         k = 0;
+
+    rs.init(BLOCK_LEN);
+    rs.set_rates(in_rate, out_rate);
+    freq /= in_rate;
+    for (b = 0; b < NUM_BLOCKS; b++)
+    {
+        for (i = 0; i < BLOCK_LEN; i++)
+        {
+            t = K_2PI * freq * (b * BLOCK_LEN + i);
+            in[i].re = cos(t);
+            in[i].im = sin(t);
+        }
+
+        n = rs.resample(BLOCK_LEN, in, out);
+        for (i = 0; i < n; i++, k++)
+        {
+            t = (double)k * in_rate / out_rate - rs.delay();
+            if (t < rs.delay())
+                continue;
+            re = cos(K_2PI * freq * t);
+            im = sin(K_2PI * freq * t);
+            err += (out[i].re - re) * (out[i].re - re) +
+                   (out[i].im - im) * (out[i].im - im);
+            sig += re * re + im * im;
+            pwr += out[i].re * out[i].re + out[i].im * out[i].im;
+        }
+    }
+    *num_out = k;
+
+    return 10.0 * log10(aliased ? pwr / sig : err / sig);
+}
+
+/* Time per complex output sample in ns */
+static double bench(double rate, bool rational)
+{
+    FractResampler  rs;
+    complex_t   in[BLOCK_LEN];
+    complex_t   out[2 * BLOCK_LEN];
+    double      start;
+    int         i, n = 0;
+
+    rs.init(BLOCK_LEN);
+    if (rational)
+        rs.set_rates(rate, 1.0);
+    for (i = 0; i < BLOCK_LEN; i++)
+    {
+        in[i].re = rand() / (real_t)RAND_MAX - 0.5;
+        in[i].im = rand() / (real_t)RAND_MAX - 0.5;
+    }
+
+    start = time_now();
+    for (i = 0; i < 2000; i++)
+        n += rational ? rs.resample(BLOCK_LEN, in, out) :
+                        rs.resample(BLOCK_LEN, rate, in, out);
+
+    return 1.e9 * (time_now() - start) / n;
+}
+
+int main(void)
+{
+    static const double rates[] = { 48000.0 / 44100.0, 2.0, 0.75,
+                                    96000.0 / 8000.0 };
+    static const real_t pairs[][2] = {
+        { 96000, 48000 }, { 48000, 44100 }, { 96000, 44100 },
+        { 48000, 8000 }, { 48000, 16000 }, { 12000, 48000 },
+    };
+    FractResampler  rs;
+    char        str[80];
+    double      err;
+    unsigned int    i;
+    int         n, exp;
+
+    /* test 1 */
+    fprintf(stderr, "\nTEST 1 - Complex tone\n");
+    for (i = 0; i < sizeof(rates) / sizeof(rates[0]); i++)
+    {
+        err = test_complex(rates[i], 0.1 / fmax(rates[i], 1.0), &n);
+        exp = (int)ceil(NUM_BLOCKS * BLOCK_LEN / rates[i]);
+        fprintf(stderr, "    Rate %.4f: error %.1f dB\n", rates[i], err);
+        snprintf(str, sizeof(str), "    Error below -65 dB (rate %.4f):",
+                 rates[i]);
+        test_int(str, err < -65.0, 1);
+        // the last output may go either way with the rounding of the time
+        snprintf(str, sizeof(str), "    Output samples off by <= 1 (%d):", n);
+        test_int(str, abs(n - exp) <= 1, 1);
+    }
+
+    /* test 2 */
+    fprintf(stderr, "\nTEST 2 - Real tone\n");
+    for (i = 0; i < sizeof(rates) / sizeof(rates[0]); i++)
+    {
+        err = test_real(rates[i], 0.1 / fmax(rates[i], 1.0), &n);
+        fprintf(stderr, "    Rate %.4f: error %.1f dB\n", rates[i], err);
+        snprintf(str, sizeof(str), "    Error below -65 dB (rate %.4f):",
+                 rates[i]);
+        test_int(str, err < -65.0, 1);
+    }
+
+    /* test 3 */
+    fprintf(stderr, "\nTEST 3 - Rational ratios\n");
+    test_int("    96000 to 48000:", rs.set_rates(96000, 48000), 1);
+    test_int("    48000 to 44100:", rs.set_rates(48000, 44100), 1);
+    test_int("    62500 to 8000:", rs.set_rates(62500, 8000), 1);
+    test_int("    12000 to 48000:", rs.set_rates(12000, 48000), 1);
+    test_int("    48000 to 47123.45:", rs.set_rates(48000, 47123.45), 0);
+    test_int("    48000 to 2000:", rs.set_rates(48000, 2000), 0);
+
+    /* test 4 */
+    fprintf(stderr, "\nTEST 4 - Rational resampler\n");
+    for (i = 0; i < sizeof(pairs) / sizeof(pairs[0]); i++)
+    {
+        err = test_rational(pairs[i][0], pairs[i][1],
+                            0.1 * fmin(pairs[i][0], pairs[i][1]), false, &n);
+        exp = ceil(NUM_BLOCKS * BLOCK_LEN * pairs[i][1] / pairs[i][0]);
+        fprintf(stderr, "    %.0f to %.0f: error %.1f dB\n", pairs[i][0],
+                pairs[i][1], err);
+        snprintf(str, sizeof(str), "    Error below -90 dB (%.0f to %.0f):",
+                 pairs[i][0], pairs[i][1]);
+        test_int(str, err < -90.0, 1);
+        snprintf(str, sizeof(str), "    Output samples (%.0f to %.0f):",
+                 pairs[i][0], pairs[i][1]);
+        test_int(str, n, exp);
+    }
+
+    err = test_rational(48000, 8000, 6000, true, &n);
+    fprintf(stderr, "    6 kHz at 8 kHz output: %.1f dB\n", err);
+    test_int("    Alias below -80 dB:", err < -80.0, 1);
+
+    /* test 5 */
+    fprintf(stderr, "\nTEST 5 - Reset\n");
+    {
+        FractResampler  ref;
+        complex_t   in[BLOCK_LEN];
+        complex_t   out[BLOCK_LEN], ref_out[BLOCK_LEN];
+        int         errors = 0;
+
+        for (i = 0; i < BLOCK_LEN; i++)
+        {
+            in[i].re = rand() / (real_t)RAND_MAX - 0.5;
+            in[i].im = rand() / (real_t)RAND_MAX - 0.5;
+        }
+        rs.init(BLOCK_LEN);
+        rs.set_rates(96000, 48000);
+        ref.init(BLOCK_LEN);
+        ref.set_rates(96000, 48000);
+
+        rs.resample(BLOCK_LEN - 3, in, out);
+        rs.reset();
+        n = rs.resample(BLOCK_LEN, in, out);
+        test_int("    Output samples:", n,
+                 ref.resample(BLOCK_LEN, in, ref_out));
+        for (i = 0; i < (unsigned int)n; i++)
+            if (out[i].re != ref_out[i].re || out[i].im != ref_out[i].im)
+                errors++;
+        test_int("    Same as new resampler:", errors, 0);
+    }
+
+    fprintf(stderr, "\n  Rate       fractional ns    rational ns\n");
+    for (i = 0; i < sizeof(rates) / sizeof(rates[0]); i++)
+        fprintf(stderr, "  %7.4f  %14.1f  %13.1f\n", rates[i],
+                bench(rates[i], false), bench(rates[i], true));
+
+    fprintf(stderr, "\nTest summary:\n");
+    fprintf(stderr, "    Passed: %d\n", passed);
+    fprintf(stderr, "    Failed: %d\n\n", failed);
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,182 @@
+/*
+ * Real to complex DDC test
+ *
+ * Compares RealDdc against a direct implementation (mixer followed by the
+ * full half band filter) and checks the frequency and amplitude of a tone.
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../real_ddc.h"
+#include "../filter/filtercoef_hbf_70.h"
+#include "../filter/filtercoef_hbf_100.h"
+
+#define NUM_SAMPLES     20000       /* real input samples */
+#define SCALE           (1.0f / 32768.f)
+
+static int failed = 0;
+static int passed = 0;
+
+
+static void test_int(const char *string, int var, int value)
+{
+    fprintf(stderr, "%s %d (exp: %d) ... ", string, var, value);
+
+    if (var == value)
+    {
+        passed++;
+        fprintf(stderr, "PASSED\n");
+    }
+    else
+    {
+        failed++;
+        fprintf(stderr, "FAILED\n");
+    }
+}
+
+/* real tone at f (relative to the input rate) plus an optional offset */
+static void make_tone(int16_t *buf, int num, double f, double amp, int offs)
+{
+    int     i;
+
+    for (i = 0; i < num; i++)
+        buf[i] = (int16_t)lrint(amp * cos(2.0 * M_PI * f * i) + offs);
+}
+
+/*
+ * Number of output samples that differ from the reference by more than
+ * tol. The reference is y[n] = x[n] * j^n filtered by the full half band
+ * filter and decimated by 2, with twice the gain.
+ */
+static int compare_ref(const int16_t *in, const complex_t *out, int num_out,
+                       int len, const real_t *coef, real_t tol)
+{
+    int     delay = (len + 1) / 4 - 1;
+    int     half = (len - 1) / 2;
+    int     errors = 0;
+    int     m, k, n;
+
+    for (m = delay + len; m < num_out; m++)
+    {
+        double  re = 0.0, im = 0.0;
+
+        for (k = -half; k <= half; k++)
+        {
+            n = 2 * (m - delay) - k;
+            switch (n & 3)
+            {
+            case 0: re += coef[k + half] * in[n]; break;
+            case 1: im += coef[k + half] * in[n]; break;
+            case 2: re -= coef[k + half] * in[n]; break;
+            case 3: im -= coef[k + half] * in[n]; break;
+            }
+        }
+        re *= 2.0 * SCALE;
+        im *= 2.0 * SCALE;
+
+        if (fabs(re - out[m].re) > tol || fabs(im - out[m].im) > tol)
+            errors++;
+    }
+
+    return errors;
+}
+
+/* average frequency of a complex tone relative to the sample rate */
+static double tone_freq(const complex_t *z, int from, int to)
+{
+    double  re = 0.0, im = 0.0;
+    int     i;
+
+    for (i = from + 1; i < to; i++)
+    {
+        re += z[i].re * z[i - 1].re + z[i].im * z[i - 1].im;
+        im += z[i].im * z[i - 1].re - z[i].re * z[i - 1].im;
+    }
+
+    return atan2(im, re) / (2.0 * M_PI);
+}
+
+static double tone_amp(const complex_t *z, int from, int to)
+{
+    double  sum = 0.0;
+    int     i;
+
+    for (i = from; i < to; i++)
+        sum += sqrt(z[i].re * z[i].re + z[i].im * z[i].im);
+
+    return sum / (to - from);
+}
+
+int main(void)
+{
+    RealDdc     ddc;
+    int16_t    *in;
+    complex_t  *out;
+    int         n, i;
+    double      t0, t1;
+    struct timespec ts;
+
+    in = (int16_t *)malloc(NUM_SAMPLES * sizeof(int16_t));
+    out = (complex_t *)malloc(NUM_SAMPLES / 2 * sizeof(complex_t));
+
+    /* test 1 */
+    fprintf(stderr, "\nTEST 1 - Compare with direct implementation\n");
+    test_int("    Invalid filter length:", ddc.init(41, HBF_100_59, SCALE), -1);
+    test_int("    Init:", ddc.init(HBF_100_59_LENGTH, HBF_100_59, SCALE), 0);
+    make_tone(in, NUM_SAMPLES, 0.2, 3000.0, 0);
+    for (i = 0; i < NUM_SAMPLES; i++)
+        in[i] += (int16_t)(2000.0 * sin(2.0 * M_PI * 0.31 * i));
+    /* odd block sizes to test the state across calls */
+    n = ddc.process(1002, in, out);
+    n += ddc.process(NUM_SAMPLES - 1002, &in[1002], &out[n]);
+    test_int("    Output samples:", n, NUM_SAMPLES / 2);
+    test_int("    Errors (HBF_100_59):",
+             compare_ref(in, out, n, HBF_100_59_LENGTH, HBF_100_59, 1.e-4), 0);
+
+    ddc.init(HBF_70_11_LENGTH, HBF_70_11, SCALE);
+    n = ddc.process(NUM_SAMPLES, in, out);
+    test_int("    Errors (HBF_70_11):",
+             compare_ref(in, out, n, HBF_70_11_LENGTH, HBF_70_11, 1.e-4), 0);
+
+    /* test 2 */
+    fprintf(stderr, "\nTEST 2 - Tone frequency, amplitude and DC\n");
+    ddc.init(HBF_70_39_LENGTH, HBF_70_39, SCALE);
+
+    /* fs/4 - 0.05 fs -> +0.1 at the output rate, with ADC offset */
+    make_tone(in, NUM_SAMPLES, 0.20, 8192.0, 300);
+    for (i = 0; i < 20; i++)
+        n = ddc.process(NUM_SAMPLES, in, out);
+    test_int("    Frequency x 1000:",
+             (int)lrint(1000.0 * tone_freq(out, 100, n)), 100);
+    test_int("    Amplitude x 1000:",
+             (int)lrint(1000.0 * tone_amp(out, 100, n)), 250);
+
+    /* fs/4 + 0.05 fs -> -0.1 at the output rate */
+    make_tone(in, NUM_SAMPLES, 0.30, 8192.0, 0);
+    ddc.reset();
+    n = ddc.process(NUM_SAMPLES, in, out);
+    test_int("    Frequency x 1000:",
+             (int)lrint(1000.0 * tone_freq(out, 100, n)), -100);
+
+    /* speed */
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    t0 = ts.tv_sec + 1.e-9 * ts.tv_nsec;
+    for (i = 0; i < 500; i++)
+        ddc.process(NUM_SAMPLES, in, out);
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    t1 = ts.tv_sec + 1.e-9 * ts.tv_nsec;
+    fprintf(stderr, "  HBF_70_39: %.1f Msps real input\n",
+            1.e-6 * 500 * NUM_SAMPLES / (t1 - t0));
+
+    fprintf(stderr, "\nTest summary:\n");
+    fprintf(stderr, "    Passed: %d\n", passed);
+    fprintf(stderr, "    Failed: %d\n\n", failed);
+
+    free(in);
+    free(out);
+
+    return failed ? 1 : 0;
+}
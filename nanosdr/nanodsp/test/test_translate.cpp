@@ -0,0 +1,137 @@
+/*
+ * NCO / frequency translation test
+ *
+ * Runs Translate over a long stream of unit samples split into blocks of
+ * varying size and compares the output with an exact double precision
+ * oscillator.
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../translate.h"
+
+#define SAMPLE_RATE     10.e6
+#define NUM_SAMPLES     (10 * 1000 * 1000)
+#define BLOCK_SIZE      65536
+
+/* error bounds for single precision */
+#define MAX_PHASE_ERR   1.e-5   /* radians */
+#define MAX_AMP_ERR     1.e-5
+
+static int failed = 0;
+static int passed = 0;
+
+
+static void test_int(const char *string, int var, int value)
+{
+    fprintf(stderr, "%s %d (exp: %d) ... ", string, var, value);
+
+    if (var == value)
+    {
+        passed++;
+        fprintf(stderr, "PASSED\n");
+    }
+    else
+    {
+        failed++;
+        fprintf(stderr, "FAILED\n");
+    }
+}
+
+/*
+ * Translate NUM_SAMPLES samples of 1 + j0 by freq and check the phase and
+ * amplitude of every output sample. Returns the number of errors.
+ */
+static int test_freq(real_t freq)
+{
+    Translate   nco;
+    complex_t  *buf;
+    double      max_phase_err = 0.0;
+    double      max_amp_err = 0.0;
+    double      exp_phase, err;
+    long        n = 0;
+    int         len, i;
+    int         errors = 0;
+
+    buf = (complex_t *)malloc(BLOCK_SIZE * sizeof(complex_t));
+    nco.set_sample_rate(SAMPLE_RATE);
+    nco.set_nco_frequency(freq);
+
+    srand(1);
+    while (n < NUM_SAMPLES)
+    {
+        /* odd block sizes to test the state across calls */
+        len = 1 + rand() % BLOCK_SIZE;
+        for (i = 0; i < len; i++)
+        {
+            buf[i].re = 1.0;
+            buf[i].im = 0.0;
+        }
+
+        nco.process(len, buf);
+
+        for (i = 0; i < len; i++, n++)
+        {
+            exp_phase = fmod(2.0 * M_PI * freq / SAMPLE_RATE * n, 2.0 * M_PI);
+            err = fabs(remainder(atan2(buf[i].im, buf[i].re) - exp_phase,
+                                 2.0 * M_PI));
+            if (err > max_phase_err)
+                max_phase_err = err;
+
+            err = fabs(hypot(buf[i].re, buf[i].im) - 1.0);
+            if (err > max_amp_err)
+                max_amp_err = err;
+        }
+    }
+
+    fprintf(stderr, "  %10.2f Hz: max phase error %.2e rad, "
+            "max amplitude error %.2e\n", freq, max_phase_err, max_amp_err);
+
+    if (max_phase_err > MAX_PHASE_ERR)
+        errors++;
+    if (max_amp_err > MAX_AMP_ERR)
+        errors++;
+
+    free(buf);
+
+    return errors;
+}
+
+int main(void)
+{
+    Translate   nco;
+    complex_t  *buf;
+    double      t0, t1;
+    struct timespec ts;
+    int         i;
+
+    /* test 1 */
+    fprintf(stderr, "\nTEST 1 - Phase and amplitude error\n");
+    test_int("    Errors:", test_freq(0.0), 0);
+    test_int("    Errors:", test_freq(1234.5), 0);
+    test_int("    Errors:", test_freq(-2.5e6 + 0.25), 0);
+    test_int("    Errors:", test_freq(4.9999e6), 0);
+
+    /* speed */
+    buf = (complex_t *)calloc(BLOCK_SIZE, sizeof(complex_t));
+    nco.set_sample_rate(SAMPLE_RATE);
+    nco.set_nco_frequency(123456.0);
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    t0 = ts.tv_sec + 1.e-9 * ts.tv_nsec;
+    for (i = 0; i < 1000; i++)
+        nco.process(BLOCK_SIZE, buf);
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    t1 = ts.tv_sec + 1.e-9 * ts.tv_nsec;
+    fprintf(stderr, "  Translate: %.1f Msps\n",
+            1.e-6 * 1000 * BLOCK_SIZE / (t1 - t0));
+    free(buf);
+
+    fprintf(stderr, "\nTest summary:\n");
+    fprintf(stderr, "    Passed: %d\n", passed);
+    fprintf(stderr, "    Failed: %d\n\n", failed);
+
+    return failed ? 1 : 0;
+}
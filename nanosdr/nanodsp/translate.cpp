@@ -28,30 +28,47 @@
  * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
  * POSSIBILITY OF SUCH DAMAGE.
  */
+#include <math.h>
 #include <stdlib.h>
+
+#if defined(__SSE__) && !defined(USE_DOUBLE)
+#include <xmmintrin.h>
+#define TRANSLATE_SSE
+#elif defined(__ARM_NEON) && !defined(USE_DOUBLE)
+#include <arm_neon.h>
+#define TRANSLATE_NEON
+#endif
+
 #include "translate.h"
 
+// maximum number of samples between re-seeding the phasors
+#define NCO_SEGMENT     512
+
 
 Translate::Translate()
 {
     sample_rate = 96000.0;
     nco_freq = 0.0;
     cw_offset = 0.0;
-    nco_inc = 0.0;
-    osc_cos = 1.0;
-    osc_sin = 0.0;
-
-    osc1.re = 1.0;
-    osc1.im = 0.0;
+    nco_phase = 0.0;
+    set_nco_frequency(0.0);
 }
 
 
 void Translate::set_nco_frequency(real_t freq_hz)
 {
+    int     k;
+
     nco_freq = freq_hz + cw_offset;
-    nco_inc = K_2PI * nco_freq / sample_rate;
-    osc_cos = MCOS(nco_inc);
-    osc_sin = MSIN(nco_inc);
+    nco_inc = K_2PI * (double)nco_freq / (double)sample_rate;
+
+    for (k = 0; k < NCO_LANES; k++)
+    {
+        rot_re[k] = cos(k * nco_inc);
+        rot_im[k] = sin(k * nco_inc);
+    }
+    step_re = cos(NCO_LANES * nco_inc);
+    step_im = sin(NCO_LANES * nco_inc);
 }
 
 void Translate::set_cw_offset(real_t offset_hz)
@@ -73,25 +90,119 @@ void Translate::set_sample_rate(real_t rate)
 
 void Translate::process(int length, complex_t * data)
 {
-    complex_t  dtmp;
-    complex_t  osc;
-    real_t     osc_gn;
-    int        i;
+    process(length, data, data);
+}
+
+void Translate::process(int length, const complex_t * input,
+                        complex_t * output)
+{
+    int        n;
+
+    while (length > 0)
+    {
+        n = length < NCO_SEGMENT ? length : NCO_SEGMENT;
+        process_segment(n, input, output);
+
+        // advance the accumulator; the phasors are re-seeded from it
+        nco_phase = fmod(nco_phase + n * nco_inc, K_2PI);
+        input += n;
+        output += n;
+        length -= n;
+    }
+}
+
+/* Multiply input by e^(j*(nco_phase + i*nco_inc)) for i = 0..length-1 */
+void Translate::process_segment(int length, const complex_t * input,
+                                complex_t * output)
+{
+    real_t     seed_re = cos(nco_phase);
+    real_t     seed_im = sin(nco_phase);
+    real_t     p_re[NCO_LANES];
+    real_t     p_im[NCO_LANES];
+    real_t     tmp;
+    int        i = 0;
+    int        k;
+
+    for (k = 0; k < NCO_LANES; k++)
+    {
+        p_re[k] = seed_re * rot_re[k] - seed_im * rot_im[k];
+        p_im[k] = seed_re * rot_im[k] + seed_im * rot_re[k];
+    }
+
+#if defined(TRANSLATE_SSE)
+    {
+        __m128  pr = _mm_loadu_ps(p_re);
+        __m128  pi = _mm_loadu_ps(p_im);
+        __m128  sr = _mm_set1_ps(step_re);
+        __m128  si = _mm_set1_ps(step_im);
+        const float    *in = (const float *)input;
+        float          *out = (float *)output;
+
+        for (; i + NCO_LANES <= length; i += NCO_LANES)
+        {
+            __m128  a = _mm_loadu_ps(&in[2 * i]);
+            __m128  b = _mm_loadu_ps(&in[2 * i + 4]);
+            __m128  xr = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+            __m128  xi = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+            __m128  yr = _mm_sub_ps(_mm_mul_ps(xr, pr), _mm_mul_ps(xi, pi));
+            __m128  yi = _mm_add_ps(_mm_mul_ps(xr, pi), _mm_mul_ps(xi, pr));
+            __m128  t;
+
+            _mm_storeu_ps(&out[2 * i], _mm_unpacklo_ps(yr, yi));
+            _mm_storeu_ps(&out[2 * i + 4], _mm_unpackhi_ps(yr, yi));
+
+            t = _mm_sub_ps(_mm_mul_ps(pr, sr), _mm_mul_ps(pi, si));
+            pi = _mm_add_ps(_mm_mul_ps(pr, si), _mm_mul_ps(pi, sr));
+            pr = t;
+        }
+        _mm_storeu_ps(p_re, pr);
+        _mm_storeu_ps(p_im, pi);
+    }
+#elif defined(TRANSLATE_NEON)
+    {
+        float32x4_t pr = vld1q_f32(p_re);
+        float32x4_t pi = vld1q_f32(p_im);
+        const float    *in = (const float *)input;
+        float          *out = (float *)output;
+
+        for (; i + NCO_LANES <= length; i += NCO_LANES)
+        {
+            float32x4x2_t   x = vld2q_f32(&in[2 * i]);
+            float32x4x2_t   y;
+            float32x4_t     t;
+
+            y.val[0] = vmlsq_f32(vmulq_f32(x.val[0], pr), x.val[1], pi);
+            y.val[1] = vmlaq_f32(vmulq_f32(x.val[0], pi), x.val[1], pr);
+            vst2q_f32(&out[2 * i], y);
+
+            t = vmlsq_n_f32(vmulq_n_f32(pr, step_re), pi, step_im);
+            pi = vmlaq_n_f32(vmulq_n_f32(pr, step_im), pi, step_re);
+            pr = t;
+        }
+        vst1q_f32(p_re, pr);
+        vst1q_f32(p_im, pi);
+    }
+#else
+    for (; i + NCO_LANES <= length; i += NCO_LANES)
+    {
+        for (k = 0; k < NCO_LANES; k++)
+        {
+            tmp = input[i + k].re;
+            output[i + k].re = tmp * p_re[k] - input[i + k].im * p_im[k];
+            output[i + k].im = tmp * p_im[k] + input[i + k].im * p_re[k];
+
+            tmp = p_re[k];
+            p_re[k] = tmp * step_re - p_im[k] * step_im;
+            p_im[k] = tmp * step_im + p_im[k] * step_re;
+        }
+    }
+#endif
 
-    for (i = 0; i < length; i++)
+    // remaining samples use the next phasors in order
+    for (k = 0; i < length; i++, k++)
     {
-        dtmp.re = data[i].re;
-        dtmp.im = data[i].im;
-
-        osc.re = osc1.re * osc_cos - osc1.im * osc_sin;
-        osc.im = osc1.im * osc_cos + osc1.re * osc_sin;
-        //osc_gn = 1.95 - (osc1.re * osc1.re + osc1.im * osc1.im);
-        osc_gn = 1.99 - (osc1.re * osc1.re + osc1.im * osc1.im);
-        osc1.re = osc_gn * osc.re;
-        osc1.im = osc_gn * osc.im;
-
-        // complex multiply by shift frequency
-        data[i].re = ((dtmp.re * osc.re) - (dtmp.im * osc.im));
-        data[i].im = ((dtmp.re * osc.im) + (dtmp.im * osc.re));
+        tmp = input[i].re;
+        output[i].re = tmp * p_re[k] - input[i].im * p_im[k];
+        output[i].im = tmp * p_im[k] + input[i].im * p_re[k];
     }
 }
@@ -5,12 +5,21 @@
 
 #include "common/datatypes.h"
 
+/* Number of phasors generated per step */
+#define NCO_LANES       4
+
 /*
  * Class for performing frequency translation.
  *
  * This class takes I/Q baseband data and performs frequency translation
  * using an NCO. In addition to the NCO frequency a CW offset can be
  * specified to aid CW operations.
+ *
+ * The NCO phase is kept in a double precision accumulator. For every
+ * segment of up to NCO_SEGMENT samples, NCO_LANES phasors are seeded from
+ * the accumulator and a precomputed table of e^(j*k*inc), and then rotated
+ * by e^(j*NCO_LANES*inc) per step. The rotation error can only build up
+ * within a segment, so no per-sample amplitude correction is needed.
  */
 class Translate
 {
@@ -30,15 +39,27 @@ public:
     /* Set additional CW offset. */
     void        set_cw_offset(real_t offset_hz);
 
+    /*
+     * Translate length samples. The first version works in place, the
+     * second one reads from input and writes to output, which may be the
+     * same buffer.
+     */
     void        process(int length, complex_t * data);
+    void        process(int length, const complex_t * input,
+                        complex_t * output);
     void        set_sample_rate(real_t rate);
 
 private:
+    void        process_segment(int length, const complex_t * input,
+                                complex_t * output);
+
     real_t     sample_rate;   // sample rate.
     real_t     nco_freq;      // NCO frequency in Hz.
     real_t     cw_offset;     // Additional CW offset.
-    real_t     nco_inc;
-    real_t     osc_cos;
-    real_t     osc_sin;
-    complex_t  osc1;
+    double     nco_inc;       // phase increment per sample in radians
+    double     nco_phase;     // phase of the next sample in radians
+    real_t     rot_re[NCO_LANES];  // e^(j*k*inc) for k = 0..NCO_LANES-1
+    real_t     rot_im[NCO_LANES];
+    real_t     step_re;            // e^(j*NCO_LANES*inc)
+    real_t     step_im;
 };
@@ -18,15 +18,20 @@ NANODSP_HEADERS += \
     nanosdr/nanodsp/cute_fft.h \
     nanosdr/nanodsp/fastfir.h \
     nanosdr/nanodsp/fft.h \
+    nanosdr/nanodsp/fft_backend.h \
+    nanosdr/nanodsp/filter/cic_decim.h \
     nanosdr/nanodsp/filter/decimator.h \
     nanosdr/nanodsp/filter/filtercoef_hbf_70.h \
     nanosdr/nanodsp/filter/filtercoef_hbf_100.h \
     nanosdr/nanodsp/filter/filtercoef_hbf_140.h \
+    nanosdr/nanodsp/filter/fir_decim.h \
+    nanosdr/nanodsp/filter/half_band.h \
     nanosdr/nanodsp/fir.h \
     nanosdr/nanodsp/fract_resampler.h \
     nanosdr/nanodsp/kiss_fft.h \
     nanosdr/nanodsp/_kiss_fft_guts.h \
     nanosdr/nanodsp/nfm_demod.h \
+    nanosdr/nanodsp/real_ddc.h \
     nanosdr/nanodsp/smeter.h \
     nanosdr/nanodsp/ssbdemod.h \
     nanosdr/nanodsp/translate.h
@@ -37,11 +42,15 @@ NANODSP_SOURCES += \
     nanosdr/nanodsp/cute_fft.cpp \
     nanosdr/nanodsp/fastfir.cpp \
     nanosdr/nanodsp/fft.cpp \
+    nanosdr/nanodsp/fft_backend.cpp \
+    nanosdr/nanodsp/filter/cic_decim.cpp \
     nanosdr/nanodsp/filter/decimator.cpp \
+    nanosdr/nanodsp/filter/fir_decim.cpp \
     nanosdr/nanodsp/fir.cpp \
     nanosdr/nanodsp/fract_resampler.cpp \
     nanosdr/nanodsp/kiss_fft.c \
     nanosdr/nanodsp/nfm_demod.cpp \
+    nanosdr/nanodsp/real_ddc.cpp \
     nanosdr/nanodsp/smeter.cpp \
     nanosdr/nanodsp/translate.cpp
 
@@ -50,8 +59,12 @@ HEADERS += \
     nanosdr/common/bithacks.h \
     nanosdr/common/datatypes.h \
     nanosdr/common/library_loader.h \
+    nanosdr/common/mirror_buffer.h \
     nanosdr/common/ring_buffer.h \
     nanosdr/common/ring_buffer_cplx.h \
+    nanosdr/common/ring_buffer_spsc.h \
+    nanosdr/common/ring_buffer_spsc_cplx.h \
+    nanosdr/common/sample_conv.h \
     nanosdr/common/sdr_data.h \
     nanosdr/common/thread_class.h \
     nanosdr/common/time.h \
@@ -61,5 +74,6 @@ HEADERS += \
 
 SOURCES += \
     $${NANODSP_SOURCES} \
+    nanosdr/common/sample_conv.c \
     nanosdr/fft_thread.cpp \
     nanosdr/receiver.cpp
@@ -30,7 +30,6 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-#include "common/bithacks.h"
 #include "common/datatypes.h"
 #include "common/sdr_data.h"
 #include "common/time.h"
@@ -44,15 +43,30 @@
 #include "nanodsp/translate.h"
 #include "receiver.h"
 
+// Lowest rate after the channel filter in AM mode, leaves room for the 4 kHz
+// audio filter in AmDemod
+#define AM_MIN_RATE     16000.0
+
 
 Receiver::Receiver()
 {
+    fused_mixer = true;
     sql_level = -160.f;
     input_rate = 96000.0f;
-    quad_decim = 2;
-    quad_rate = input_rate / quad_decim;
+    quad_rate = input_rate / 2.0f;
     output_rate = 48000.0f;
+    filt_rate = quad_rate;
+    filt_decim = 1;
+    filt_index = 0;
+    filt_latency = FASTFIR_MAX_BLOCK;
+    frame_quad = 0;
+    agc_threshold = -80;
+    agc_gain = 0;
+    agc_slope = 2;
+    agc_decay = 500;
     demod = SDR_DEMOD_SSB;
+    next_demod = demod;
+    next_mode = demod | 1 << 8;
     cplx_buf0 = nullptr;
     cplx_buf1 = nullptr;
     cplx_buf2 = nullptr;
@@ -91,27 +105,20 @@ void Receiver::init(real_t in_rate, real_t out_rate, real_t dyn_range,
     if (input_rate < quad_rate)
         quad_rate = input_rate;
 
-    // find a decimation rate based on quad_rate (FIXME: do we still need this?)
-    quad_decim = next_power_of_two(input_rate / quad_rate);
-    if (quad_decim == 1 && input_rate > quad_rate)
-        quad_decim = 2;
-
-    quad_decim = decim.init(quad_decim, dyn_range);
-    quad_rate = input_rate / quad_decim;
+    // the decimator resamples by a rational factor when needed, so the
+    // quadrature rate is exact and any frame length works
+    quad_rate = decim.init_rate(input_rate, quad_rate, dyn_range);
+    frame_quad = lrint(frame_length * quad_rate / input_rate);
+    if (fabs(frame_quad - frame_length * quad_rate / input_rate) > 1.e-3)
+        frame_quad = 0;
 
     fprintf(stderr,
             "Receiver sample rates:\n"
             "   input rate: %.2f Hz\n"
-            "   decimation: %d\n"
+            "   decimation: %.4f\n"
             "    quad rate: %.2f Hz\n"
             "  output rate: %.2f Hz\n",
-            input_rate, quad_decim, quad_rate, output_rate);
-
-    if (frame_length % quad_decim)
-        fprintf(stderr,
-            "*** WARNING: frame_length is not an integer multiple of the decimation:\n"
-            "                 %u %% %u = %u\n",
-            frame_length, quad_decim, frame_length % quad_decim);
+            input_rate, input_rate / quad_rate, quad_rate, output_rate);
 
     // free buffers and object that need to be re-initialized
     free_memory();
@@ -125,14 +132,14 @@ void Receiver::init(real_t in_rate, real_t out_rate, real_t dyn_range,
     // initialize DSP blocks
     vfo.set_sample_rate(input_rate);
     filter.setup(-250.0, 250.0, 0.0, quad_rate);
-    agc.setup(true, false, -80, 0, 2, 500, quad_rate);
-    am.setup(quad_rate, 4000);
-    nfm.set_sample_rate(quad_rate);
-    bfo.set_sample_rate(quad_rate);
+    set_filter_latency(filt_latency);
+    setup_filter_rates(frame_length);
+    set_filter_rate(filter.get_decimation());
     bfo.set_cw_offset(700.f);
 
-    audio_rr = quad_rate / output_rate;
-    audio_resampler.init(frame_length);
+    // process() is not running yet, take over the selected mode directly
+    demod = next_demod;
+    update_filter_rate();
 }
 
 
@@ -145,13 +152,108 @@ void Receiver::set_tuning_offset(real_t offset)
 
 void Receiver::set_agc(int threshold, int slope, int decay)
 {
-    agc.setup(true, false, threshold, 50, slope, decay, quad_rate);
+    agc_threshold = threshold;
+    agc_gain = 50;
+    agc_slope = slope;
+    agc_decay = decay;
+    agc.setup(true, false, agc_threshold, agc_gain, agc_slope, agc_decay,
+              filt_rate);
 }
 
 void Receiver::set_filter(real_t low_cut, real_t high_cut)
 {
     fprintf(stderr, "   FILT   LO:%.0f   HI:%.0f\n", low_cut, high_cut);
     filter.setup(low_cut, high_cut, 0.f, quad_rate); // NB: fffset is ignored
+    update_filter_rate();
+}
+
+int Receiver::set_filter_latency(int samples)
+{
+    int     block = samples;
+
+    filt_latency = samples;
+
+    // largest block dividing the frame, if there is one
+    if (block > FASTFIR_MAX_BLOCK)
+        block = FASTFIR_MAX_BLOCK;
+    while (frame_quad > 0 && block >= FASTFIR_MIN_BLOCK &&
+           (frame_quad % block || !FastFIR::valid_block_size(block)))
+        block--;
+    if (frame_quad == 0 || block < FASTFIR_MIN_BLOCK)
+        block = samples;
+
+    block = filter.set_block_size(block);
+
+    fprintf(stderr, "   FILT   latency: %d samples (%.1f ms)\n", block,
+            1.e3 * block / quad_rate);
+    update_filter_rate();
+
+    return block;
+}
+
+/*
+ * Decimate the filter output as far as the pass band allows, so the AGC, the
+ * demodulators and the audio resampler run at the lower rate. The FM PLL
+ * needs the full rate. The filter switches at the start of a process() call,
+ * see set_filter_rate(), and the demodulator follows in the same call.
+ */
+void Receiver::update_filter_rate(void)
+{
+    int     decim = filter.max_decimation();
+
+    if (next_demod == SDR_DEMOD_FM)
+        decim = 1;
+    else if (next_demod == SDR_DEMOD_AM)
+        while (decim > 1 && quad_rate / decim < AM_MIN_RATE)
+            decim /= 2;
+
+    decim = filter.set_decimation(decim);
+    __atomic_store_n(&next_mode, next_demod | decim << 8, __ATOMIC_RELEASE);
+    fprintf(stderr, "   FILT   output rate: %.2f Hz\n", quad_rate / decim);
+}
+
+/*
+ * Design the AM filter and the audio resampler for each rate the channel
+ * filter can decimate to, so that switching rate in process() does not
+ * allocate or recompute filters. FM always runs at the quadrature rate.
+ */
+void Receiver::setup_filter_rates(uint32_t frame_length)
+{
+    real_t  rate;
+    int     i;
+
+    for (i = 0; i < FASTFIR_NUM_FFTS; i++)
+    {
+        rate = quad_rate / (1 << i);
+        if (rate >= AM_MIN_RATE)
+            am[i].setup(rate, 4000);
+
+        // exact for the usual rates, also when the filter decimates
+        audio_resampler[i].init(frame_length);
+        audio_resampler[i].set_rates(rate, output_rate);
+    }
+
+    nfm.set_sample_rate(quad_rate);
+    agc.setup(true, false, agc_threshold, agc_gain, agc_slope, agc_decay,
+              quad_rate);
+}
+
+/*
+ * Switch the blocks after the channel filter to its output rate. Called from
+ * process(), so the AGC keeps its level and everything else was set up by
+ * setup_filter_rates().
+ */
+void Receiver::set_filter_rate(int decim)
+{
+    filt_decim = decim;
+    filt_rate = quad_rate / decim;
+    filt_index = 0;
+    while ((1 << filt_index) < decim)
+        filt_index++;
+
+    agc.set_sample_rate(filt_rate);
+    bfo.set_sample_rate(filt_rate);
+    audio_resampler[filt_index].reset();
 }
 
 void Receiver::set_cw_offset(real_t offset)
@@ -167,7 +269,8 @@ void Receiver::set_demod(sdr_demod_t new_demod)
     case SDR_DEMOD_SSB:
     case SDR_DEMOD_AM:
     case SDR_DEMOD_FM:
-        demod = new_demod;
+        next_demod = new_demod;
+        update_filter_rate();
         break;
     default:
         fprintf(stderr, "set_demod called with unsupported demodulator: %d\n",
@@ -185,13 +288,30 @@ int Receiver::process(int input_length, complex_t * input, real_t * output)
     int         filt_samples;
     int         quad_samples;
     int         out_samples;
+    int         mode;
 
-    vfo.process(input_length, input);
-    quad_samples = decim.process(input_length, input);
+    if (fused_mixer)
+    {
+        quad_samples = decim.process(input_length, input, input, vfo);
+    }
+    else
+    {
+        vfo.process(input_length, input);
+        quad_samples = decim.process(input_length, input);
+    }
     if (quad_samples == 0)
         return 0;
 
+    // the filter picks up new settings from set_filter() and set_demod() here
     filt_samples = filter.process(quad_samples, input, cplx_buf1);
+    if (filter.get_decimation() != filt_decim)
+        set_filter_rate(filter.get_decimation());
+
+    // switch mode once the filter runs at the decimation chosen for it
+    mode = __atomic_load_n(&next_mode, __ATOMIC_ACQUIRE);
+    if ((mode & 0xff) != demod && (mode >> 8) == filt_decim)
+        demod = mode & 0xff;
+
     if (filt_samples == 0)
         return 0;
 
@@ -211,7 +331,7 @@ int Receiver::process(int input_length, complex_t * input, real_t * output)
 
     case SDR_DEMOD_AM:
         agc.process(filt_samples, cplx_buf1, cplx_buf2);
-        am.process(filt_samples, cplx_buf2, real_buf1);
+        am[filt_index].process(filt_samples, cplx_buf2, real_buf1);
         break;
 
     case SDR_DEMOD_FM:
@@ -219,7 +339,8 @@ int Receiver::process(int input_length, complex_t * input, real_t * output)
         break;
     }
 
-    out_samples = audio_resampler.resample(filt_samples, audio_rr, real_buf1, output);
+    out_samples = audio_resampler[filt_index].resample(filt_samples, real_buf1,
+                                                       output);
 
     return out_samples;
 }
@@ -33,12 +33,34 @@ public:
         sql_level = level;
     }
 
+    /*
+     * Use the fused translate + decimate stage (default) or run the VFO
+     * and the decimator as separate passes.
+     */
+    void set_fused_mixer(bool enable)
+    {
+        fused_mixer = enable;
+    }
+
+    /*
+     * Set the channel filter latency in samples at the quadrature rate.
+     * Small values trade CPU for less delay, see FastFIR::set_block_size().
+     * The largest filter block up to this dividing the frame is preferred,
+     * so every frame gives the same number of output samples.
+     *
+     * Returns the latency used.
+     */
+    int set_filter_latency(int samples);
+
     int process(int input_length, complex_t * input, real_t * output);
 
     real_t  get_signal_strength(void) const;
 
 private:
     void free_memory(void);
+    void update_filter_rate(void);
+    void setup_filter_rates(uint32_t frame_length);
+    void set_filter_rate(int decim);
 
 private:
     FastFIR     filter;
@@ -46,21 +68,33 @@ private:
     SMeter      meter;
     CAgc        agc;
     NfmDemod    nfm;
-    AmDemod     am;
     SsbDemod    ssb;
     Translate   vfo;
     Translate   bfo;            // used to generate CW tone
-    FractResampler  audio_resampler;
 
+    // one for each filter decimation, see setup_filter_rates()
+    AmDemod         am[FASTFIR_NUM_FFTS];
+    FractResampler  audio_resampler[FASTFIR_NUM_FFTS];
+
+    bool        fused_mixer;
     real_t      sql_level;
     real_t      input_rate;
     real_t      quad_rate;
+    real_t      filt_rate;      // channel filter output rate
+    int         filt_decim;     // quad_rate / filt_rate
+    int         filt_index;     // log2(filt_decim)
+    int         filt_latency;   // set by set_filter_latency()
+    int         frame_quad;     // quad samples per frame or 0 if not exact
     real_t      output_rate;
-    real_t      audio_rr;
 
-    unsigned int    quad_decim;
+    int         agc_threshold;
+    int         agc_gain;
+    int         agc_slope;
+    int         agc_decay;
 
-    uint8_t     demod;
+    uint8_t     demod;          // used by process()
+    int         next_demod;     // set by set_demod()
+    int         next_mode;      // next_demod | decimation << 8, see process()
     uint32_t    buflen;
     complex_t  *cplx_buf0;
     complex_t  *cplx_buf1;